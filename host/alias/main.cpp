@@ -0,0 +1,260 @@
+/**
+ * Quality-per-cycle aliasing analyzer for the VS_Osc modes (host only).
+ *
+ * For every oscillator mode of the compiled bank, sweeps pitch and the shape
+ * knob, renders VS_Osc on its own (no envelope, no LFO, no filter), splits
+ * the spectrum into harmonic and inharmonic (aliased) energy and reports that
+ * next to the measured cost per sample. Tells where oversampling or
+ * band-limiting would be worth its CPU.
+ *
+ * --oversample 2 renders at twice --sr through the engine's VS_Decimator
+ * (the VoiceManager multirate path); cost per output sample includes it.
+ */
+#include "DaisyDuino.h"
+#include "SynthHardware.h"
+#include "vs_osc.h"
+#include "vs_halfband.h"
+#include "vs_rate.h"
+#include "host_panel.h"
+#include "spectrum.h"
+
+#include <algorithm>
+#include <chrono>
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifndef OSC_BANK
+#define OSC_BANK 2
+#endif
+
+struct AliasConfig
+{
+  float sample_rate = 48000.f;
+  size_t oversample = 1;
+  int note_min = 24, note_max = 108, note_step = 6;
+  int shape_steps = 9;
+  size_t fft_size = 16384;
+  const char *out_path = nullptr;
+};
+
+// reference-clock ticks where the CPU has them, 0 elsewhere
+static inline uint64_t Ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+static const char *ModeName(OscType type)
+{
+  switch (type)
+  {
+  case OSC_TYPE_SQ:
+    return "ProcessSquare";
+#if OSC_BANK == 2
+  case OSC_TYPE_TRI:
+    return "ProcessPair2Dgtl";
+  default:
+    return "ProcessPair2Anlg";
+#else
+  case OSC_TYPE_TRI:
+    return "ProcessPair3Dgtl";
+  default:
+    return "ProcessPair3Anlg";
+#endif
+  }
+}
+
+// pitch the mode actually plays, with env and LFO at rest
+static float ExpectedF0(OscType type, float freq, float osc_param, float osc_rate)
+{
+#if OSC_BANK != 2
+  // the shape knob is a fine tune on this mode
+  if (type == OSC_TYPE_TRI)
+    freq = fclamp(freq * exp2f(osc_param), 20, VS_RateLimits::For(osc_rate).max_osc_freq);
+#else
+  (void)type;
+  (void)osc_param;
+#endif
+  // the DaisySP oscillators top out at a quarter of their rate
+  return fminf(freq, 0.25f * osc_rate);
+}
+
+struct Measure
+{
+  SpectrumSummary spectrum;
+  double ns_per_sample;
+  double ticks_per_sample;
+};
+
+static Measure RenderMode(const AliasConfig &cfg, OscType type, float shape_pos, float freq)
+{
+  SynthHardware hw;
+  hw.Init(1000);
+  PanelSetOscType(type);
+  PanelSetPot(POT_OSC_PARAM, shape_pos);
+  PanelSetPot(POT_ENV_OSC_AMT, 0.5f); // bipolar centre = no env mod
+  PanelSetPot(POT_LFO_OSC_AMT, 0.f);
+  PanelSettle(hw);
+
+  const float osc_rate = cfg.sample_rate * cfg.oversample;
+  VS_Osc osc;
+  osc.Init(osc_rate);
+  osc.SetParams(hw.Params());
+  VS_Decimator decim;
+  decim.Init();
+
+  // let the polyBLEP / sync state (and the decimator) settle before measuring
+  for (int i = 0; i < 2048; i++)
+    osc.Process(freq, 0.f, 0.f);
+
+  std::vector<float> buf(cfg.fft_size);
+  std::vector<float> os(2 * HALFBAND_CHUNK);
+  auto t0 = std::chrono::steady_clock::now();
+  uint64_t k0 = Ticks();
+  if (cfg.oversample == 1)
+  {
+    for (size_t i = 0; i < buf.size(); i++)
+      buf[i] = osc.Process(freq, 0.f, 0.f);
+  }
+  else
+  {
+    for (size_t start = 0; start < buf.size(); start += HALFBAND_CHUNK)
+    {
+      size_t n = std::min<size_t>(HALFBAND_CHUNK, buf.size() - start);
+      for (size_t i = 0; i < 2 * n; i++)
+        os[i] = osc.Process(freq, 0.f, 0.f);
+      decim.Process(os.data(), &buf[start], n);
+    }
+  }
+  uint64_t k1 = Ticks();
+  auto t1 = std::chrono::steady_clock::now();
+
+  Measure m;
+  float f0 = ExpectedF0(type, freq, hw.GetPot(POT_OSC_PARAM), osc_rate);
+  m.spectrum = AnalyzeSpectrum(buf.data(), buf.size(), cfg.sample_rate, f0);
+  m.ns_per_sample = std::chrono::duration<double, std::nano>(t1 - t0).count() / buf.size();
+  m.ticks_per_sample = (double)(k1 - k0) / buf.size();
+  return m;
+}
+
+static bool ParseArgs(int argc, char **argv, AliasConfig &cfg)
+{
+  static const option opts[] = {
+      {"sr", required_argument, nullptr, 'r'},
+      {"note-min", required_argument, nullptr, 'a'},
+      {"note-max", required_argument, nullptr, 'b'},
+      {"note-step", required_argument, nullptr, 'n'},
+      {"shape-steps", required_argument, nullptr, 's'},
+      {"fft", required_argument, nullptr, 'f'},
+      {"out", required_argument, nullptr, 'o'},
+      {"oversample", required_argument, nullptr, 'O'},
+      {nullptr, 0, nullptr, 0},
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "", opts, nullptr)) != -1)
+  {
+    switch (c)
+    {
+    case 'r':
+      cfg.sample_rate = strtof(optarg, nullptr);
+      break;
+    case 'a':
+      cfg.note_min = atoi(optarg);
+      break;
+    case 'b':
+      cfg.note_max = atoi(optarg);
+      break;
+    case 'n':
+      cfg.note_step = atoi(optarg);
+      break;
+    case 's':
+      cfg.shape_steps = atoi(optarg);
+      break;
+    case 'f':
+      cfg.fft_size = strtoul(optarg, nullptr, 10);
+      break;
+    case 'o':
+      cfg.out_path = optarg;
+      break;
+    case 'O':
+      cfg.oversample = strtoul(optarg, nullptr, 10) >= 2 ? 2 : 1;
+      break;
+    default:
+      return false;
+    }
+  }
+  return cfg.note_step > 0 && cfg.shape_steps > 0 && cfg.fft_size >= 1024 &&
+         cfg.note_min <= cfg.note_max;
+}
+
+int main(int argc, char **argv)
+{
+  AliasConfig cfg;
+  if (!ParseArgs(argc, argv, cfg))
+  {
+    fprintf(stderr,
+            "usage: %s [--sr HZ] [--note-min N] [--note-max N] [--note-step N]\n"
+            "          [--shape-steps N] [--fft N] [--out FILE] [--oversample N]\n",
+            argv[0]);
+    return 1;
+  }
+
+  FILE *f = cfg.out_path ? fopen(cfg.out_path, "w") : stdout;
+  if (!f)
+  {
+    perror(cfg.out_path);
+    return 1;
+  }
+  fprintf(f, "bank,mode,note,freq_hz,shape,harmonic_db,inharmonic_db,alias_db,alias_ratio,"
+             "ns_per_sample,ticks_per_sample,sr_hz,oversample\n");
+
+  for (int t = 0; t < OSC_TYPE_COUNT; t++)
+  {
+    OscType type = (OscType)t;
+    double worst_db = -300.0, sum_ns = 0.0, sum_ticks = 0.0;
+    int worst_note = 0, runs = 0;
+    float worst_shape = 0.f;
+    for (int note = cfg.note_min; note <= cfg.note_max; note += cfg.note_step)
+    {
+      for (int s = 0; s < cfg.shape_steps; s++)
+      {
+        float shape = cfg.shape_steps > 1 ? (float)s / (cfg.shape_steps - 1) : 0.5f;
+        float freq = mtof((float)note);
+        Measure m = RenderMode(cfg, type, shape, freq);
+
+        const double floor_e = 1e-20;
+        double h_db = 10.0 * log10(m.spectrum.harmonic_energy + floor_e);
+        double i_db = 10.0 * log10(m.spectrum.inharmonic_energy + floor_e);
+        double alias_db = i_db - h_db;
+        fprintf(f, "%d,%s,%d,%.2f,%.3f,%.2f,%.2f,%.2f,%.6f,%.2f,%.1f,%.0f,%zu\n", OSC_BANK,
+                ModeName(type), note, freq, shape, h_db, i_db, alias_db, m.spectrum.alias_ratio,
+                m.ns_per_sample, m.ticks_per_sample, cfg.sample_rate, cfg.oversample);
+
+        if (alias_db > worst_db)
+        {
+          worst_db = alias_db;
+          worst_note = note;
+          worst_shape = shape;
+        }
+        sum_ns += m.ns_per_sample;
+        sum_ticks += m.ticks_per_sample;
+        runs++;
+      }
+    }
+    fprintf(stderr, "bank %d %-18s %.0f Hz x%zu  mean %6.1f ns/smp %7.1f ticks/smp  worst alias %6.1f dB (note %d, shape %.2f)\n",
+            OSC_BANK, ModeName(type), cfg.sample_rate, cfg.oversample, sum_ns / runs,
+            sum_ticks / runs, worst_db, worst_note, worst_shape);
+  }
+  if (f != stdout)
+    fclose(f);
+  return 0;
+}
@@ -0,0 +1,111 @@
+#include "host_panel.h"
+
+static int PotPin(PotId id)
+{
+  switch (id)
+  {
+  case POT_OSC_PARAM:
+    return OSC_PARAM_POT;
+  case POT_ENV_OSC_AMT:
+    return OSC_ENV_AMT_POT;
+  case POT_LFO_OSC_AMT:
+    return OSC_LFO_AMT_POT;
+  case POT_CUTOFF:
+    return CUTOFF_POT;
+  case POT_RESO:
+    return RESO_POT;
+  case POT_ENV_CUTOFF_AMT:
+    return ENV_CUTOFF_AMT_POT;
+  case POT_LFO_CUTOFF_AMT:
+    return LFO_CUTOFF_AMT_POT;
+  case POT_ATTACK:
+    return ATTACK_POT;
+  case POT_DECAY:
+    return DECAY_POT;
+  case POT_SUSTAIN:
+    return SUSTAIN_POT;
+  case POT_RELEASE:
+    return RELEASE_POT;
+  case POT_LFO_RATE:
+    return LFO_RATE_POT;
+  default:
+    return -1;
+  }
+}
+
+// switches are wired to ground with pull-ups: pressed reads low
+static void SetPressed(int pin, bool pressed)
+{
+  HostSetDigitalPin(pin, !pressed);
+}
+
+void PanelSetPot(PotId id, float position)
+{
+  HostSetAnalogPin(PotPin(id), position);
+}
+
+void PanelSetOscType(OscType type)
+{
+  SetPressed(OSC_TRI_SW, type == OSC_TYPE_TRI);
+  SetPressed(OSC_SQ_SW, type == OSC_TYPE_SQ);
+}
+
+void PanelSetAmpMode(AmpMode mode)
+{
+  SetPressed(AMP_ADSR_MODE_SW, mode == AMP_MODE_ADSR);
+  SetPressed(AMP_DRONE_MODE_SW, mode == AMP_MODE_DRONE);
+}
+
+void PanelSetLfoType(LfoType type)
+{
+  // mirrors the decoding in SynthHardware::UpdateLFO
+  bool sig = type == LFO_TYPE_SIN || type == LFO_TYPE_TRI || type == LFO_TYPE_FM;
+  bool shape_1 = type == LFO_TYPE_SIN || type == LFO_TYPE_STEPPED;
+  bool shape_3 = type == LFO_TYPE_FM || type == LFO_TYPE_NOISE;
+  SetPressed(LFO_SIG_RAND_SW, sig);
+  SetPressed(LFO_SHAPE_1_SW, shape_1);
+  SetPressed(LFO_SHAPE_3_SW, shape_3);
+}
+
+void PanelSettle(SynthHardware &hw)
+{
+  // PanelSwitch keeps 8 samples of history
+  for (int i = 0; i < 10; i++)
+    hw.UpdateControls();
+}
+
+const char *OscTypeName(OscType type)
+{
+  switch (type)
+  {
+  case OSC_TYPE_TRI:
+    return "tri";
+  case OSC_TYPE_SAW:
+    return "saw";
+  case OSC_TYPE_SQ:
+    return "sq";
+  default:
+    return "?";
+  }
+}
+
+const char *LfoTypeName(LfoType type)
+{
+  switch (type)
+  {
+  case LFO_TYPE_SIN:
+    return "sin";
+  case LFO_TYPE_TRI:
+    return "tri";
+  case LFO_TYPE_FM:
+    return "fm";
+  case LFO_TYPE_STEPPED:
+    return "stepped";
+  case LFO_TYPE_SMOOTH:
+    return "smooth";
+  case LFO_TYPE_NOISE:
+    return "noise";
+  default:
+    return "?";
+  }
+}
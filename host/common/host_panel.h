@@ -0,0 +1,22 @@
+#pragma once
+#include "SynthHardware.h"
+
+/**
+ * Host helpers that set the front panel through the stand-in pin table,
+ * so the real SynthHardware code (deadbands, debounce, mode decoding) runs.
+ */
+
+// raw, normalised pot position 0..1 (before the Parameter mapping)
+void PanelSetPot(PotId id, float position);
+void PanelSetOscType(OscType type);
+void PanelSetAmpMode(AmpMode mode);
+void PanelSetLfoType(LfoType type);
+// run enough control passes for the switch debouncers to settle
+void PanelSettle(SynthHardware &hw);
+
+const char *OscTypeName(OscType type);
+const char *LfoTypeName(LfoType type);
+
+#define POT_COUNT (POT_LFO_RATE + 1)
+#define OSC_TYPE_COUNT (OSC_TYPE_SQ + 1)
+#define LFO_TYPE_COUNT (LFO_TYPE_NOISE + 1)
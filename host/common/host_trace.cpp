@@ -0,0 +1,67 @@
+#include "host_trace.h"
+#include "SynthHardware.h"
+#include <stdio.h>
+#include <string.h>
+
+bool LoadControlTrace(const std::vector<uint8_t> &raw, ControlTraceHeader &header,
+                      std::vector<ControlTraceEvent> &events)
+{
+  const uint32_t magic = TRACE_MAGIC;
+  for (size_t pos = 0; pos + sizeof(header) <= raw.size(); pos++)
+  {
+    if (memcmp(&raw[pos], &magic, sizeof(magic)) != 0)
+      continue;
+    memcpy(&header, &raw[pos], sizeof(header));
+    if (header.version != TRACE_VERSION)
+      continue;
+    size_t avail = (raw.size() - pos - sizeof(header)) / sizeof(ControlTraceEvent);
+    if (avail < header.events)
+    {
+      fprintf(stderr, "warning: trace cut short, %zu of %u events\n", avail, header.events);
+      header.events = (uint32_t)avail;
+    }
+    events.resize(header.events);
+    if (header.events > 0)
+      memcpy(events.data(), &raw[pos + sizeof(header)],
+             header.events * sizeof(ControlTraceEvent));
+    return true;
+  }
+  return false;
+}
+
+bool TraceApplyInput(const ControlTraceEvent &e)
+{
+  switch (e.kind)
+  {
+  case TRACE_POT:
+    HostSetAnalogPin(ControlTracePotPin(e.id), (float)e.value / ANALOG_READ_MAX);
+    return true;
+  case TRACE_SWITCH:
+    HostSetDigitalPin(ControlTraceSwitchPin(e.id), e.value != 0);
+    return true;
+  default:
+    return false;
+  }
+}
+
+void TraceDispatchMidi(VoiceManager &vm, uint8_t status, uint8_t d1, uint8_t d2)
+{
+  byte ch = (status & 0x0f) + 1;
+  switch (status & 0xf0)
+  {
+  case 0x90:
+    if (d2 == 0)
+      vm.NoteOff(ch, d1, d2);
+    else
+      vm.NoteOn(ch, d1, d2);
+    break;
+  case 0x80:
+    vm.NoteOff(ch, d1, d2);
+    break;
+  case 0xB0:
+    vm.ControlChange(ch, d1, d2);
+    break;
+  default:
+    break;
+  }
+}
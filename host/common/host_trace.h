@@ -0,0 +1,20 @@
+#pragma once
+#include "ControlTrace.h"
+#include "VoiceManager.h"
+#include <vector>
+
+/**
+ * Control-trace playback helpers shared by the host tools, so a trace is
+ * fed to SynthHardware and the engine the same way everywhere.
+ */
+
+// finds the header anywhere in the capture, the serial dump may carry
+// telemetry frames before it
+bool LoadControlTrace(const std::vector<uint8_t> &raw, ControlTraceHeader &header,
+                      std::vector<ControlTraceEvent> &events);
+
+// pot and switch events to the stand-in pin table; false for any other kind
+bool TraceApplyInput(const ControlTraceEvent &e);
+
+// the sketch's MIDI handlers, CCs through VoiceManager::ControlChange
+void TraceDispatchMidi(VoiceManager &vm, uint8_t status, uint8_t d1, uint8_t d2);
@@ -0,0 +1,106 @@
+#include "spectrum.h"
+#include <math.h>
+
+void FftInPlace(std::vector<float> &re, std::vector<float> &im)
+{
+  const size_t n = re.size();
+  for (size_t i = 1, j = 0; i < n; i++)
+  {
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1)
+      j ^= bit;
+    j ^= bit;
+    if (i < j)
+    {
+      float t = re[i];
+      re[i] = re[j];
+      re[j] = t;
+      t = im[i];
+      im[i] = im[j];
+      im[j] = t;
+    }
+  }
+  for (size_t len = 2; len <= n; len <<= 1)
+  {
+    const double ang = -2.0 * M_PI / (double)len;
+    const float wr = (float)cos(ang), wi = (float)sin(ang);
+    for (size_t i = 0; i < n; i += len)
+    {
+      float cr = 1.f, ci = 0.f;
+      for (size_t k = 0; k < len / 2; k++)
+      {
+        const size_t a = i + k, b = i + k + len / 2;
+        const float br = re[b] * cr - im[b] * ci;
+        const float bi = re[b] * ci + im[b] * cr;
+        re[b] = re[a] - br;
+        im[b] = im[a] - bi;
+        re[a] += br;
+        im[a] += bi;
+        const float ncr = cr * wr - ci * wi;
+        ci = cr * wi + ci * wr;
+        cr = ncr;
+      }
+    }
+  }
+}
+
+SpectrumSummary AnalyzeSpectrum(const float *x, size_t size, float sample_rate, float f0,
+                                int tolerance_bins)
+{
+  SpectrumSummary s = {};
+  size_t n = 1;
+  while (n * 2 <= size)
+    n *= 2;
+  if (n < 64)
+    return s;
+
+  double sq = 0.0;
+  for (size_t i = 0; i < size; i++)
+  {
+    sq += (double)x[i] * x[i];
+    float a = fabsf(x[i]);
+    if (a > s.peak)
+      s.peak = a;
+  }
+  s.rms = (float)sqrt(sq / size);
+
+  // DC would leak into the lowest bins and read as inharmonic
+  double mean = 0.0;
+  for (size_t i = 0; i < n; i++)
+    mean += x[i];
+  mean /= n;
+
+  std::vector<float> re(n), im(n, 0.f);
+  for (size_t i = 0; i < n; i++)
+  {
+    // 4-term Blackman-Harris, sidelobes low enough not to fake aliasing
+    const double p = 2.0 * M_PI * i / (n - 1);
+    const double w = 0.35875 - 0.48829 * cos(p) + 0.14128 * cos(2 * p) - 0.01168 * cos(3 * p);
+    re[i] = (float)((x[i] - mean) * w);
+  }
+  FftInPlace(re, im);
+
+  const double bin_hz = sample_rate / (double)n;
+  double total = 0.0, weighted = 0.0;
+  for (size_t k = 1; k < n / 2; k++)
+  {
+    const double p = (double)re[k] * re[k] + (double)im[k] * im[k];
+    total += p;
+    weighted += p * k * bin_hz;
+
+    bool harmonic = false;
+    if (f0 > 0.f)
+    {
+      const double h = (k * bin_hz) / f0;
+      const double nearest = floor(h + 0.5);
+      harmonic = nearest >= 1.0 && fabs(h - nearest) * f0 <= tolerance_bins * bin_hz;
+    }
+    if (harmonic)
+      s.harmonic_energy += p;
+    else
+      s.inharmonic_energy += p;
+  }
+  s.centroid_hz = total > 0.0 ? (float)(weighted / total) : 0.f;
+  s.alias_ratio = total > 0.0 ? (float)(s.inharmonic_energy / total) : 0.f;
+  return s;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <stddef.h>
+#include <vector>
+
+/**
+ * Offline spectrum helpers for the host analysis tools.
+ */
+
+// in-place radix-2 FFT, size must be a power of two
+void FftInPlace(std::vector<float> &re, std::vector<float> &im);
+
+struct SpectrumSummary
+{
+  float rms;
+  float peak;
+  float centroid_hz;
+  // energy of partials at integer multiples of f0
+  double harmonic_energy;
+  // everything else: aliased partials folded back between the harmonics, noise
+  double inharmonic_energy;
+  // inharmonic / total, 0 when the signal is silent
+  float alias_ratio;
+};
+
+/**
+ * Blackman-Harris windowed power spectrum of `size` samples (rounded down to
+ * a power of two), DC removed. Bins within `tolerance_bins` of k * f0 count as
+ * harmonic; the default covers the window's main lobe.
+ * Pass f0 <= 0 to skip the harmonic split.
+ */
+SpectrumSummary AnalyzeSpectrum(const float *x, size_t size, float sample_rate, float f0,
+                                int tolerance_bins = 4);
@@ -0,0 +1,93 @@
+#pragma once
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Minimal work-stealing pool for the host render tools.
+ * Each worker owns a deque: it pops its own work from the back and, once
+ * empty, steals from the front of the others. Tasks are independent; Run()
+ * returns when all of them are done.
+ */
+class WorkPool
+{
+public:
+  typedef std::function<void(size_t worker)> Task;
+
+  explicit WorkPool(size_t workers = 0)
+  {
+    if (workers == 0)
+      workers = std::thread::hardware_concurrency();
+    if (workers == 0)
+      workers = 1;
+    for (size_t w = 0; w < workers; w++)
+      queues_.emplace_back(new Queue());
+  }
+
+  size_t Workers() const { return queues_.size(); }
+
+  // round-robin initial placement, stealing evens out what is left
+  void Add(Task task)
+  {
+    Queue &q = *queues_[next_queue_++ % queues_.size()];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    q.tasks.push_back(std::move(task));
+  }
+
+  void Run()
+  {
+    std::vector<std::thread> threads;
+    for (size_t w = 0; w < queues_.size(); w++)
+      threads.emplace_back([this, w]() { WorkerLoop(w); });
+    for (std::thread &t : threads)
+      t.join();
+  }
+
+private:
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+  std::vector<std::unique_ptr<Queue>> queues_;
+  size_t next_queue_ = 0;
+
+  bool PopOwn(size_t w, Task &out)
+  {
+    Queue &q = *queues_[w];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty())
+      return false;
+    out = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    return true;
+  }
+
+  bool Steal(size_t w, Task &out)
+  {
+    for (size_t i = 1; i < queues_.size(); i++)
+    {
+      Queue &q = *queues_[(w + i) % queues_.size()];
+      std::lock_guard<std::mutex> lock(q.mutex);
+      if (!q.tasks.empty())
+      {
+        out = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // no task ever adds more work, so empty everywhere means done
+  void WorkerLoop(size_t w)
+  {
+    Task task;
+    while (PopOwn(w, task) || Steal(w, task))
+      task(w);
+  }
+};
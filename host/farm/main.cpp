@@ -0,0 +1,210 @@
+/**
+ * Multi-instance render farm (host only).
+ *
+ * Runs many independent engines (VoiceManager + its own FX arena) at once,
+ * one per worker thread at a time, fed through SynthParams only: no
+ * SynthHardware, no pin table, no shared state. Each instance plays its
+ * own seeded note pattern and parameter set.
+ *
+ * Repeats the same batch for 1, 2, 4, ... threads and reports throughput
+ * (seconds of audio rendered per wall-clock second) and how close the
+ * speed-up gets to linear. Every instance's output is hashed; the hashes
+ * have to match between thread counts, which catches any hidden sharing.
+ */
+#include "DaisyDuino.h"
+#include "VoiceManager.h"
+
+#include <atomic>
+#include <chrono>
+#include <getopt.h>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+struct FarmConfig
+{
+  float sample_rate = 48000.f;
+  size_t block_size = 48;
+  size_t instances = 32;
+  float seconds = 2.f;
+  size_t max_threads = 0; // 0 = hardware concurrency
+  bool fx = false;
+};
+
+// one instance's panel, spread over the parameter space by its index
+static SynthParams InstanceParams(uint32_t index)
+{
+  SynthParams p;
+  p.osc_type = (OscType)(index % 3);
+  p.lfo_type = (LfoType)((index / 3) % 6);
+  p.amp_mode = (index % 4 == 3) ? AMP_MODE_DRONE : AMP_MODE_ADSR;
+  p.osc_param = -1.f + 2.f * ((index * 7) % 11) / 10.f;
+  p.env_osc_amt = 0.3f;
+  p.lfo_osc_amt = 0.2f;
+  p.cutoff = 400.f + 300.f * (index % 8);
+  p.reso = 0.1f * (index % 9);
+  p.env_cutoff_amt = 0.5f;
+  p.lfo_cutoff_amt = 0.3f;
+  p.attack = 0.1f;
+  p.decay = 0.4f;
+  p.sustain = 0.7f;
+  p.release = 0.3f;
+  p.lfo_rate = 0.4f;
+  return p;
+}
+
+// renders one instance start to finish, returns an FNV-1a hash of its output
+static uint64_t RenderInstance(const FarmConfig &cfg, uint32_t index)
+{
+  std::unique_ptr<VoiceManager> vm(new VoiceManager());
+  vm->Init(cfg.sample_rate);
+  vm->SetSeed(index + 1);
+  vm->SetParams(InstanceParams(index));
+  std::vector<float> arena;
+  if (cfg.fx)
+  {
+    arena.resize(FX_ARENA_SIZE);
+    vm->Fx().Init(cfg.sample_rate, arena.data(), arena.size());
+    vm->Fx().SetChorusMix(0.4f);
+    vm->Fx().SetDelayMix(0.3f);
+    vm->Fx().SetReverbMix(0.3f);
+  }
+
+  std::vector<float> l(cfg.block_size), r(cfg.block_size);
+  float *out[2] = {l.data(), r.data()};
+  const size_t blocks = (size_t)(cfg.seconds * cfg.sample_rate / cfg.block_size);
+  // a note every ~100 ms, held for half of it
+  const size_t note_blocks = (size_t)(0.1f * cfg.sample_rate / cfg.block_size) + 1;
+  uint32_t rng = index * 2654435761u + 1;
+  byte held = 0;
+  uint64_t hash = 1469598103934665603ull;
+  for (size_t k = 0; k < blocks; k++)
+  {
+    if (k % note_blocks == 0)
+    {
+      rng = rng * 1664525u + 1013904223u;
+      held = 36 + (byte)((rng >> 24) % 48);
+      vm->NoteOn(1, held, 100);
+    }
+    else if (k % note_blocks == note_blocks / 2 && held != 0)
+    {
+      vm->NoteOff(1, held, 0);
+      held = 0;
+    }
+    vm->ProcessBlock(out, cfg.block_size);
+    const uint8_t *bytes = (const uint8_t *)l.data();
+    for (size_t b = 0; b < cfg.block_size * sizeof(float); b++)
+      hash = (hash ^ bytes[b]) * 1099511628211ull;
+  }
+  return hash;
+}
+
+// all instances over `threads` workers, instances handed out one by one
+static double RenderBatch(const FarmConfig &cfg, size_t threads, std::vector<uint64_t> &hashes)
+{
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    size_t i;
+    while ((i = next.fetch_add(1)) < cfg.instances)
+      hashes[i] = RenderInstance(cfg, (uint32_t)i);
+  };
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::thread> pool;
+  for (size_t t = 0; t < threads; t++)
+    pool.emplace_back(worker);
+  for (std::thread &th : pool)
+    th.join();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static void Usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [--sr HZ] [--block N] [--instances N] [--seconds S] [--threads N] [--fx]\n",
+          argv0);
+}
+
+static bool ParseArgs(int argc, char **argv, FarmConfig &cfg)
+{
+  static const option opts[] = {
+      {"sr", required_argument, nullptr, 'r'},
+      {"block", required_argument, nullptr, 'b'},
+      {"instances", required_argument, nullptr, 'i'},
+      {"seconds", required_argument, nullptr, 's'},
+      {"threads", required_argument, nullptr, 't'},
+      {"fx", no_argument, nullptr, 'x'},
+      {nullptr, 0, nullptr, 0},
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "", opts, nullptr)) != -1)
+  {
+    switch (c)
+    {
+    case 'r':
+      cfg.sample_rate = strtof(optarg, nullptr);
+      break;
+    case 'b':
+      cfg.block_size = strtoul(optarg, nullptr, 10);
+      break;
+    case 'i':
+      cfg.instances = strtoul(optarg, nullptr, 10);
+      break;
+    case 's':
+      cfg.seconds = strtof(optarg, nullptr);
+      break;
+    case 't':
+      cfg.max_threads = strtoul(optarg, nullptr, 10);
+      break;
+    case 'x':
+      cfg.fx = true;
+      break;
+    default:
+      return false;
+    }
+  }
+  return cfg.sample_rate > 0.f && cfg.block_size > 0 && cfg.instances > 0 && cfg.seconds > 0.f;
+}
+
+int main(int argc, char **argv)
+{
+  FarmConfig cfg;
+  if (!ParseArgs(argc, argv, cfg))
+  {
+    Usage(argv[0]);
+    return 1;
+  }
+  size_t max_threads = cfg.max_threads;
+  if (max_threads == 0)
+    max_threads = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+
+  printf("%zu instances x %.1f s at %.0f Hz, block %zu%s\n", cfg.instances, cfg.seconds,
+         cfg.sample_rate, cfg.block_size, cfg.fx ? ", fx on" : "");
+  printf("threads,wall_s,audio_s_per_s,speedup,efficiency\n");
+
+  std::vector<uint64_t> reference(cfg.instances), hashes(cfg.instances);
+  double base_wall = 0.;
+  bool mismatch = false;
+  for (size_t threads = 1;; threads *= 2)
+  {
+    if (threads > max_threads)
+      threads = max_threads;
+    double wall = RenderBatch(cfg, threads, threads == 1 ? reference : hashes);
+    if (threads == 1)
+      base_wall = wall;
+    else if (hashes != reference)
+      mismatch = true;
+    double speedup = base_wall / wall;
+    printf("%zu,%.3f,%.1f,%.2f,%.2f\n", threads, wall, cfg.instances * cfg.seconds / wall,
+           speedup, speedup / threads);
+    if (threads == max_threads)
+      break;
+  }
+  if (mismatch)
+  {
+    fprintf(stderr, "error: output differs between thread counts\n");
+    return 2;
+  }
+  return 0;
+}
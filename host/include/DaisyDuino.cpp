@@ -0,0 +1,669 @@
+#include "DaisyDuino.h"
+#include <mutex>
+#include <time.h>
+
+AudioClass DAISY;
+
+/**
+ * Arduino core
+ */
+static HostPinTable g_shared_pins;
+static thread_local HostPinTable *t_pins = &g_shared_pins;
+
+static inline bool PinValid(int pin)
+{
+  return pin >= 0 && pin < HOST_PIN_COUNT;
+}
+
+void HostBindPinTable(HostPinTable *table)
+{
+  t_pins = table ? table : &g_shared_pins;
+}
+
+void HostSetAnalogPin(int pin, float value)
+{
+  if (PinValid(pin))
+    t_pins->analog[pin] = fclamp(value, 0.f, 1.f);
+}
+
+float HostGetAnalogPin(int pin)
+{
+  return PinValid(pin) ? t_pins->analog[pin] : 0.f;
+}
+
+void HostSetDigitalPin(int pin, bool level)
+{
+  if (PinValid(pin))
+    t_pins->digital[pin] = level;
+}
+
+void pinMode(int pin, int mode)
+{
+  // pull-ups idle high, like the board
+  if (mode == INPUT_PULLUP)
+    HostSetDigitalPin(pin, true);
+}
+
+void digitalWrite(int pin, int value)
+{
+  HostSetDigitalPin(pin, value != 0);
+}
+
+int digitalRead(int pin)
+{
+  return PinValid(pin) ? t_pins->digital[pin] : 0;
+}
+
+int analogRead(int pin)
+{
+  return (int)lroundf(HostGetAnalogPin(pin) * ANALOG_READ_MAX);
+}
+
+static uint64_t MonotonicUs()
+{
+  static uint64_t start = 0;
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  uint64_t now = (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+  if (start == 0)
+    start = now;
+  return now - start;
+}
+
+uint32_t millis()
+{
+  return (uint32_t)(MonotonicUs() / 1000u);
+}
+
+uint32_t micros()
+{
+  return (uint32_t)MonotonicUs();
+}
+
+/**
+ * DaisyDuino audio / board
+ */
+DaisyHardware AudioClass::init(DaisyDuinoDevice device, DaisyDuinoSampleRate sr)
+{
+  // every SynthHardware::Init lands here, possibly from several render threads
+  static std::mutex init_mutex;
+  std::lock_guard<std::mutex> lock(init_mutex);
+  SetAudioSampleRate(sr);
+  DaisyHardware hw;
+  hw.device = device;
+  hw.num_channels = 2;
+  return hw;
+}
+
+void AudioClass::SetAudioSampleRate(DaisyDuinoSampleRate sr)
+{
+  switch (sr)
+  {
+  case AUDIO_SR_8K:
+    sample_rate_ = 8000.f;
+    break;
+  case AUDIO_SR_16K:
+    sample_rate_ = 16000.f;
+    break;
+  case AUDIO_SR_32K:
+    sample_rate_ = 32000.f;
+    break;
+  case AUDIO_SR_96K:
+    sample_rate_ = 96000.f;
+    break;
+  default:
+    sample_rate_ = 48000.f;
+    break;
+  }
+}
+
+/**
+ * DaisyDuino controls
+ */
+void AnalogControl::Init(int pin, float sample_rate, bool flip, bool invert,
+                         float slew_seconds)
+{
+  pin_ = pin;
+  flip_ = flip;
+  invert_ = invert;
+  coeff_ = 1.0f / (slew_seconds * sample_rate * 0.5f);
+  if (coeff_ > 1.f)
+    coeff_ = 1.f;
+  val_ = (float)analogRead(pin_) / ANALOG_READ_MAX;
+}
+
+float AnalogControl::Process()
+{
+  // quantised like the ADC, so recorded traces replay exactly
+  float t = (float)analogRead(pin_) / ANALOG_READ_MAX;
+  if (flip_)
+    t = 1.f - t;
+  if (invert_)
+    t = -t;
+  val_ += coeff_ * (t - val_);
+  return val_;
+}
+
+void Parameter::Init(AnalogControl input, float min, float max, Curve curve)
+{
+  pmin_ = min;
+  pmax_ = max;
+  pcurve_ = curve;
+  in_ = input;
+  lmin_ = logf(min < 0.0000001f ? 0.0000001f : min);
+  lmax_ = logf(max);
+}
+
+float Parameter::Process()
+{
+  float in = in_.Process();
+  switch (pcurve_)
+  {
+  case LINEAR:
+    val_ = (in * (pmax_ - pmin_)) + pmin_;
+    break;
+  case EXPONENTIAL:
+    val_ = ((in * in) * (pmax_ - pmin_)) + pmin_;
+    break;
+  case LOGARITHMIC:
+    val_ = expf((in * (lmax_ - lmin_)) + lmin_);
+    break;
+  case CUBE:
+    val_ = ((in * (in * in)) * (pmax_ - pmin_)) + pmin_;
+    break;
+  default:
+    break;
+  }
+  return val_;
+}
+
+void Switch::Init(float update_rate, bool invert, uint8_t pin, uint8_t mode)
+{
+  (void)update_rate;
+  pin_ = pin;
+  invert_ = invert;
+  state_ = 0;
+  pinMode(pin_, mode);
+}
+
+void Switch::Debounce()
+{
+  bool level = digitalRead(pin_) != 0;
+  if (invert_)
+    level = !level;
+  state_ = (state_ << 1) | (level ? 1 : 0);
+}
+
+/**
+ * DaisySP DSP
+ */
+void Oscillator::Init(float sample_rate)
+{
+  sr_recip_ = 1.0f / sample_rate;
+  freq_ = 100.0f;
+  amp_ = 0.5f;
+  phase_ = 0.0f;
+  phase_inc_ = freq_ * sr_recip_;
+  waveform_ = WAVE_SIN;
+}
+
+float Oscillator::Process()
+{
+  float out;
+  switch (waveform_)
+  {
+  case WAVE_SIN:
+    out = sinf(phase_ * TWOPI_F);
+    break;
+  case WAVE_TRI:
+  {
+    float t = -1.0f + (2.0f * phase_);
+    out = 2.0f * (fabsf(t) - 0.5f);
+    break;
+  }
+  case WAVE_SAW:
+    out = -1.0f * (((phase_ * 2.0f)) - 1.0f);
+    break;
+  case WAVE_RAMP:
+    out = ((phase_ * 2.0f)) - 1.0f;
+    break;
+  case WAVE_SQUARE:
+    out = phase_ < 0.5f ? (1.0f) : -1.0f;
+    break;
+  default:
+    out = 0.0f;
+    break;
+  }
+  phase_ += phase_inc_;
+  if (phase_ > 1.0f)
+    phase_ -= 1.0f;
+  return out * amp_;
+}
+
+// polyBLEP residuals shared by the Plaits-derived oscillators
+static inline float ThisBlepSample(float t)
+{
+  return 0.5f * t * t;
+}
+
+static inline float NextBlepSample(float t)
+{
+  t = 1.0f - t;
+  return -0.5f * t * t;
+}
+
+static inline float NextIntegratedBlepSample(float t)
+{
+  const float t1 = 0.5f * t;
+  const float t2 = t1 * t1;
+  const float t4 = t2 * t2;
+  return 0.1875f - t1 + 1.5f * t2 - t4;
+}
+
+static inline float ThisIntegratedBlepSample(float t)
+{
+  return NextIntegratedBlepSample(1.0f - t);
+}
+
+void VariableShapeOscillator::Init(float sample_rate)
+{
+  sample_rate_ = sample_rate;
+  master_phase_ = 0.0f;
+  slave_phase_ = 0.0f;
+  next_sample_ = 0.0f;
+  previous_pw_ = 0.5f;
+  high_ = false;
+  SetFreq(440.f);
+  SetWaveshape(0.f);
+  SetPW(0.f);
+  SetSync(false);
+  SetSyncFreq(220.f);
+}
+
+void VariableShapeOscillator::SetFreq(float frequency)
+{
+  frequency = frequency / sample_rate_;
+  master_frequency_ = frequency >= .25f ? .25f : frequency;
+}
+
+void VariableShapeOscillator::SetSyncFreq(float frequency)
+{
+  frequency = frequency / sample_rate_;
+  slave_frequency_ = frequency >= .25f ? .25f : frequency;
+}
+
+void VariableShapeOscillator::SetPW(float pw)
+{
+  if (slave_frequency_ >= .25f)
+    pw_ = .5f;
+  else
+    pw_ = fclamp(pw, slave_frequency_ * 2.0f, 1.0f - 2.0f * slave_frequency_);
+}
+
+static inline float ShapeNaiveSample(float phase, float pw, float slope_up,
+                                     float slope_down, float triangle_amount,
+                                     float square_amount)
+{
+  float saw = phase;
+  float square = phase < pw ? 0.0f : 1.0f;
+  float triangle = phase < pw ? phase * slope_up : 1.0f - (phase - pw) * slope_down;
+  saw += (square - saw) * square_amount;
+  saw += (triangle - saw) * triangle_amount;
+  return saw;
+}
+
+float VariableShapeOscillator::Process()
+{
+  float next_sample = next_sample_;
+
+  bool reset = false;
+  bool transition_during_reset = false;
+  float reset_time = 0.0f;
+
+  float this_sample = next_sample;
+  next_sample = 0.0f;
+
+  const float square_amount = fmaxf(waveshape_ - 0.5f, 0.0f) * 2.0f;
+  const float triangle_amount = fmaxf(1.0f - waveshape_ * 2.0f, 0.0f);
+  const float slope_up = 1.0f / (pw_);
+  const float slope_down = 1.0f / (1.0f - pw_);
+
+  if (enable_sync_)
+  {
+    master_phase_ += master_frequency_;
+    if (master_phase_ >= 1.0f)
+    {
+      master_phase_ -= 1.0f;
+      reset_time = master_phase_ / master_frequency_;
+
+      float slave_phase_at_reset = slave_phase_ + (1.0f - reset_time) * slave_frequency_;
+      reset = true;
+      if (slave_phase_at_reset >= 1.0f)
+      {
+        slave_phase_at_reset -= 1.0f;
+        transition_during_reset = true;
+      }
+      if (!high_ && slave_phase_at_reset >= pw_)
+        transition_during_reset = true;
+      float value = ShapeNaiveSample(slave_phase_at_reset, pw_, slope_up, slope_down,
+                                     triangle_amount, square_amount);
+      this_sample -= value * ThisBlepSample(reset_time);
+      next_sample -= value * NextBlepSample(reset_time);
+    }
+  }
+
+  slave_phase_ += slave_frequency_;
+  while (transition_during_reset || !reset)
+  {
+    if (!high_)
+    {
+      if (slave_phase_ < pw_)
+        break;
+      float t = (slave_phase_ - pw_) / (previous_pw_ - pw_ + slave_frequency_);
+      float triangle_step = (slope_up + slope_down) * slave_frequency_;
+      triangle_step *= triangle_amount;
+
+      this_sample += square_amount * ThisBlepSample(t);
+      next_sample += square_amount * NextBlepSample(t);
+      this_sample -= triangle_step * ThisIntegratedBlepSample(t);
+      next_sample -= triangle_step * NextIntegratedBlepSample(t);
+      high_ = true;
+    }
+
+    if (high_)
+    {
+      if (slave_phase_ < 1.0f)
+        break;
+      slave_phase_ -= 1.0f;
+      float t = slave_phase_ / slave_frequency_;
+      float triangle_step = (slope_up + slope_down) * slave_frequency_;
+      triangle_step *= triangle_amount;
+
+      this_sample -= (1.0f - triangle_amount) * ThisBlepSample(t);
+      next_sample -= (1.0f - triangle_amount) * NextBlepSample(t);
+      this_sample += triangle_step * ThisIntegratedBlepSample(t);
+      next_sample += triangle_step * NextIntegratedBlepSample(t);
+      high_ = false;
+    }
+  }
+
+  if (enable_sync_ && reset)
+  {
+    slave_phase_ = reset_time * slave_frequency_;
+    high_ = false;
+  }
+
+  next_sample += ShapeNaiveSample(slave_phase_, pw_, slope_up, slope_down,
+                                  triangle_amount, square_amount);
+  previous_pw_ = pw_;
+
+  next_sample_ = next_sample;
+  return (2.0f * this_sample - 1.0f);
+}
+
+static const float kVariableSawNotchDepth = 0.2f;
+
+void VariableSawOscillator::Init(float sample_rate)
+{
+  sample_rate_ = sample_rate;
+  phase_ = 0.0f;
+  next_sample_ = 0.0f;
+  previous_pw_ = 0.5f;
+  high_ = false;
+  SetFreq(220.f);
+  SetPW(0.f);
+  SetWaveshape(1.f);
+}
+
+void VariableSawOscillator::SetFreq(float frequency)
+{
+  frequency = frequency / sample_rate_;
+  frequency_ = fclamp(frequency, 0.0000001f, 0.25f);
+}
+
+static inline float SawNaiveSample(float phase, float pw, float slope_up,
+                                   float slope_down, float triangle_amount,
+                                   float notch_amount)
+{
+  float notch_saw = phase < pw ? phase : phase + kVariableSawNotchDepth;
+  float triangle = phase < pw ? phase * slope_up : 1.0f - (phase - pw) * slope_down;
+  return notch_saw * notch_amount + triangle * triangle_amount;
+}
+
+float VariableSawOscillator::Process()
+{
+  float next_sample = next_sample_;
+  float this_sample = next_sample;
+  next_sample = 0.0f;
+
+  const float frequency = frequency_;
+  const float pw = fclamp(pw_, frequency * 2.0f, 1.0f - 2.0f * frequency);
+  const float triangle_amount = waveshape_;
+  const float notch_amount = 1.0f - waveshape_;
+  const float slope_up = 1.0f / pw;
+  const float slope_down = 1.0f / (1.0f - pw);
+
+  phase_ += frequency;
+
+  if (!high_ && phase_ >= pw)
+  {
+    const float triangle_step = (slope_up + slope_down) * frequency * triangle_amount;
+    const float notch = kVariableSawNotchDepth * notch_amount;
+    const float t = (phase_ - pw) / (previous_pw_ - pw + frequency);
+    this_sample += notch * ThisBlepSample(t);
+    next_sample += notch * NextBlepSample(t);
+    this_sample -= triangle_step * ThisIntegratedBlepSample(t);
+    next_sample -= triangle_step * NextIntegratedBlepSample(t);
+    high_ = true;
+  }
+  else if (phase_ >= 1.0f)
+  {
+    phase_ -= 1.0f;
+    const float triangle_step = (slope_up + slope_down) * frequency * triangle_amount;
+    const float notch = (kVariableSawNotchDepth + 1.0f) * notch_amount;
+    const float t = phase_ / frequency;
+    this_sample -= notch * ThisBlepSample(t);
+    next_sample -= notch * NextBlepSample(t);
+    this_sample += triangle_step * ThisIntegratedBlepSample(t);
+    next_sample += triangle_step * NextIntegratedBlepSample(t);
+    high_ = false;
+  }
+
+  next_sample += SawNaiveSample(phase_, pw, slope_up, slope_down, triangle_amount,
+                                notch_amount);
+  previous_pw_ = pw;
+
+  next_sample_ = next_sample;
+  return (2.0f * this_sample - 1.0f) / (1.0f + kVariableSawNotchDepth);
+}
+
+static const int kLadderInterpolation = 2;
+static const float kLadderInterpolationRecip = 1.0f / kLadderInterpolation;
+
+void MoogLadder::Init(float sample_rate)
+{
+  sample_rate_ = sample_rate;
+  alpha_ = 1.0f;
+  K_ = 1.0f;
+  Fbase_ = 1000.0f;
+  Qadjust_ = 1.0f;
+  pbg_ = 0.5f;
+  oldinput_ = 0.f;
+  for (int i = 0; i < 4; i++)
+    z0_[i] = z1_[i] = 0.f;
+  SetFreq(5000.f);
+  SetRes(0.2f);
+}
+
+float MoogLadder::LPF(float s, int i)
+{
+  float ft = s * (1.0f / 1.3f) + (0.3f / 1.3f) * z0_[i] - z1_[i];
+  ft = ft * alpha_ + z1_[i];
+  z1_[i] = ft;
+  z0_[i] = s;
+  return ft;
+}
+
+float MoogLadder::Process(float in)
+{
+  float total = 0.0f;
+  float interp = 0.0f;
+  for (int os = 0; os < kLadderInterpolation; os++)
+  {
+    float u = (interp * oldinput_ + (1.0f - interp) * in) - (z1_[3] - pbg_ * in) * K_ * Qadjust_;
+    u = tanhf(u);
+    float stage1 = LPF(u, 0);
+    float stage2 = LPF(stage1, 1);
+    float stage3 = LPF(stage2, 2);
+    float stage4 = LPF(stage3, 3);
+    total += stage4 * kLadderInterpolationRecip;
+    interp += kLadderInterpolationRecip;
+  }
+  oldinput_ = in;
+  return total;
+}
+
+void MoogLadder::SetFreq(float freq)
+{
+  Fbase_ = freq;
+  float fc = fminf(Fbase_, sample_rate_ * 0.45f);
+  float wc = fc * TWOPI_F / (kLadderInterpolation * sample_rate_);
+  float wc2 = wc * wc;
+  alpha_ = 0.9892f * wc - 0.4324f * wc2 + 0.1381f * wc * wc2 - 0.0202f * wc2 * wc2;
+  Qadjust_ = 1.006f + 0.0536f * wc - 0.095f * wc2 - 0.05f * wc2 * wc2;
+}
+
+void MoogLadder::SetRes(float res)
+{
+  K_ = 4.0f * fclamp(res, 0.f, 1.f);
+}
+
+void Adsr::Init(float sample_rate, int blockSize)
+{
+  sample_rate_ = sample_rate / blockSize;
+  attackShape_ = -1.f;
+  attackTarget_ = 0.0f;
+  attackTime_ = -1.f;
+  decayTime_ = -1.f;
+  releaseTime_ = -1.f;
+  sus_level_ = 0.7f;
+  x_ = 0.0f;
+  gate_ = false;
+  mode_ = ADSR_SEG_IDLE;
+
+  SetTime(ADSR_SEG_ATTACK, 0.1f);
+  SetTime(ADSR_SEG_DECAY, 0.1f);
+  SetTime(ADSR_SEG_RELEASE, 0.1f);
+}
+
+void Adsr::Retrigger(bool hard)
+{
+  mode_ = ADSR_SEG_ATTACK;
+  if (hard)
+    x_ = 0.f;
+}
+
+void Adsr::SetTime(int seg, float time)
+{
+  switch (seg)
+  {
+  case ADSR_SEG_ATTACK:
+    SetAttackTime(time, 0.0f);
+    break;
+  case ADSR_SEG_DECAY:
+    SetTimeConstant(time, decayTime_, decayD0_);
+    break;
+  case ADSR_SEG_RELEASE:
+    SetTimeConstant(time, releaseTime_, releaseD0_);
+    break;
+  default:
+    return;
+  }
+}
+
+void Adsr::SetAttackTime(float timeInS, float shape)
+{
+  if ((timeInS != attackTime_) || (shape != attackShape_))
+  {
+    attackTime_ = timeInS;
+    attackShape_ = shape;
+    if (timeInS > 0.f)
+    {
+      float x = shape;
+      float target = 9.f * powf(x, 10.f) + 0.3f * x + 1.01f;
+      attackTarget_ = target;
+      float logTarget = logf(1.f - (1.f / target));
+      attackD0_ = 1.f - expf(logTarget / (timeInS * sample_rate_));
+    }
+    else
+      attackD0_ = 1.f;
+  }
+}
+
+void Adsr::SetTimeConstant(float timeInS, float &time, float &coeff)
+{
+  if (timeInS != time)
+  {
+    time = timeInS;
+    if (time > 0.f)
+    {
+      const float target = logf(1. / M_E);
+      coeff = 1.f - expf(target / (time * sample_rate_));
+    }
+    else
+      coeff = 1.f;
+  }
+}
+
+void Adsr::SetSustainLevel(float sus_level)
+{
+  sus_level = (sus_level <= 0.f) ? -0.01f : (sus_level > 1.f) ? 1.f : sus_level;
+  sus_level_ = sus_level;
+}
+
+float Adsr::Process(bool gate)
+{
+  float out = 0.0f;
+
+  if (gate && !gate_)
+    mode_ = ADSR_SEG_ATTACK;
+  else if (!gate && gate_)
+    mode_ = ADSR_SEG_RELEASE;
+  gate_ = gate;
+
+  float D0 = attackD0_;
+  if (mode_ == ADSR_SEG_DECAY)
+    D0 = decayD0_;
+  else if (mode_ == ADSR_SEG_RELEASE)
+    D0 = releaseD0_;
+
+  float target = mode_ == ADSR_SEG_DECAY ? sus_level_ : -0.01f;
+  switch (mode_)
+  {
+  case ADSR_SEG_IDLE:
+    out = 0.0f;
+    break;
+  case ADSR_SEG_ATTACK:
+    x_ += D0 * (attackTarget_ - x_);
+    out = x_;
+    if (out > 1.f)
+    {
+      x_ = out = 1.f;
+      mode_ = ADSR_SEG_DECAY;
+    }
+    break;
+  case ADSR_SEG_DECAY:
+  case ADSR_SEG_RELEASE:
+    x_ += D0 * (target - x_);
+    out = x_;
+    if (out < 0.0f)
+    {
+      x_ = out = 0.f;
+      mode_ = ADSR_SEG_IDLE;
+    }
+    break;
+  default:
+    break;
+  }
+  return out;
+}
@@ -0,0 +1,310 @@
+// DaisyDuino.h (host stand-in)
+#pragma once
+/**
+ * Host-side stand-in for the subset of DaisyDuino / DaisySP used by the
+ * firmware, so the DSP sources in src/ compile unmodified on Linux.
+ *
+ * The DSP classes follow the DaisySP algorithms closely enough for timing and
+ * spectral measurements; they are not meant to be bit-exact with the board.
+ * Pots and switches read from a host-side pin table that tools fill in with
+ * HostSetAnalogPin() / HostSetDigitalPin().
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef uint8_t byte;
+
+#ifndef PI_F
+#define PI_F 3.1415927410125732421875f
+#endif
+#ifndef TWOPI_F
+#define TWOPI_F (2.0f * PI_F)
+#endif
+
+/**
+ * Arduino core
+ */
+enum
+{
+  A0 = 100, A1, A2, A3, A4, A5, A6, A7, A8, A9, A10, A11,
+};
+enum
+{
+  D0 = 0, D1, D2, D3, D4, D5, D6, D7, D8, D9, D10, D11, D12, D13, D14, D15,
+  D16, D17, D18, D19, D20, D21, D22, D23, D24, D25, D26, D27, D28, D29, D30,
+};
+#define LED_BUILTIN 200
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define HIGH 1
+#define LOW 0
+
+#define HOST_PIN_COUNT 256
+// analogRead() full scale, the core's default 10-bit resolution
+#define ANALOG_READ_MAX 1023
+
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int value);
+int digitalRead(int pin);
+int analogRead(int pin);
+uint32_t millis();
+uint32_t micros();
+
+template <typename T>
+static inline T max(T a, T b) { return (a > b) ? a : b; }
+template <typename T>
+static inline T min(T a, T b) { return (a < b) ? a : b; }
+
+// host-only pin injection (pots are normalised 0..1, switches are raw levels)
+void HostSetAnalogPin(int pin, float value);
+float HostGetAnalogPin(int pin);
+void HostSetDigitalPin(int pin, bool level);
+
+// a full set of pins; every thread reads a shared default table unless it
+// binds its own, so parallel renders each get an independent panel
+struct HostPinTable
+{
+  float analog[HOST_PIN_COUNT];
+  bool digital[HOST_PIN_COUNT];
+};
+void HostBindPinTable(HostPinTable *table); // nullptr = back to the shared table
+
+/**
+ * DaisySP helpers
+ */
+static inline float fclamp(float in, float min, float max)
+{
+  return fminf(fmaxf(in, min), max);
+}
+
+static inline float mtof(float m)
+{
+  return powf(2.f, (m - 69.0f) / 12.0f) * 440.0f;
+}
+
+/**
+ * DaisyDuino audio / board
+ */
+// no external SDRAM on the host, plain .bss does
+#define DSY_SDRAM_BSS
+
+enum DaisyDuinoDevice
+{
+  DAISY_SEED,
+  DAISY_POD,
+  DAISY_PETAL,
+  DAISY_FIELD,
+  DAISY_PATCH,
+};
+
+enum DaisyDuinoSampleRate
+{
+  AUDIO_SR_8K,
+  AUDIO_SR_16K,
+  AUDIO_SR_32K,
+  AUDIO_SR_48K,
+  AUDIO_SR_96K,
+};
+
+typedef void (*DaisyDuinoCallback)(float **in, float **out, size_t size);
+
+struct DaisyHardware
+{
+  DaisyDuinoDevice device;
+  int num_channels;
+};
+
+class AudioClass
+{
+public:
+  DaisyHardware init(DaisyDuinoDevice device, DaisyDuinoSampleRate sr);
+  void begin(DaisyDuinoCallback cb) { callback_ = cb; }
+  void end() { callback_ = nullptr; }
+  float get_samplerate() const { return sample_rate_; }
+  float AudioSampleRate() const { return sample_rate_; }
+  void SetAudioSampleRate(DaisyDuinoSampleRate sr);
+  void SetAudioBlockSize(size_t size) { block_size_ = size; }
+  size_t AudioBlockSize() const { return block_size_; }
+
+  // host-only: the registered callback, for drivers that run it
+  DaisyDuinoCallback Callback() const { return callback_; }
+
+private:
+  float sample_rate_ = 48000.f;
+  size_t block_size_ = 48;
+  DaisyDuinoCallback callback_ = nullptr;
+};
+
+extern AudioClass DAISY;
+
+/**
+ * DaisyDuino controls
+ */
+class AnalogControl
+{
+public:
+  void Init(int pin, float sample_rate, bool flip = false, bool invert = false,
+            float slew_seconds = 0.002f);
+  float Process();
+  float Value() const { return val_; }
+
+private:
+  int pin_ = 0;
+  float coeff_ = 1.f;
+  float val_ = 0.f;
+  bool flip_ = false, invert_ = false;
+};
+
+class Parameter
+{
+public:
+  enum Curve
+  {
+    LINEAR,
+    EXPONENTIAL,
+    LOGARITHMIC,
+    CUBE,
+    LAST,
+  };
+  void Init(AnalogControl input, float min, float max, Curve curve);
+  float Process();
+  float Value() const { return val_; }
+
+private:
+  AnalogControl in_;
+  float pmin_ = 0.f, pmax_ = 1.f, lmin_ = 0.f, lmax_ = 0.f;
+  float val_ = 0.f;
+  Curve pcurve_ = LINEAR;
+};
+
+class Switch
+{
+public:
+  void Init(float update_rate, bool invert, uint8_t pin, uint8_t mode);
+  void Debounce();
+  bool Pressed() const { return state_ == 0xff; }
+  bool RisingEdge() const { return state_ == 0x7f; }
+  bool FallingEdge() const { return state_ == 0x80; }
+
+private:
+  uint8_t pin_ = 0;
+  uint8_t state_ = 0;
+  bool invert_ = false;
+};
+
+/**
+ * DaisySP DSP
+ */
+class Oscillator
+{
+public:
+  enum
+  {
+    WAVE_SIN,
+    WAVE_TRI,
+    WAVE_SAW,
+    WAVE_RAMP,
+    WAVE_SQUARE,
+    WAVE_LAST,
+  };
+  void Init(float sample_rate);
+  void SetFreq(float f) { freq_ = f; phase_inc_ = f * sr_recip_; }
+  void SetAmp(float a) { amp_ = a; }
+  void SetWaveform(uint8_t wf) { waveform_ = wf < WAVE_LAST ? wf : (uint8_t)WAVE_SIN; }
+  void Reset(float phase = 0.0f) { phase_ = phase; }
+  float Process();
+
+private:
+  uint8_t waveform_ = WAVE_SIN;
+  float amp_ = 1.f, freq_ = 100.f;
+  float sr_recip_ = 1.f / 48000.f;
+  float phase_ = 0.f, phase_inc_ = 0.f;
+};
+
+class VariableShapeOscillator
+{
+public:
+  void Init(float sample_rate);
+  float Process();
+  void SetFreq(float frequency);
+  void SetPW(float pw);
+  void SetWaveshape(float waveshape) { waveshape_ = waveshape; }
+  void SetSync(bool enable_sync) { enable_sync_ = enable_sync; }
+  void SetSyncFreq(float frequency);
+
+private:
+  float sample_rate_ = 48000.f;
+  bool enable_sync_ = false;
+  float master_phase_ = 0.f, slave_phase_ = 0.f;
+  float next_sample_ = 0.f;
+  float previous_pw_ = 0.5f;
+  bool high_ = false;
+  float master_frequency_ = 0.f, slave_frequency_ = 0.f;
+  float pw_ = 0.5f, waveshape_ = 0.f;
+};
+
+class VariableSawOscillator
+{
+public:
+  void Init(float sample_rate);
+  float Process();
+  void SetFreq(float frequency);
+  void SetPW(float pw) { pw_ = fclamp(pw, 0.f, 1.f); }
+  void SetWaveshape(float waveshape) { waveshape_ = fclamp(waveshape, 0.f, 1.f); }
+
+private:
+  float sample_rate_ = 48000.f;
+  float phase_ = 0.f, next_sample_ = 0.f, previous_pw_ = 0.5f;
+  bool high_ = false;
+  float frequency_ = 0.01f, pw_ = 0.5f, waveshape_ = 0.f;
+};
+
+class MoogLadder
+{
+public:
+  void Init(float sample_rate);
+  float Process(float in);
+  void SetFreq(float freq);
+  void SetRes(float res);
+
+private:
+  float sample_rate_ = 48000.f;
+  float alpha_ = 1.f, K_ = 1.f, Fbase_ = 1000.f, Qadjust_ = 1.f, pbg_ = 0.5f;
+  float oldinput_ = 0.f;
+  float z0_[4] = {}, z1_[4] = {};
+  float LPF(float s, int i);
+};
+
+enum
+{
+  ADSR_SEG_IDLE = 0,
+  ADSR_SEG_ATTACK = 1,
+  ADSR_SEG_DECAY = 2,
+  ADSR_SEG_RELEASE = 4,
+};
+
+class Adsr
+{
+public:
+  void Init(float sample_rate, int blockSize = 1);
+  void Retrigger(bool hard);
+  float Process(bool gate);
+  void SetTime(int seg, float time);
+  void SetAttackTime(float timeInS, float shape = 0.0f);
+  void SetSustainLevel(float sus_level);
+  uint8_t GetCurrentSegment() { return mode_; }
+  bool IsRunning() const { return mode_ != ADSR_SEG_IDLE; }
+
+private:
+  void SetTimeConstant(float timeInS, float &time, float &coeff);
+  float sus_level_ = 0.7f, x_ = 0.f;
+  float attackShape_ = -1.f, attackTarget_ = 0.f;
+  float attackTime_ = -1.f, decayTime_ = -1.f, releaseTime_ = -1.f;
+  float attackD0_ = 0.f, decayD0_ = 0.f, releaseD0_ = 0.f;
+  float sample_rate_ = 48000.f;
+  uint8_t mode_ = ADSR_SEG_IDLE;
+  bool gate_ = false;
+};
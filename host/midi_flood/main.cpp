@@ -0,0 +1,596 @@
+/**
+ * MIDI flood harness (host only).
+ *
+ * Feeds synthetic MIDI into a model of the sketch's loop() at up to the
+ * full rate of the link and measures what the bounded parsing (MidiPump)
+ * does with it: messages lost to a full UART buffer, messages handled
+ * late, and how long UpdateControls() waits behind the parser.
+ *
+ * Runs in virtual time, so results do not depend on the host:
+ * - the link delivers bytes on its own schedule, DIN one byte every
+ *   320 us (31250 baud, 10 bits), USB up to 16 messages per 1 ms frame,
+ *   into a ring of --rx-bytes bytes that drops what does not fit;
+ * - a loop() pass costs --pass-us (UpdateControls, SetParams, telemetry)
+ *   plus --byte-us per byte parsed and --msg-us per handled message,
+ *   stretched by the share of the CPU the audio callback takes (--load);
+ * - the parser is the MIDI library's: one byte per read(), running status,
+ *   realtime bytes complete on their own. Handlers go to a real
+ *   VoiceManager, as in the sketch.
+ *
+ * --budget N runs one configuration (0 = drain all), --legacy the old
+ * single read() per pass; --sweep runs legacy, 1, 2, 4 ... 32 and 0.
+ *
+ *   program --link din --pattern notes --running-status --sweep
+ */
+#include "DaisyDuino.h"
+#include "VoiceManager.h"
+#include "MidiPump.h"
+
+#include <algorithm>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+enum Link
+{
+  LINK_DIN,
+  LINK_USB,
+};
+
+enum Pattern
+{
+  PATTERN_NOTES, // arpeggio: note-on of the next note, note-off of the last
+  PATTERN_CC,    // CC sweeps, half of them to a handled FX send
+  PATTERN_CLOCK, // 0xF8 timing clock only
+  PATTERN_MIXED, // notes with clock and CCs in between
+};
+
+struct FloodConfig
+{
+  Link link = LINK_DIN;
+  Pattern pattern = PATTERN_NOTES;
+  // messages per second, 0 = as fast as the link goes
+  float rate = 0.f;
+  float seconds = 5.f;
+  bool running_status = false;
+  size_t rx_bytes = MIDI_RX_BUFFER;
+  int budget = MIDI_PASS_BUDGET; // -1 = legacy, one read() per pass
+  bool sweep = false;
+  // loop() costs, microseconds on the board
+  float pass_us = 150.f;
+  float byte_us = 1.f;
+  float msg_us = 4.f;
+  // share of the CPU taken by the audio callback
+  float load = 0.5f;
+  // thresholds for "late" and "starved"
+  float late_ms = 1.f;
+  float starve_ms = 2.f;
+};
+
+/**
+ * synthetic sender
+ */
+struct Message
+{
+  uint8_t bytes[MIDI_MAX_MESSAGE_BYTES];
+  uint8_t len;
+};
+
+class Generator
+{
+public:
+  Generator(Pattern pattern, bool running_status) : pattern_(pattern), running_(running_status) {}
+
+  Message Next()
+  {
+    Message m;
+    switch (pattern_)
+    {
+    case PATTERN_NOTES:
+      m = NoteStep();
+      break;
+    case PATTERN_CC:
+      m = Cc();
+      break;
+    case PATTERN_CLOCK:
+      m = Clock();
+      break;
+    default:
+      // a clock every 4th message, a CC every 8th, notes otherwise
+      m = (count_ % 4 == 3) ? Clock() : (count_ % 8 == 5) ? Cc() : NoteStep();
+      break;
+    }
+    count_++;
+    return m;
+  }
+
+private:
+  Message Channel(uint8_t status, uint8_t d1, uint8_t d2)
+  {
+    Message m;
+    m.len = 0;
+    if (!running_ || status != last_status_)
+      m.bytes[m.len++] = status;
+    m.bytes[m.len++] = d1;
+    m.bytes[m.len++] = d2;
+    last_status_ = status;
+    return m;
+  }
+  Message NoteStep()
+  {
+    // note-on with velocity 0 for the off, so running status applies
+    static const uint8_t ARP[] = {48, 55, 60, 63, 67, 72, 67, 63, 60, 55};
+    if (note_on_)
+    {
+      note_on_ = false;
+      return Channel(0x90, ARP[arp_ % sizeof(ARP)], 0);
+    }
+    note_on_ = true;
+    arp_++;
+    return Channel(0x90, ARP[arp_ % sizeof(ARP)], 100);
+  }
+  Message Cc()
+  {
+    cc_value_ = (cc_value_ + 1) & 0x7f;
+    return Channel(0xB0, (cc_value_ & 1) ? 1 : 91, cc_value_);
+  }
+  Message Clock()
+  {
+    // realtime: does not touch running status
+    Message m;
+    m.bytes[0] = 0xF8;
+    m.len = 1;
+    return m;
+  }
+
+  Pattern pattern_;
+  bool running_;
+  uint8_t last_status_ = 0;
+  bool note_on_ = false;
+  size_t arp_ = 0, count_ = 0;
+  uint8_t cc_value_ = 0;
+};
+
+/**
+ * the sketch's handlers, minus the LED and the trace
+ */
+static VoiceManager g_vm;
+
+static void Dispatch(uint8_t status, uint8_t d1, uint8_t d2)
+{
+  byte ch = (status & 0x0f) + 1;
+  switch (status & 0xf0)
+  {
+  case 0x90:
+    if (d2 == 0)
+      g_vm.NoteOff(ch, d1, d2);
+    else
+      g_vm.NoteOn(ch, d1, d2);
+    break;
+  case 0x80:
+    g_vm.NoteOff(ch, d1, d2);
+    break;
+  case 0xB0:
+    g_vm.ControlChange(ch, d1, d2);
+    break;
+  default:
+    break;
+  }
+}
+
+// byte-at-a-time parser, like the MIDI library with 1-byte parsing
+class Parser
+{
+public:
+  // true when `b` completed a message; `realtime` tells which kind
+  bool Feed(uint8_t b, bool &realtime)
+  {
+    realtime = false;
+    if (b >= 0xF8)
+    {
+      realtime = true;
+      return true;
+    }
+    if (b & 0x80)
+    {
+      // system common / sysex are not generated, they only reset the state
+      status_ = b < 0xF0 ? b : 0;
+      index_ = 0;
+      return false;
+    }
+    if (!status_)
+      return false;
+    data_[index_++] = b;
+    if (index_ < Length(status_))
+      return false;
+    index_ = 0;
+    Dispatch(status_, data_[0], data_[1]);
+    return true;
+  }
+
+private:
+  static uint8_t Length(uint8_t status)
+  {
+    uint8_t kind = status & 0xf0;
+    return (kind == 0xC0 || kind == 0xD0) ? 1 : 2;
+  }
+  uint8_t status_ = 0;
+  uint8_t data_[2] = {0, 0};
+  uint8_t index_ = 0;
+};
+
+/**
+ * one run
+ */
+struct RxByte
+{
+  uint8_t value;
+  bool last;   // completes its message
+  size_t msg;  // index into the sent messages
+};
+
+struct FloodStats
+{
+  size_t sent = 0, handled = 0, lost_bytes = 0, corrupt = 0;
+  size_t in_flight = 0; // still in the buffer or on the wire at the end
+  size_t passes = 0;
+  size_t late = 0, starved = 0;
+  std::vector<double> latency_ms;  // last byte in the buffer -> handler
+  std::vector<double> controls_ms; // UpdateControls to UpdateControls
+  uint32_t overflows = 0, deferred = 0;
+  uint16_t max_per_pass = 0;
+};
+
+class Flood
+{
+public:
+  Flood(const FloodConfig &cfg) : cfg_(cfg), gen_(cfg.pattern, cfg.running_status)
+  {
+    // USB: nothing arrives before the end of the first frame
+    if (cfg.link == LINK_USB)
+      link_t_ = frame_t_;
+  }
+
+  FloodStats Run()
+  {
+    g_vm.Init(48000.f);
+    pump_.Init(cfg_.budget < 0 ? 1 : (uint16_t)cfg_.budget, cfg_.rx_bytes);
+    const double end = cfg_.seconds * 1e6;
+    const double stretch = 1.0 / (1.0 - std::min(cfg_.load, 0.95f));
+    double last_controls = 0.0;
+    while (now_ < end)
+    {
+      Deliver();
+      if (cfg_.budget < 0)
+      {
+        // old loop(): one MIDI.read(), one byte
+        if (rx_.size() + 1 >= cfg_.rx_bytes)
+          st_.overflows++;
+        if (!rx_.empty())
+          ReadByte(stretch);
+      }
+      else
+      {
+        pump_.Pump([&] { return ReadByte(stretch); },
+                   [&] {
+                     // with no budget a flood can keep the pass going to the end
+                     if (now_ >= end)
+                       return (size_t)0;
+                     Deliver();
+                     return rx_.size();
+                   });
+      }
+      double gap = (now_ - last_controls) / 1e3;
+      st_.controls_ms.push_back(gap);
+      if (gap > cfg_.starve_ms)
+        st_.starved++;
+      last_controls = now_;
+      now_ += cfg_.pass_us * stretch;
+      st_.passes++;
+    }
+    st_.sent = sent_.size();
+    for (const RxByte &b : rx_)
+      st_.in_flight += b.last ? 1 : 0;
+    st_.in_flight += pos_ ? 1 : 0;
+    if (cfg_.budget >= 0)
+    {
+      st_.overflows = pump_.Overflows();
+      st_.deferred = pump_.Deferred();
+      st_.max_per_pass = pump_.MaxPerPass();
+    }
+    return st_;
+  }
+
+private:
+  // the link's schedule: bytes that have arrived by now_ go into the ring
+  void Deliver()
+  {
+    while (NextArrival() <= now_)
+    {
+      if (pos_ == 0)
+        Send();
+      const Message &m = sent_.back();
+      RxByte b = {m.bytes[pos_], pos_ + 1 == m.len, sent_.size() - 1};
+      // the UART keeps one slot of its ring free
+      if (rx_.size() + 1 < cfg_.rx_bytes)
+        rx_.push_back(b);
+      else
+      {
+        st_.lost_bytes++;
+        damaged_[b.msg] = true;
+      }
+      if (b.last)
+        arrived_[b.msg] = link_t_;
+      link_t_ += ByteTime();
+      if (++pos_ == m.len)
+      {
+        pos_ = 0;
+        Pace();
+      }
+    }
+  }
+
+  double NextArrival() const { return link_t_; }
+
+  void Send()
+  {
+    sent_.push_back(gen_.Next());
+    arrived_.push_back(0.0);
+    damaged_.push_back(false);
+  }
+
+  // time between two bytes of the link, microseconds
+  double ByteTime()
+  {
+    if (cfg_.link == LINK_DIN)
+      return 320.0;
+    // USB: one 4-byte event per message, 16 per 1 ms frame; the bytes of a
+    // frame arrive together at its end
+    return 0.0;
+  }
+
+  // where the next message starts: the rate limit, then the link's own
+  void Pace()
+  {
+    if (cfg_.link == LINK_USB)
+    {
+      if (++frame_msgs_ == 16)
+      {
+        frame_msgs_ = 0;
+        frame_t_ += 1000.0;
+      }
+      link_t_ = std::max(link_t_, frame_t_);
+    }
+    if (cfg_.rate > 0.f)
+    {
+      rate_t_ += 1e6 / cfg_.rate;
+      link_t_ = std::max(link_t_, rate_t_);
+      if (cfg_.link == LINK_USB)
+      {
+        // a paced message waits for the next frame
+        double frame = 1000.0 * (uint64_t)((link_t_ + 999.999) / 1000.0);
+        if (frame > frame_t_)
+        {
+          frame_t_ = frame;
+          frame_msgs_ = 0;
+        }
+        link_t_ = frame_t_;
+      }
+    }
+  }
+
+  bool ReadByte(double stretch)
+  {
+    if (rx_.empty())
+      return false;
+    RxByte b = rx_.front();
+    rx_.erase(rx_.begin());
+    now_ += cfg_.byte_us * stretch;
+    bool realtime;
+    if (!parser_.Feed(b.value, realtime))
+      return false;
+    if (!realtime)
+      now_ += cfg_.msg_us * stretch;
+    // a message counts when it completes on its own last byte, untouched
+    if (b.last && !damaged_[b.msg])
+    {
+      st_.handled++;
+      double ms = (now_ - arrived_[b.msg]) / 1e3;
+      st_.latency_ms.push_back(ms);
+      if (ms > cfg_.late_ms)
+        st_.late++;
+    }
+    else
+      st_.corrupt++;
+    return true;
+  }
+
+  const FloodConfig &cfg_;
+  Generator gen_;
+  Parser parser_;
+  MidiPump pump_;
+  FloodStats st_;
+  std::vector<RxByte> rx_;
+  std::vector<Message> sent_;
+  std::vector<double> arrived_;
+  std::vector<bool> damaged_;
+  double now_ = 0.0;
+  double link_t_ = 0.0, rate_t_ = 0.0, frame_t_ = 1000.0;
+  size_t pos_ = 0;
+  int frame_msgs_ = 0;
+};
+
+static double Percentile(std::vector<double> v, double pct)
+{
+  if (v.empty())
+    return 0.0;
+  std::sort(v.begin(), v.end());
+  size_t idx = (size_t)(pct / 100.0 * (v.size() - 1) + 0.5);
+  return v[idx];
+}
+
+static void PrintHeader()
+{
+  printf("%-7s %8s %8s %7s %7s %7s %7s %8s %8s %8s %7s %8s %8s %7s\n", "budget", "sent",
+         "handled", "lost", "corrupt", "ovflow", "defer", "lat_p50", "lat_p99", "lat_max",
+         "late", "ctl_p99", "ctl_max", "starved");
+}
+
+static void PrintRow(const FloodConfig &cfg, const FloodStats &st)
+{
+  char name[16];
+  if (cfg.budget < 0)
+    snprintf(name, sizeof(name), "legacy");
+  else if (cfg.budget == 0)
+    snprintf(name, sizeof(name), "all");
+  else
+    snprintf(name, sizeof(name), "%d", cfg.budget);
+  size_t lost = st.sent - st.handled - st.in_flight;
+  printf("%-7s %8zu %8zu %7zu %7zu %7u %7u %8.2f %8.2f %8.2f %7zu %8.2f %8.2f %7zu\n", name,
+         st.sent, st.handled, lost, st.corrupt, st.overflows, st.deferred,
+         Percentile(st.latency_ms, 50), Percentile(st.latency_ms, 99),
+         Percentile(st.latency_ms, 100), st.late, Percentile(st.controls_ms, 99),
+         Percentile(st.controls_ms, 100), st.starved);
+}
+
+static void Usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [--link din|usb] [--pattern notes|cc|clock|mixed] [--rate MSG_PER_S]\n"
+          "          [--running-status] [--seconds S] [--rx-bytes N]\n"
+          "          [--budget N | --legacy | --sweep] [--pass-us US] [--byte-us US]\n"
+          "          [--msg-us US] [--load F] [--late-ms MS] [--starve-ms MS]\n",
+          argv0);
+}
+
+static bool ParseArgs(int argc, char **argv, FloodConfig &cfg)
+{
+  static const option opts[] = {
+      {"link", required_argument, nullptr, 'l'},
+      {"pattern", required_argument, nullptr, 'p'},
+      {"rate", required_argument, nullptr, 'r'},
+      {"running-status", no_argument, nullptr, 'R'},
+      {"seconds", required_argument, nullptr, 's'},
+      {"rx-bytes", required_argument, nullptr, 'x'},
+      {"budget", required_argument, nullptr, 'b'},
+      {"legacy", no_argument, nullptr, 'L'},
+      {"sweep", no_argument, nullptr, 'S'},
+      {"pass-us", required_argument, nullptr, 'P'},
+      {"byte-us", required_argument, nullptr, 'B'},
+      {"msg-us", required_argument, nullptr, 'M'},
+      {"load", required_argument, nullptr, 'o'},
+      {"late-ms", required_argument, nullptr, 't'},
+      {"starve-ms", required_argument, nullptr, 'v'},
+      {nullptr, 0, nullptr, 0},
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "", opts, nullptr)) != -1)
+  {
+    switch (c)
+    {
+    case 'l':
+      if (strcmp(optarg, "din") == 0)
+        cfg.link = LINK_DIN;
+      else if (strcmp(optarg, "usb") == 0)
+        cfg.link = LINK_USB;
+      else
+        return false;
+      break;
+    case 'p':
+      if (strcmp(optarg, "notes") == 0)
+        cfg.pattern = PATTERN_NOTES;
+      else if (strcmp(optarg, "cc") == 0)
+        cfg.pattern = PATTERN_CC;
+      else if (strcmp(optarg, "clock") == 0)
+        cfg.pattern = PATTERN_CLOCK;
+      else if (strcmp(optarg, "mixed") == 0)
+        cfg.pattern = PATTERN_MIXED;
+      else
+        return false;
+      break;
+    case 'r':
+      cfg.rate = strtof(optarg, nullptr);
+      break;
+    case 'R':
+      cfg.running_status = true;
+      break;
+    case 's':
+      cfg.seconds = strtof(optarg, nullptr);
+      break;
+    case 'x':
+      cfg.rx_bytes = strtoul(optarg, nullptr, 10);
+      break;
+    case 'b':
+      cfg.budget = atoi(optarg);
+      break;
+    case 'L':
+      cfg.budget = -1;
+      break;
+    case 'S':
+      cfg.sweep = true;
+      break;
+    case 'P':
+      cfg.pass_us = strtof(optarg, nullptr);
+      break;
+    case 'B':
+      cfg.byte_us = strtof(optarg, nullptr);
+      break;
+    case 'M':
+      cfg.msg_us = strtof(optarg, nullptr);
+      break;
+    case 'o':
+      cfg.load = strtof(optarg, nullptr);
+      break;
+    case 't':
+      cfg.late_ms = strtof(optarg, nullptr);
+      break;
+    case 'v':
+      cfg.starve_ms = strtof(optarg, nullptr);
+      break;
+    default:
+      return false;
+    }
+  }
+  return cfg.seconds > 0.f && cfg.rx_bytes > 1 && cfg.load >= 0.f && cfg.load < 1.f;
+}
+
+int main(int argc, char **argv)
+{
+  FloodConfig cfg;
+  if (!ParseArgs(argc, argv, cfg))
+  {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  printf("%s link, %s, %s%s, %zu-byte rx buffer, pass %.0f us + %.1f us/byte + %.1f us/msg, "
+         "audio load %.0f %%\n",
+         cfg.link == LINK_DIN ? "DIN" : "USB",
+         cfg.pattern == PATTERN_NOTES   ? "notes"
+         : cfg.pattern == PATTERN_CC    ? "cc"
+         : cfg.pattern == PATTERN_CLOCK ? "clock"
+                                        : "mixed",
+         cfg.rate > 0.f ? "paced" : "full rate", cfg.running_status ? ", running status" : "",
+         cfg.rx_bytes, cfg.pass_us, cfg.byte_us, cfg.msg_us, cfg.load * 100.f);
+  printf("lost = sent - handled - in flight at the end; latency from the last byte in the buffer, late > %.1f ms; "
+         "ctl = UpdateControls interval, starved > %.1f ms (all ms)\n",
+         cfg.late_ms, cfg.starve_ms);
+  PrintHeader();
+
+  std::vector<int> budgets;
+  if (cfg.sweep)
+    budgets = {-1, 1, 2, 4, 8, 16, 32, 0};
+  else
+    budgets = {cfg.budget};
+  for (int b : budgets)
+  {
+    FloodConfig run = cfg;
+    run.budget = b;
+    Flood flood(run);
+    FloodStats st = flood.Run();
+    PrintRow(run, st);
+  }
+  return 0;
+}
@@ -0,0 +1,294 @@
+/**
+ * Morph / panel hand-over check (host only).
+ *
+ * Drives VoiceManager through the MIDI CC map with seeded random control
+ * changes between audio blocks: new panel settings, morph captures, the
+ * morph switched on and off (alone, twice in a row, and around a panel
+ * change, so the audio side never sees one of the edges), all with the
+ * position left where it is. After every block the set the voice runs on
+ * has to match a model: the last panel, resolved, while the morph is off;
+ * the crossfade of the two captured ends at the position while it is on,
+ * worked out here from Voice::Resolve on its own.
+ *
+ * Exits non-zero on the first block that does not match, with the step
+ * and the value that differs.
+ */
+#include "DaisyDuino.h"
+#include "VoiceManager.h"
+
+#include <getopt.h>
+#include <math.h>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+struct CheckConfig
+{
+  size_t steps = 100000;
+  uint32_t seed = 1;
+  size_t block_size = 48;
+};
+
+static const char *const ACTION_NAMES[] = {"panel", "toggle", "double toggle", "off, panel, on",
+                                           "capture", "position", "none"};
+
+enum Action
+{
+  ACTION_PANEL,        // new panel settings
+  ACTION_TOGGLE,       // morph on / off
+  ACTION_DOUBLE,       // on / off and straight back, within one block
+  ACTION_AROUND_PANEL, // off, new panel, on again, within one block
+  ACTION_CAPTURE,      // new panel captured as A or B
+  ACTION_POSITION,     // a new position, only ever set with the morph off
+  ACTION_NONE,
+  ACTION_COUNT,
+};
+
+class Rng
+{
+public:
+  explicit Rng(uint32_t seed) : state_(seed ? seed : 1) {}
+  uint32_t Next()
+  {
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 17;
+    state_ ^= state_ << 5;
+    return state_;
+  }
+  float Unit() { return (Next() >> 8) * (1.f / 16777216.f); }
+
+private:
+  uint32_t state_;
+};
+
+static SynthParams RandomPanel(Rng &rng)
+{
+  SynthParams p;
+  p.osc_param = 2.f * rng.Unit() - 1.f;
+  p.env_osc_amt = 2.f * rng.Unit() - 1.f;
+  p.lfo_osc_amt = rng.Unit();
+  p.osc_type = (OscType)(rng.Next() % 3);
+  p.cutoff = 20.f * powf(900.f, rng.Unit());
+  p.reso = 0.93f * rng.Unit();
+  p.env_cutoff_amt = 2.f * rng.Unit() - 1.f;
+  p.lfo_cutoff_amt = rng.Unit();
+  p.attack = rng.Unit();
+  p.decay = rng.Unit();
+  p.sustain = rng.Unit();
+  p.release = rng.Unit();
+  p.amp_mode = (AmpMode)(rng.Next() % 3);
+  p.lfo_rate = rng.Unit();
+  p.lfo_type = (LfoType)(rng.Next() % 6);
+  return p;
+}
+
+/**
+ * reference
+ */
+class Model
+{
+public:
+  explicit Model(float sample_rate) { ref_.Init(sample_rate); }
+
+  void Panel(const SynthParams &p) { panel_ = p; }
+  void Capture(int end)
+  {
+    ends_[end] = panel_;
+    captured_[end] = true;
+  }
+  void SetEnabled(bool on) { enabled_ = on; }
+  bool Enabled() const { return enabled_; }
+  void SetPosition(uint8_t cc) { position_ = cc / 127.f; }
+
+  // what the voice should run on after the next block
+  ResolvedParams Expected() const
+  {
+    ResolvedParams r;
+    if (!enabled_ || !captured_[0] || !captured_[1])
+    {
+      ref_.Resolve(panel_, r);
+      return r;
+    }
+    // the half the position is in, both ends under that half's modes
+    const int h = position_ >= MORPH_THRESHOLD ? 1 : 0;
+    ResolvedParams ends[2];
+    for (int e = 0; e < 2; e++)
+    {
+      SynthParams p = ends_[e];
+      p.osc_type = ends_[h].osc_type;
+      p.amp_mode = ends_[h].amp_mode;
+      p.lfo_type = ends_[h].lfo_type;
+      ref_.Resolve(p, ends[e]);
+    }
+    for (size_t i = 0; i < RESOLVED_COUNT; i++)
+    {
+      float a = ends[0].value[i], b = ends[1].value[i];
+      // the cutoff and the LFO rate move in pitch / tempo, the noise tilt linearly
+      bool log = i == RESOLVED_CUTOFF || (i == RESOLVED_LFO_RATE && ends[0].lfo_type != LFO_TYPE_NOISE);
+      if (log)
+      {
+        a = log2f(fmaxf(a, 1e-6f));
+        b = log2f(fmaxf(b, 1e-6f));
+      }
+      r.value[i] = a + position_ * (b - a);
+      if (log)
+        r.value[i] = exp2f(r.value[i]);
+    }
+    r.osc_type = ends[0].osc_type;
+    r.amp_mode = ends[0].amp_mode;
+    r.lfo_type = ends[0].lfo_type;
+    return r;
+  }
+
+private:
+  Voice ref_;
+  SynthParams panel_, ends_[2];
+  bool captured_[2] = {false, false};
+  bool enabled_ = false;
+  float position_ = 0.f;
+};
+
+static bool Matches(const ResolvedParams &got, const ResolvedParams &want, size_t step, Action last)
+{
+  const char *what = ACTION_NAMES[last];
+  if (got.osc_type != want.osc_type || got.amp_mode != want.amp_mode || got.lfo_type != want.lfo_type)
+  {
+    fprintf(stderr, "step %zu (after %s): modes %d/%d/%d, model %d/%d/%d\n", step, what, got.osc_type,
+            got.amp_mode, got.lfo_type, want.osc_type, want.amp_mode, want.lfo_type);
+    return false;
+  }
+  for (size_t i = 0; i < RESOLVED_COUNT; i++)
+  {
+    float tol = 1e-4f * fmaxf(1.f, fabsf(want.value[i]));
+    if (fabsf(got.value[i] - want.value[i]) > tol)
+    {
+      fprintf(stderr, "step %zu (after %s): value %zu is %g, model %g\n", step, what, i, got.value[i],
+              want.value[i]);
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool ParseArgs(int argc, char **argv, CheckConfig &cfg)
+{
+  static const option opts[] = {
+      {"steps", required_argument, nullptr, 'n'},
+      {"seed", required_argument, nullptr, 's'},
+      {"block", required_argument, nullptr, 'b'},
+      {nullptr, 0, nullptr, 0},
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "", opts, nullptr)) != -1)
+  {
+    switch (c)
+    {
+    case 'n':
+      cfg.steps = (size_t)strtoull(optarg, nullptr, 10);
+      break;
+    case 's':
+      cfg.seed = (uint32_t)strtoul(optarg, nullptr, 10);
+      break;
+    case 'b':
+      cfg.block_size = (size_t)strtoul(optarg, nullptr, 10);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [--steps N] [--seed N] [--block N]\n", argv[0]);
+      return false;
+    }
+  }
+  if (cfg.block_size < 1 || cfg.block_size > 256)
+    cfg.block_size = 48;
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  CheckConfig cfg;
+  if (!ParseArgs(argc, argv, cfg))
+    return 1;
+
+  const float sample_rate = 48000.f;
+  std::unique_ptr<VoiceManager> vm(new VoiceManager());
+  vm->Init(sample_rate);
+  std::unique_ptr<Model> model(new Model(sample_rate));
+  Rng rng(cfg.seed);
+
+  std::vector<float> l(cfg.block_size), r(cfg.block_size);
+  float *out[2] = {l.data(), r.data()};
+  size_t actions[ACTION_COUNT] = {};
+
+  auto panel = [&](const SynthParams &p) {
+    vm->SetParams(p);
+    model->Panel(p);
+  };
+  auto enable = [&](bool on) {
+    vm->ControlChange(1, 114, on ? 127 : 0);
+    model->SetEnabled(on);
+  };
+
+  // a settled start: a panel, both ends, the morph off
+  panel(RandomPanel(rng));
+  vm->ControlChange(1, 112, 127);
+  model->Capture(0);
+  panel(RandomPanel(rng));
+  vm->ControlChange(1, 113, 127);
+  model->Capture(1);
+
+  for (size_t step = 0; step < cfg.steps; step++)
+  {
+    Action a = (Action)(rng.Next() % ACTION_COUNT);
+    switch (a)
+    {
+    case ACTION_PANEL:
+      panel(RandomPanel(rng));
+      break;
+    case ACTION_TOGGLE:
+      enable(!model->Enabled());
+      break;
+    case ACTION_DOUBLE:
+    {
+      bool was = model->Enabled();
+      enable(!was);
+      enable(was);
+      break;
+    }
+    case ACTION_AROUND_PANEL:
+      enable(false);
+      panel(RandomPanel(rng));
+      enable(true);
+      break;
+    case ACTION_CAPTURE:
+    {
+      int end = (int)(rng.Next() & 1);
+      panel(RandomPanel(rng));
+      vm->ControlChange(1, end ? 113 : 112, 127);
+      model->Capture(end);
+      break;
+    }
+    case ACTION_POSITION:
+    {
+      // set with the morph off, so it is in place, not slewing, when the
+      // morph comes back on
+      uint8_t cc = (uint8_t)(rng.Next() % 128);
+      enable(false);
+      vm->ControlChange(1, 1, cc);
+      model->SetPosition(cc);
+      break;
+    }
+    default:
+      break;
+    }
+    actions[a]++;
+    vm->ProcessBlock(out, cfg.block_size);
+    if (!Matches(vm->Resolved(), model->Expected(), step, a))
+      return 1;
+  }
+
+  printf("%zu steps, seed %u, %zu-sample blocks:", cfg.steps, cfg.seed, cfg.block_size);
+  for (int i = 0; i < ACTION_NONE; i++)
+    printf(" %s %zu%s", ACTION_NAMES[i], actions[i], i + 1 < ACTION_NONE ? "," : "\n");
+  printf("every block matched the model\n");
+  return 0;
+}
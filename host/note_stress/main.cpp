@@ -0,0 +1,350 @@
+/**
+ * Note-priority stress test (host only).
+ *
+ * Replays seeded chord spam against NotePriority and checks every step
+ * against a brute-force model: a plain list of held notes in press order,
+ * scanned for the last, lowest and highest. The spam covers overlapping
+ * chords, releases in any order, retriggers of held notes, note-offs for
+ * notes that are not held, all-notes-off and priority mode changes while
+ * notes are held. The same stream also goes through VoiceManager, where the
+ * sounding note and the held count (as telemetry reports them) have to
+ * match the model.
+ *
+ * Reports the mean and worst push / release / lookup time per mode (the
+ * worst includes whatever the host scheduler adds) and exits
+ * non-zero on the first mismatch, with the step that caused it.
+ */
+#include "DaisyDuino.h"
+#include "NotePriority.h"
+#include "VoiceManager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <getopt.h>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+struct StressConfig
+{
+  size_t events = 1000000;
+  uint32_t seed = 1;
+  int chord_max = 8;
+};
+
+static const char *const MODE_NAMES[3] = {"last", "low", "high"};
+
+/**
+ * reference: held notes in press order, oldest first
+ */
+class Model
+{
+public:
+  void Push(byte note, byte velocity)
+  {
+    Release(note);
+    held_.push_back(note);
+    velocity_[note] = velocity;
+  }
+
+  void Release(byte note)
+  {
+    auto it = std::find(held_.begin(), held_.end(), note);
+    if (it != held_.end())
+      held_.erase(it);
+  }
+
+  void Clear() { held_.clear(); }
+  bool Empty() const { return held_.empty(); }
+  size_t Count() const { return held_.size(); }
+  bool IsHeld(byte note) const { return std::find(held_.begin(), held_.end(), note) != held_.end(); }
+  byte Velocity(byte note) const { return velocity_[note]; }
+  const std::vector<byte> &Held() const { return held_; }
+
+  byte Current(NotePriorityMode mode) const
+  {
+    switch (mode)
+    {
+    case NOTE_PRIORITY_LOW:
+      return *std::min_element(held_.begin(), held_.end());
+    case NOTE_PRIORITY_HIGH:
+      return *std::max_element(held_.begin(), held_.end());
+    default:
+      return held_.back();
+    }
+  }
+
+private:
+  std::vector<byte> held_;
+  byte velocity_[128] = {};
+};
+
+/**
+ * chord spam
+ */
+enum ActionType
+{
+  ACTION_CHORD,     // a cluster of notes pressed at once, some already held
+  ACTION_RELEASE,   // some held notes let go, in random order
+  ACTION_RETRIGGER, // a held note pressed again, new velocity
+  ACTION_STRAY_OFF, // note-off for a note that is not held
+  ACTION_ALL_OFF,   // every held note released, oldest first
+  ACTION_MODE,      // priority mode switched with notes down
+};
+
+struct Action
+{
+  ActionType type;
+  std::vector<byte> notes;
+  byte velocity = 0;
+  NotePriorityMode mode = NOTE_PRIORITY_LAST;
+};
+
+class Spam
+{
+public:
+  explicit Spam(uint32_t seed) : rng_(seed ? seed : 1) {}
+
+  Action Next(const Model &model, int chord_max)
+  {
+    Action a;
+    uint32_t r = Rand() % 100;
+    if (r < 45 || model.Empty())
+    {
+      a.type = ACTION_CHORD;
+      // chords around a wandering centre, so they overlap the held ones
+      centre_ += (int)(Rand() % 9) - 4;
+      centre_ = centre_ < 12 ? 12 : (centre_ > 115 ? 115 : centre_);
+      int size = 1 + (int)(Rand() % chord_max);
+      for (int i = 0; i < size; i++)
+        a.notes.push_back((byte)(centre_ + (int)(Rand() % 25) - 12));
+      a.velocity = (byte)(1 + Rand() % 127);
+    }
+    else if (r < 85)
+    {
+      a.type = ACTION_RELEASE;
+      std::vector<byte> held = model.Held();
+      size_t count = 1 + Rand() % held.size();
+      for (size_t i = 0; i < count; i++)
+      {
+        size_t pick = Rand() % held.size();
+        a.notes.push_back(held[pick]);
+        held.erase(held.begin() + pick);
+      }
+    }
+    else if (r < 92)
+    {
+      a.type = ACTION_RETRIGGER;
+      a.notes.push_back(model.Held()[Rand() % model.Count()]);
+      a.velocity = (byte)(1 + Rand() % 127);
+    }
+    else if (r < 97)
+    {
+      a.type = ACTION_STRAY_OFF;
+      byte note;
+      do
+        note = (byte)(Rand() % 128);
+      while (model.IsHeld(note) && model.Count() < 128);
+      a.notes.push_back(note);
+    }
+    else if (r < 98)
+    {
+      a.type = ACTION_ALL_OFF;
+      a.notes = model.Held();
+    }
+    else
+    {
+      a.type = ACTION_MODE;
+      a.mode = (NotePriorityMode)(Rand() % 3);
+    }
+    return a;
+  }
+
+private:
+  uint32_t Rand()
+  {
+    rng_ ^= rng_ << 13;
+    rng_ ^= rng_ >> 17;
+    rng_ ^= rng_ << 5;
+    return rng_;
+  }
+
+  uint32_t rng_;
+  int centre_ = 60;
+};
+
+/**
+ * checks and timings
+ */
+struct Timing
+{
+  double worst = 0., total = 0.;
+  size_t count = 0;
+
+  void Add(double ns)
+  {
+    worst = ns > worst ? ns : worst;
+    total += ns;
+    count++;
+  }
+  double Mean() const { return count ? total / count : 0.; }
+};
+
+struct ModeTimings
+{
+  Timing push, release, current;
+};
+
+static inline double Since(std::chrono::steady_clock::time_point t0)
+{
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static bool Check(const NotePriority &notes, const Model &model, VoiceManager &vm, NotePriorityMode mode,
+                  size_t step, ModeTimings &timings)
+{
+  if (notes.Count() != model.Count() || notes.Empty() != model.Empty())
+  {
+    fprintf(stderr, "step %zu: %u notes held, model has %zu\n", step, notes.Count(), model.Count());
+    return false;
+  }
+  if (model.Empty())
+    return true;
+
+  auto t0 = std::chrono::steady_clock::now();
+  byte current = notes.Current();
+  timings.current.Add(Since(t0));
+  byte expected = model.Current(mode);
+  if (current != expected)
+  {
+    fprintf(stderr, "step %zu: %s priority gives %u, model %u\n", step, MODE_NAMES[mode], current, expected);
+    return false;
+  }
+  if (notes.Velocity(current) != model.Velocity(current))
+  {
+    fprintf(stderr, "step %zu: note %u velocity %u, model %u\n", step, current, notes.Velocity(current),
+            model.Velocity(current));
+    return false;
+  }
+
+  // the engine's view of the same stream, once a block has applied it
+  float l, r;
+  float *out[2] = {&l, &r};
+  vm.ProcessBlock(out, 1);
+  TelemetryRecord rec;
+  vm.FillTelemetry(rec);
+  if (rec.note != expected || rec.held != model.Count() || !(rec.flags & TELEMETRY_FLAG_GATE))
+  {
+    fprintf(stderr, "step %zu: VoiceManager sounds %u with %u held, model %u with %zu\n", step, rec.note,
+            rec.held, expected, model.Count());
+    return false;
+  }
+  return true;
+}
+
+static bool ParseArgs(int argc, char **argv, StressConfig &cfg)
+{
+  static const option opts[] = {
+      {"events", required_argument, nullptr, 'n'},
+      {"seed", required_argument, nullptr, 's'},
+      {"chord-max", required_argument, nullptr, 'c'},
+      {nullptr, 0, nullptr, 0},
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "", opts, nullptr)) != -1)
+  {
+    switch (c)
+    {
+    case 'n':
+      cfg.events = (size_t)strtoull(optarg, nullptr, 10);
+      break;
+    case 's':
+      cfg.seed = (uint32_t)strtoul(optarg, nullptr, 10);
+      break;
+    case 'c':
+      cfg.chord_max = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [--events N] [--seed N] [--chord-max N]\n", argv[0]);
+      return false;
+    }
+  }
+  if (cfg.chord_max < 1)
+    cfg.chord_max = 1;
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  StressConfig cfg;
+  if (!ParseArgs(argc, argv, cfg))
+    return 1;
+
+  NotePriority notes;
+  notes.Init();
+  Model model;
+  std::unique_ptr<VoiceManager> vm(new VoiceManager());
+  vm->Init(48000.f);
+  Spam spam(cfg.seed);
+  NotePriorityMode mode = NOTE_PRIORITY_LAST;
+  ModeTimings timings[3];
+  size_t actions[ACTION_MODE + 1] = {};
+  size_t max_held = 0;
+
+  for (size_t step = 0; step < cfg.events; step++)
+  {
+    Action a = spam.Next(model, cfg.chord_max);
+    actions[a.type]++;
+    ModeTimings &t = timings[mode];
+    switch (a.type)
+    {
+    case ACTION_CHORD:
+    case ACTION_RETRIGGER:
+      for (byte n : a.notes)
+      {
+        auto t0 = std::chrono::steady_clock::now();
+        notes.Push(n, a.velocity);
+        t.push.Add(Since(t0));
+        model.Push(n, a.velocity);
+        vm->NoteOn(1, n, a.velocity);
+        if (!Check(notes, model, *vm, mode, step, t))
+          return 1;
+      }
+      break;
+    case ACTION_MODE:
+      mode = a.mode;
+      notes.SetMode(mode);
+      // takes over on the next note event, see VoiceManager::SetNotePriority
+      vm->SetNotePriority(mode);
+      break;
+    default:
+      for (byte n : a.notes)
+      {
+        auto t0 = std::chrono::steady_clock::now();
+        notes.Release(n);
+        t.release.Add(Since(t0));
+        model.Release(n);
+        vm->NoteOff(1, n, 0);
+        if (!Check(notes, model, *vm, mode, step, t))
+          return 1;
+      }
+      break;
+    }
+    max_held = std::max(max_held, model.Count());
+  }
+
+  printf("%zu events, seed %u: chords %zu, releases %zu, retriggers %zu, stray offs %zu, all-offs %zu, "
+         "mode changes %zu\n",
+         cfg.events, cfg.seed, actions[ACTION_CHORD], actions[ACTION_RELEASE], actions[ACTION_RETRIGGER],
+         actions[ACTION_STRAY_OFF], actions[ACTION_ALL_OFF], actions[ACTION_MODE]);
+  printf("up to %zu notes held at once, every step matched the model\n", max_held);
+  printf("ns, mean / worst       push          release         lookup\n");
+  for (int m = 0; m < 3; m++)
+  {
+    const ModeTimings &t = timings[m];
+    printf("  %-8s %6.1f / %6.0f  %6.1f / %6.0f  %6.1f / %6.0f\n", MODE_NAMES[m], t.push.Mean(), t.push.worst,
+           t.release.Mean(), t.release.worst, t.current.Mean(), t.current.worst);
+  }
+  return 0;
+}
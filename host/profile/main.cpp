@@ -0,0 +1,587 @@
+/**
+ * Per-module hardware-counter profiler (host only).
+ *
+ * Renders a few fixed scenarios for every oscillator type of the compiled
+ * bank and runs each DSP module on its own over them: VS_Lfo, VS_Osc, Voice
+ * and VoiceManager (each inclusive of what it calls; Voice contains an
+ * oscillator and an LFO, VoiceManager a voice and the master stage). The
+ * panel is turned through the real SynthHardware code and every control
+ * pass is worked out before the run starts, so the counters only see the
+ * module: its SetParams, note handling and audio. Counters come from
+ * perf_event_open, user space only: cycles, instructions, IPC, branch
+ * misses and last-level cache misses, plus task-clock time.
+ *
+ * Hardware counters are often missing in VMs and containers
+ * (perf_event_paranoid, no PMU passed through); the run then reports
+ * task-clock time only and says so. The env builds with frame pointers, so
+ * `perf record -g` on the same binary gives call graphs down to the
+ * function (`--seconds 30 --module Voice` for a long, narrow run).
+ */
+#include "DaisyDuino.h"
+#include "SynthHardware.h"
+#include "VoiceManager.h"
+#include "Voice.h"
+#include "vs_osc.h"
+#include "vs_lfo.h"
+#include "host_panel.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <linux/perf_event.h>
+#include <math.h>
+#include <memory>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+#ifndef OSC_BANK
+#define OSC_BANK 2
+#endif
+
+struct ProfileConfig
+{
+  float sample_rate = 48000.f;
+  size_t block_size = 48;
+  float seconds = 2.f;
+  int cpu = -1;
+  bool fx = false;
+  const char *scenario = nullptr; // nullptr = all
+  const char *module = nullptr;   // nullptr = all
+  const char *csv_path = nullptr;
+};
+
+/**
+ * counters
+ */
+enum CounterId
+{
+  COUNTER_TASK_CLOCK, // ns
+  COUNTER_CYCLES,
+  COUNTER_INSTRUCTIONS,
+  COUNTER_BRANCH_MISSES,
+  COUNTER_CACHE_MISSES,
+  COUNTER_COUNT,
+};
+
+static const struct
+{
+  uint32_t type;
+  uint64_t config;
+  const char *name;
+} COUNTERS[COUNTER_COUNT] = {
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, "task-clock"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, "branch-misses"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "cache-misses"},
+};
+
+// cycles and instructions are one group, so the kernel always counts them
+// over the same stretch and IPC stays exact when it has to multiplex; the
+// other counters get an fd each, so one the machine lacks only blanks its
+// own column
+class PerfCounters
+{
+public:
+  void Open()
+  {
+    for (size_t i = 0; i < COUNTER_COUNT; i++)
+    {
+      perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = COUNTERS[i].type;
+      attr.config = COUNTERS[i].config;
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      int leader = -1;
+      if (i == COUNTER_INSTRUCTIONS && fd_[COUNTER_CYCLES] >= 0)
+      {
+        // members follow the leader's enable
+        leader = fd_[COUNTER_CYCLES];
+        attr.disabled = 0;
+      }
+      fd_[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+      if (fd_[i] < 0 && leader >= 0)
+      {
+        // no room for both at once: instructions on its own, IPC then
+        // comes from two windows
+        attr.disabled = 1;
+        fd_[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+      }
+      else if (leader >= 0)
+        grouped_ = true;
+      if (fd_[i] < 0)
+        errno_[i] = errno;
+    }
+  }
+
+  void Close()
+  {
+    for (size_t i = 0; i < COUNTER_COUNT; i++)
+      if (fd_[i] >= 0)
+        close(fd_[i]);
+  }
+
+  bool Has(CounterId id) const { return fd_[id] >= 0; }
+  int Error(CounterId id) const { return errno_[id]; }
+  bool Grouped() const { return grouped_; }
+
+  void Start()
+  {
+    Control(PERF_EVENT_IOC_RESET);
+    Control(PERF_EVENT_IOC_ENABLE);
+  }
+
+  // counts since Start(), scaled up if the kernel had to multiplex
+  void Stop(double *counts)
+  {
+    Control(PERF_EVENT_IOC_DISABLE);
+    for (size_t i = 0; i < COUNTER_COUNT; i++)
+    {
+      counts[i] = -1.;
+      uint64_t v[3];
+      if (fd_[i] < 0 || read(fd_[i], v, sizeof(v)) != (ssize_t)sizeof(v) || v[2] == 0)
+        continue;
+      counts[i] = (double)v[0] * ((double)v[1] / (double)v[2]);
+    }
+  }
+
+private:
+  int fd_[COUNTER_COUNT] = {-1, -1, -1, -1, -1};
+  int errno_[COUNTER_COUNT] = {};
+  bool grouped_ = false;
+
+  // the group through its leader, everything else one fd at a time
+  void Control(unsigned long request)
+  {
+    for (size_t i = 0; i < COUNTER_COUNT; i++)
+    {
+      if (fd_[i] < 0 || (grouped_ && i == COUNTER_INSTRUCTIONS))
+        continue;
+      const bool leader = grouped_ && i == COUNTER_CYCLES;
+      ioctl(fd_[i], request, leader ? PERF_IOC_FLAG_GROUP : 0);
+    }
+  }
+};
+
+/**
+ * scenarios
+ */
+struct Scenario
+{
+  const char *name;
+  const char *what;
+  float notes_per_sec; // 0 = one note held all through
+  bool turn_pots;
+  LfoType lfo_type;
+};
+
+static const Scenario SCENARIOS[] = {
+    {"drone", "one held note, panel at rest", 0.f, false, LFO_TYPE_SIN},
+    {"notes", "8 notes a second, panel at rest", 8.f, false, LFO_TYPE_SIN},
+    {"sweep", "one held note, cutoff, shape, envelope and LFO rate turning", 0.f, true, LFO_TYPE_SIN},
+    {"random", "8 notes a second, smoothed random LFO", 8.f, false, LFO_TYPE_SMOOTH},
+};
+
+// what a module sees in one block, worked out before the run
+struct BlockPlan
+{
+  SynthParams params;
+  int note_off = -1, note_on = -1; // MIDI notes, -1 = none
+  float freq;                      // of the note sounding, Hz
+};
+
+static void SetPanel(const Scenario &sc, OscType osc, float t)
+{
+  PanelSetOscType(osc);
+  PanelSetLfoType(sc.lfo_type);
+  PanelSetAmpMode(AMP_MODE_ADSR);
+  float turn = sc.turn_pots ? 0.5f + 0.45f * sinf(TWOPI_F * 0.5f * t) : 0.5f;
+  float turn2 = sc.turn_pots ? 0.5f + 0.45f * sinf(TWOPI_F * 0.13f * t) : 0.5f;
+  PanelSetPot(POT_OSC_PARAM, turn2);
+  PanelSetPot(POT_ENV_OSC_AMT, 0.6f);
+  PanelSetPot(POT_LFO_OSC_AMT, 0.3f);
+  PanelSetPot(POT_CUTOFF, 0.3f + 0.5f * turn);
+  PanelSetPot(POT_RESO, 0.5f);
+  PanelSetPot(POT_ENV_CUTOFF_AMT, 0.75f);
+  PanelSetPot(POT_LFO_CUTOFF_AMT, 0.3f);
+  PanelSetPot(POT_ATTACK, 0.05f);
+  PanelSetPot(POT_DECAY, sc.turn_pots ? turn : 0.3f);
+  PanelSetPot(POT_SUSTAIN, 0.7f);
+  PanelSetPot(POT_RELEASE, sc.turn_pots ? turn2 : 0.2f);
+  PanelSetPot(POT_LFO_RATE, sc.turn_pots ? turn : 0.5f);
+}
+
+static std::vector<BlockPlan> PlanScenario(const ProfileConfig &cfg, const Scenario &sc, OscType osc,
+                                           size_t blocks)
+{
+  HostPinTable pins = {};
+  HostBindPinTable(&pins);
+  const float control_rate = cfg.sample_rate / cfg.block_size;
+  SynthHardware hw;
+  hw.Init(control_rate);
+  SetPanel(sc, osc, 0.f);
+  PanelSettle(hw);
+
+  std::vector<BlockPlan> plan(blocks);
+  const size_t note_blocks = sc.notes_per_sec > 0.f ? (size_t)(control_rate / sc.notes_per_sec) : 0;
+  uint32_t rng = 0x2545f491u;
+  int note = -1;
+  for (size_t b = 0; b < blocks; b++)
+  {
+    BlockPlan &p = plan[b];
+    if (sc.turn_pots)
+    {
+      SetPanel(sc, osc, b / control_rate);
+      hw.UpdateControls();
+    }
+    p.params = hw.Params();
+    if (b == 0 || (note_blocks && b % note_blocks == 0))
+    {
+      rng ^= rng << 13;
+      rng ^= rng >> 17;
+      rng ^= rng << 5;
+      p.note_off = note;
+      note = 36 + (int)(rng % 37);
+      p.note_on = note;
+    }
+    else if (note_blocks && b % note_blocks == note_blocks * 3 / 4)
+    {
+      // staccato: the release runs for the last quarter
+      p.note_off = note;
+    }
+    p.freq = mtof((float)note);
+  }
+  HostBindPinTable(nullptr);
+  return plan;
+}
+
+/**
+ * modules, each run alone over a plan
+ */
+enum ModuleId
+{
+  MODULE_LFO,
+  MODULE_OSC,
+  MODULE_VOICE,
+  MODULE_MANAGER,
+  MODULE_COUNT,
+};
+
+static const char *const MODULE_NAMES[MODULE_COUNT] = {"VS_Lfo", "VS_Osc", "Voice", "VoiceManager"};
+
+struct ModuleResult
+{
+  double counts[COUNTER_COUNT];
+  double checksum; // keeps the output alive, and tells runs apart
+};
+
+static ModuleResult RunModule(const ProfileConfig &cfg, ModuleId module, const std::vector<BlockPlan> &plan,
+                              PerfCounters &counters, float *fx_arena)
+{
+  const size_t n = cfg.block_size;
+  std::vector<float> l(n), r(n), aux(n);
+  float *out[2] = {l.data(), r.data()};
+  double checksum = 0.;
+  ModuleResult res;
+
+  // everything is built before the counters start; the plan's first
+  // block sets the panel and starts the first note
+  std::unique_ptr<VS_Lfo> lfo;
+  std::unique_ptr<VS_Osc> osc;
+  std::unique_ptr<Voice> voice;
+  std::unique_ptr<VoiceManager> vm;
+  switch (module)
+  {
+  case MODULE_LFO:
+    lfo.reset(new VS_Lfo());
+    lfo->Init(cfg.sample_rate);
+    lfo->SetSeed(1);
+    break;
+  case MODULE_OSC:
+    osc.reset(new VS_Osc());
+    osc->Init(cfg.sample_rate);
+    // the oscillator's inputs, from an LFO outside the counted loop
+    lfo.reset(new VS_Lfo());
+    lfo->Init(cfg.sample_rate);
+    lfo->SetSeed(1);
+    break;
+  case MODULE_VOICE:
+    voice.reset(new Voice());
+    voice->Init(cfg.sample_rate);
+    voice->SetSeed(1);
+    break;
+  default:
+    vm.reset(new VoiceManager());
+    vm->Init(cfg.sample_rate);
+    vm->SetSeed(1);
+    if (fx_arena)
+    {
+      vm->Fx().Init(cfg.sample_rate, fx_arena, FX_ARENA_SIZE);
+      vm->Fx().SetChorusMix(0.4f);
+      vm->Fx().SetDelayMix(0.3f);
+      vm->Fx().SetReverbMix(0.3f);
+    }
+    break;
+  }
+
+  std::vector<float> lfo_in;
+  if (module == MODULE_OSC)
+  {
+    lfo_in.resize(plan.size() * n);
+    for (size_t b = 0; b < plan.size(); b++)
+    {
+      lfo->SetParams(plan[b].params);
+      lfo->ProcessBlock(&lfo_in[b * n], n, plan[b].freq);
+    }
+  }
+
+  counters.Start();
+  float env = 0.f;
+  const float env_decay = 1.f - 20.f / cfg.sample_rate;
+  for (size_t b = 0; b < plan.size(); b++)
+  {
+    const BlockPlan &p = plan[b];
+    switch (module)
+    {
+    case MODULE_LFO:
+      lfo->SetParams(p.params);
+      lfo->ProcessBlock(l.data(), n, p.freq);
+      break;
+    case MODULE_OSC:
+    {
+      osc->SetParams(p.params);
+      if (p.note_on >= 0)
+      {
+        osc->Trigger(p.freq);
+        env = 1.f;
+      }
+      const float *lb = &lfo_in[b * n];
+      for (size_t i = 0; i < n; i++)
+      {
+        l[i] = osc->Process(p.freq, env, lb[i]);
+        env *= env_decay;
+      }
+      break;
+    }
+    case MODULE_VOICE:
+      voice->SetParams(p.params);
+      if (p.note_off >= 0)
+        voice->NoteOff(1, (byte)p.note_off, 0);
+      if (p.note_on >= 0)
+        voice->NoteOn(1, (byte)p.note_on, 100);
+      voice->ProcessBlock(l.data(), n);
+      break;
+    default:
+      vm->SetParams(p.params);
+      if (p.note_off >= 0)
+        vm->NoteOff(1, (byte)p.note_off, 0);
+      if (p.note_on >= 0)
+        vm->NoteOn(1, (byte)p.note_on, 100);
+      vm->ProcessBlock(out, n);
+      break;
+    }
+    checksum += l[b % n];
+  }
+  counters.Stop(res.counts);
+  res.checksum = checksum;
+  return res;
+}
+
+/**
+ * report
+ */
+static void PrintCell(double v, int width, int precision)
+{
+  if (v < 0.)
+    printf(" %*s", width, "-");
+  else
+    printf(" %*.*f", width, precision, v);
+}
+
+static void Report(FILE *csv, const Scenario &sc, OscType osc, ModuleId module, const ModuleResult &res,
+                   double samples)
+{
+  const double *c = res.counts;
+  double ns = c[COUNTER_TASK_CLOCK] >= 0. ? c[COUNTER_TASK_CLOCK] / samples : -1.;
+  double cyc = c[COUNTER_CYCLES] >= 0. ? c[COUNTER_CYCLES] / samples : -1.;
+  double ins = c[COUNTER_INSTRUCTIONS] >= 0. ? c[COUNTER_INSTRUCTIONS] / samples : -1.;
+  double ipc = cyc > 0. && ins >= 0. ? ins / cyc : -1.;
+  double brm = c[COUNTER_BRANCH_MISSES] >= 0. ? c[COUNTER_BRANCH_MISSES] * 1000. / samples : -1.;
+  double cm = c[COUNTER_CACHE_MISSES] >= 0. ? c[COUNTER_CACHE_MISSES] * 1000. / samples : -1.;
+
+  printf("%-7s %-5s %-13s", sc.name, OscTypeName(osc), MODULE_NAMES[module]);
+  PrintCell(ns, 8, 2);
+  PrintCell(cyc, 8, 1);
+  PrintCell(ins, 8, 1);
+  PrintCell(ipc, 5, 2);
+  PrintCell(brm, 10, 2);
+  PrintCell(cm, 10, 2);
+  printf("\n");
+
+  if (csv)
+  {
+    // missing counters are empty fields
+    fprintf(csv, "%s,%s,%s", sc.name, OscTypeName(osc), MODULE_NAMES[module]);
+    for (double v : {ns, cyc, ins, ipc, brm, cm})
+      v < 0. ? fprintf(csv, ",") : fprintf(csv, ",%.3f", v);
+    fprintf(csv, ",%.6g\n", res.checksum);
+  }
+}
+
+static void Usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [--sr HZ] [--block N] [--seconds S] [--cpu N] [--fx]\n"
+          "          [--scenario NAME] [--module NAME] [--csv FILE]\n"
+          "scenarios:",
+          argv0);
+  for (const Scenario &sc : SCENARIOS)
+    fprintf(stderr, " %s", sc.name);
+  fprintf(stderr, "\nmodules:");
+  for (const char *m : MODULE_NAMES)
+    fprintf(stderr, " %s", m);
+  fprintf(stderr, "\n");
+}
+
+static bool ParseArgs(int argc, char **argv, ProfileConfig &cfg)
+{
+  static const option opts[] = {
+      {"sr", required_argument, nullptr, 'r'},
+      {"block", required_argument, nullptr, 'b'},
+      {"seconds", required_argument, nullptr, 's'},
+      {"cpu", required_argument, nullptr, 'c'},
+      {"fx", no_argument, nullptr, 'f'},
+      {"scenario", required_argument, nullptr, 'n'},
+      {"module", required_argument, nullptr, 'm'},
+      {"csv", required_argument, nullptr, 'o'},
+      {nullptr, 0, nullptr, 0},
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "", opts, nullptr)) != -1)
+  {
+    switch (c)
+    {
+    case 'r':
+      cfg.sample_rate = strtof(optarg, nullptr);
+      break;
+    case 'b':
+      cfg.block_size = (size_t)atoi(optarg);
+      break;
+    case 's':
+      cfg.seconds = strtof(optarg, nullptr);
+      break;
+    case 'c':
+      cfg.cpu = atoi(optarg);
+      break;
+    case 'f':
+      cfg.fx = true;
+      break;
+    case 'n':
+      cfg.scenario = optarg;
+      break;
+    case 'm':
+      cfg.module = optarg;
+      break;
+    case 'o':
+      cfg.csv_path = optarg;
+      break;
+    default:
+      Usage(argv[0]);
+      return false;
+    }
+  }
+  if (cfg.sample_rate < 8000.f || cfg.block_size < 1 || cfg.block_size > 256 || cfg.seconds <= 0.f)
+  {
+    Usage(argv[0]);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  ProfileConfig cfg;
+  if (!ParseArgs(argc, argv, cfg))
+    return 1;
+
+  if (cfg.cpu >= 0)
+  {
+    // one core: no migrations between the counted runs
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cfg.cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0)
+      fprintf(stderr, "warning: could not pin to cpu %d\n", cfg.cpu);
+  }
+
+  PerfCounters counters;
+  counters.Open();
+  for (size_t i = 0; i < COUNTER_COUNT; i++)
+    if (!counters.Has((CounterId)i))
+      fprintf(stderr, "warning: no %s counter (%s), column left blank\n", COUNTERS[i].name,
+              strerror(counters.Error((CounterId)i)));
+  if (counters.Has(COUNTER_CYCLES) && counters.Has(COUNTER_INSTRUCTIONS) && !counters.Grouped())
+    fprintf(stderr, "warning: cycles and instructions counted apart, IPC is approximate\n");
+
+  FILE *csv = nullptr;
+  if (cfg.csv_path)
+  {
+    csv = fopen(cfg.csv_path, "w");
+    if (!csv)
+    {
+      perror(cfg.csv_path);
+      return 1;
+    }
+    fprintf(csv, "scenario,osc,module,ns_per_sample,cycles_per_sample,instructions_per_sample,ipc,"
+                 "branch_misses_per_ksample,cache_misses_per_ksample,checksum\n");
+  }
+  std::vector<float> fx_arena(cfg.fx ? FX_ARENA_SIZE : 0);
+
+  const size_t blocks = (size_t)(cfg.seconds * cfg.sample_rate / cfg.block_size);
+  const double samples = (double)blocks * cfg.block_size;
+  printf("bank %d, %.0f Hz, %zu-sample blocks, %.1f s per run%s\n", OSC_BANK, cfg.sample_rate, cfg.block_size,
+         cfg.seconds, cfg.fx ? ", FX bus on" : "");
+  printf("%-7s %-5s %-13s %8s %8s %8s %5s %10s %10s\n", "scene", "osc", "module", "ns/smp", "cyc/smp",
+         "ins/smp", "IPC", "brmiss/ks", "llcmiss/ks");
+
+  bool any = false;
+  for (const Scenario &sc : SCENARIOS)
+  {
+    if (cfg.scenario && strcmp(cfg.scenario, sc.name) != 0)
+      continue;
+    for (int o = 0; o < OSC_TYPE_COUNT; o++)
+    {
+      std::vector<BlockPlan> plan = PlanScenario(cfg, sc, (OscType)o, blocks);
+      for (int m = 0; m < MODULE_COUNT; m++)
+      {
+        if (cfg.module && strcmp(cfg.module, MODULE_NAMES[m]) != 0)
+          continue;
+        ModuleResult res = RunModule(cfg, (ModuleId)m, plan, counters, cfg.fx ? fx_arena.data() : nullptr);
+        Report(csv, sc, (OscType)o, (ModuleId)m, res, samples);
+        any = true;
+      }
+    }
+  }
+  for (const Scenario &sc : SCENARIOS)
+    if (!cfg.scenario || strcmp(cfg.scenario, sc.name) == 0)
+      printf("  %-7s %s\n", sc.name, sc.what);
+
+  counters.Close();
+  if (csv)
+    fclose(csv);
+  if (!any)
+  {
+    Usage(argv[0]);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,242 @@
+/**
+ * Deterministic control-trace replay (host only).
+ *
+ * Feeds a trace captured by ControlTrace (on the board with CC 119, or by
+ * host_rt_driver --record) back through the real SynthHardware front-end
+ * and the engine: pot and switch levels go to the stand-in pin table, MIDI
+ * goes to the same handlers as the sketch, and control passes and audio
+ * blocks run in the recorded order. Nothing depends on wall-clock time, so
+ * two replays of one trace render the same samples; the audio hash printed
+ * at the end makes that easy to check.
+ *
+ * Reports the cost of the control path (UpdateControls + parameter update)
+ * per pass and of the audio callback per block.
+ *
+ *   cat /dev/ttyACM0 > take.trace   # then send CC 119 on / off
+ *   program take.trace --audio take.f32
+ */
+#include "DaisyDuino.h"
+#include "SynthHardware.h"
+#include "VoiceManager.h"
+#include "ControlTrace.h"
+#include "host_panel.h"
+#include "host_trace.h"
+
+#include <algorithm>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+SynthHardware g_hw;
+VoiceManager g_vm;
+static float g_fx_arena[FX_ARENA_SIZE];
+
+struct ReplayConfig
+{
+  const char *trace_path = nullptr;
+  const char *audio_path = nullptr; // raw float32, interleaved stereo
+  const char *csv_path = nullptr;
+  uint32_t seed = 1;
+};
+
+static inline uint64_t NowNs()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t Percentile(std::vector<uint64_t> v, double pct)
+{
+  if (v.empty())
+    return 0;
+  std::sort(v.begin(), v.end());
+  size_t idx = (size_t)(pct / 100.0 * (v.size() - 1) + 0.5);
+  return v[idx];
+}
+
+static void PrintDistribution(const char *name, const std::vector<uint64_t> &v)
+{
+  printf("%-20s p50 %8.2f  p90 %8.2f  p99 %8.2f  p99.9 %8.2f  max %8.2f us\n", name,
+         Percentile(v, 50) / 1e3, Percentile(v, 90) / 1e3, Percentile(v, 99) / 1e3,
+         Percentile(v, 99.9) / 1e3, Percentile(v, 100) / 1e3);
+}
+
+static void Usage(const char *argv0)
+{
+  fprintf(stderr, "usage: %s [--seed N] [--audio FILE] [--csv FILE] [TRACE]   (stdin when no TRACE)\n",
+          argv0);
+}
+
+static bool ParseArgs(int argc, char **argv, ReplayConfig &cfg)
+{
+  static const option opts[] = {
+      {"seed", required_argument, nullptr, 'e'},
+      {"audio", required_argument, nullptr, 'a'},
+      {"csv", required_argument, nullptr, 'o'},
+      {nullptr, 0, nullptr, 0},
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "", opts, nullptr)) != -1)
+  {
+    switch (c)
+    {
+    case 'e':
+      cfg.seed = strtoul(optarg, nullptr, 0);
+      break;
+    case 'a':
+      cfg.audio_path = optarg;
+      break;
+    case 'o':
+      cfg.csv_path = optarg;
+      break;
+    default:
+      return false;
+    }
+  }
+  if (optind < argc)
+    cfg.trace_path = argv[optind];
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  ReplayConfig cfg;
+  if (!ParseArgs(argc, argv, cfg))
+  {
+    Usage(argv[0]);
+    return 1;
+  }
+  FILE *in = (cfg.trace_path && strcmp(cfg.trace_path, "-") != 0) ? fopen(cfg.trace_path, "rb")
+                                                                   : stdin;
+  if (!in)
+  {
+    perror(cfg.trace_path);
+    return 1;
+  }
+  std::vector<uint8_t> raw;
+  uint8_t chunk[65536];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0)
+    raw.insert(raw.end(), chunk, chunk + n);
+  if (in != stdin)
+    fclose(in);
+
+  ControlTraceHeader header;
+  std::vector<ControlTraceEvent> events;
+  if (!LoadControlTrace(raw, header, events))
+  {
+    fprintf(stderr, "no control trace found\n");
+    return 1;
+  }
+  if (header.flags & TRACE_FLAG_OVERFLOW)
+    fprintf(stderr, "warning: the recorder ran out of space, trace is truncated\n");
+
+  const float sample_rate = (float)header.sample_rate;
+  const size_t block_size = header.block_size ? header.block_size : 48;
+
+  // same bring-up as setup(); the recording starts from a settled panel
+  g_hw.Init(1000);
+  g_vm.Init(sample_rate, (header.flags & TRACE_FLAG_OVERSAMPLE2) ? 2 : 1);
+  g_vm.SetSeed(cfg.seed);
+  if (!g_vm.Fx().Init(sample_rate, g_fx_arena, FX_ARENA_SIZE))
+    fprintf(stderr, "warning: FX delay lines do not fit the arena, bus bypassed\n");
+  size_t first = 0;
+  while (first < events.size() && TraceApplyInput(events[first]))
+    first++;
+  PanelSettle(g_hw);
+  g_vm.SetParams(g_hw.Params());
+
+  FILE *audio_out = nullptr;
+  if (cfg.audio_path && !(audio_out = fopen(cfg.audio_path, "wb")))
+  {
+    perror(cfg.audio_path);
+    return 1;
+  }
+
+  std::vector<float> out_l(block_size), out_r(block_size), inter(2 * block_size);
+  float *out[2] = {out_l.data(), out_r.data()};
+  std::vector<uint64_t> block_ns, pass_ns;
+  size_t midi_events = 0;
+  uint64_t hash = 1469598103934665603ull; // FNV-1a over the output samples
+
+  for (size_t i = first; i < events.size(); i++)
+  {
+    const ControlTraceEvent &e = events[i];
+    if (TraceApplyInput(e))
+      continue;
+    switch (e.kind)
+    {
+    case TRACE_MIDI:
+      TraceDispatchMidi(g_vm, e.id, e.value & 0xff, e.value >> 8);
+      midi_events++;
+      break;
+    case TRACE_PASSES:
+      for (uint16_t k = 0; k < e.value; k++)
+      {
+        uint64_t t0 = NowNs();
+        g_hw.UpdateControls();
+        g_vm.SetParams(g_hw.Params());
+        pass_ns.push_back(NowNs() - t0);
+      }
+      break;
+    case TRACE_BLOCKS:
+      for (uint16_t k = 0; k < e.value; k++)
+      {
+        uint64_t t0 = NowNs();
+        g_vm.ProcessBlock(out, block_size);
+        block_ns.push_back(NowNs() - t0);
+        for (size_t s = 0; s < block_size; s++)
+        {
+          inter[2 * s] = out_l[s];
+          inter[2 * s + 1] = out_r[s];
+        }
+        const uint8_t *bytes = (const uint8_t *)inter.data();
+        for (size_t b = 0; b < inter.size() * sizeof(float); b++)
+          hash = (hash ^ bytes[b]) * 1099511628211ull;
+        if (audio_out)
+          fwrite(inter.data(), sizeof(float), inter.size(), audio_out);
+      }
+      break;
+    default:
+      fprintf(stderr, "warning: unknown event kind %u at %zu\n", e.kind, i);
+      break;
+    }
+  }
+  if (audio_out)
+    fclose(audio_out);
+
+  const double period_us = 1e6 * block_size / sample_rate;
+  double sum_us = 0;
+  for (uint64_t d : block_ns)
+    sum_us += d / 1e3;
+  printf("sample rate %.0f Hz (voice x%zu), block %zu, %zu events\n", sample_rate,
+         g_vm.Oversample(), block_size, events.size());
+  printf("audio blocks         %zu (%.2f s)\n", block_ns.size(),
+         block_ns.size() * block_size / sample_rate);
+  printf("control passes       %zu\n", pass_ns.size());
+  printf("midi messages        %zu\n", midi_events);
+  printf("mean load            %.2f %%\n",
+         block_ns.empty() ? 0.0 : 100.0 * sum_us / (block_ns.size() * period_us));
+  PrintDistribution("callback duration", block_ns);
+  PrintDistribution("control pass", pass_ns);
+  printf("audio hash           %016llx\n", (unsigned long long)hash);
+
+  if (cfg.csv_path)
+  {
+    FILE *f = fopen(cfg.csv_path, "w");
+    if (!f)
+    {
+      perror(cfg.csv_path);
+      return 1;
+    }
+    fprintf(f, "block,duration_ns\n");
+    for (size_t k = 0; k < block_ns.size(); k++)
+      fprintf(f, "%zu,%llu\n", k, (unsigned long long)block_ns[k]);
+    fclose(f);
+  }
+  return 0;
+}
@@ -0,0 +1,679 @@
+/**
+ * Simulated realtime audio driver (host only).
+ *
+ * Stands in for the Daisy audio DMA: a dedicated thread (SCHED_FIFO when
+ * allowed) calls AudioCallback() every block period, on an absolute
+ * schedule, for a configurable sample rate and block size. A second thread
+ * plays the part of loop(): it injects MIDI and runs the control-rate update,
+ * and queues both for the audio thread, which applies them between blocks.
+ *
+ * Reports deadline misses, callback-duration percentiles and MIDI-to-output
+ * latency, so block size can be sized against latency and regressions in the
+ * worst-case callback time show up, not only the average.
+ *
+ * --record captures the session as a control trace for host_replay.
+ * --governor runs the quality governor as the sketch does; --slowdown K
+ * makes the middle third of the run cost K times what the engine measures
+ * (a CPU K times slower), to push it through its tiers and back.
+ * --samples DIR plays a multisample through bank 1 (build with OSC_BANK=1),
+ * streamed by the control thread like loop() does on the board; looped
+ * unless --one-shot.
+ * --oversample 2 runs the voice at twice --sr, decimated before the FX.
+ * --input HZ feeds the input a saw in 150 ms bursts, for --route and
+ * --follow (the external input paths).
+ */
+#include "DaisyDuino.h"
+#include "SynthHardware.h"
+#include "VoiceManager.h"
+#include "Governor.h"
+#include "host_panel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <vector>
+
+SynthHardware g_hw;
+VoiceManager g_vm;
+static float g_fx_arena[FX_ARENA_SIZE];
+Telemetry g_telemetry;
+static ControlTraceEvent g_trace_buf[TRACE_CAPACITY];
+ControlTrace g_trace;
+Governor g_governor;
+static bool g_governor_on = false;
+// synthetic load: callback cost multiplier, set by the audio thread
+static float g_slowdown = 1.f;
+static float g_sample_arena[SAMPLE_ARENA_SIZE];
+VS_SampleSet g_samples;
+VS_SampleStream g_stream;
+
+// same wiring as the sketch
+static void AudioCallback(float **in, float **out, size_t size)
+{
+  uint32_t start = TelemetryCycles();
+  g_trace.TickBlock();
+  g_vm.ProcessBlock(out, size, in);
+  uint32_t cycles = TelemetryCycles() - start;
+  if (g_slowdown > 1.f)
+  {
+    // burn the difference, the DMA deadline sees it like real work
+    uint32_t target = (uint32_t)(cycles * g_slowdown);
+    while ((uint32_t)(TelemetryCycles() - start) < target)
+    {
+    }
+    cycles = target;
+  }
+  if (g_governor_on && g_governor.Update(cycles))
+    g_vm.SetQualityTier(g_governor.Tier());
+  if (g_telemetry.Tick())
+  {
+    TelemetryRecord rec;
+    g_vm.FillTelemetry(rec);
+    rec.cycles = cycles;
+    rec.midi_overflows = 0; // MIDI is injected directly, no UART
+    g_telemetry.Push(rec);
+  }
+}
+
+struct DriverConfig
+{
+  float sample_rate = 48000.f;
+  size_t block_size = 48;
+  size_t oversample = 1;
+  float seconds = 10.f;
+  float notes_per_sec = 8.f;
+  bool fifo = false;
+  bool fx = false;
+  int priority = 80;
+  int cpu = -1;
+  uint32_t seed = 1;
+  const char *csv_path = nullptr;
+  // telemetry frames go here instead of USB (file or named pipe)
+  const char *telemetry_path = nullptr;
+  // control trace of the whole run, for host_replay
+  const char *record_path = nullptr;
+  bool governor = false;
+  float slowdown = 1.f;
+  // multisample directory (0.wav, 1.wav, ...), bank 1 only
+  const char *samples_dir = nullptr;
+  bool one_shot = false;
+  // test signal on the audio input, 0 = silence
+  float input_hz = 0.f;
+  InputRoute route = INPUT_ROUTE_OFF;
+  FollowMode follow = FOLLOW_OFF;
+};
+
+static inline uint64_t NowNs()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline timespec ToTimespec(uint64_t ns)
+{
+  timespec ts;
+  ts.tv_sec = (time_t)(ns / 1000000000ull);
+  ts.tv_nsec = (long)(ns % 1000000000ull);
+  return ts;
+}
+
+/**
+ * shared between the two threads
+ */
+static std::atomic<bool> g_running(true);
+
+/**
+ * control -> audio: what loop() hands the engine, applied by the audio
+ * thread right before its next callback, so the engine is only ever
+ * touched from one thread (single producer, single consumer)
+ */
+enum ControlEventType
+{
+  CONTROL_NOTE_ON,
+  CONTROL_NOTE_OFF,
+  CONTROL_PARAMS,
+};
+
+struct ControlEvent
+{
+  uint8_t type; // ControlEventType
+  byte note, velocity;
+  uint64_t sent_ns; // note-ons: when the control side sent it
+  SynthParams params;
+};
+
+#define CONTROL_QUEUE_SIZE 64 // power of two
+static ControlEvent g_control_queue[CONTROL_QUEUE_SIZE];
+static std::atomic<uint32_t> g_control_head(0), g_control_tail(0);
+
+// waits while the queue is full, which only happens if the audio thread
+// stalls: loop() does not drop MIDI either, it sits in the UART
+static void PushControl(const ControlEvent &e)
+{
+  uint32_t head = g_control_head.load(std::memory_order_relaxed);
+  while (head - g_control_tail.load(std::memory_order_acquire) >= CONTROL_QUEUE_SIZE)
+  {
+    if (!g_running.load())
+      return;
+    sched_yield();
+  }
+  g_control_queue[head % CONTROL_QUEUE_SIZE] = e;
+  g_control_head.store(head + 1, std::memory_order_release);
+}
+
+// applies everything queued, returns the send time of the last note-on (0 = none)
+static uint64_t DrainControl()
+{
+  uint64_t note_ns = 0;
+  uint32_t tail = g_control_tail.load(std::memory_order_relaxed);
+  uint32_t head = g_control_head.load(std::memory_order_acquire);
+  for (; tail != head; tail++)
+  {
+    const ControlEvent &e = g_control_queue[tail % CONTROL_QUEUE_SIZE];
+    switch (e.type)
+    {
+    case CONTROL_NOTE_ON:
+      g_vm.NoteOn(1, e.note, e.velocity);
+      note_ns = e.sent_ns;
+      break;
+    case CONTROL_NOTE_OFF:
+      g_vm.NoteOff(1, e.note, e.velocity);
+      break;
+    default:
+      g_vm.SetParams(e.params);
+      break;
+    }
+  }
+  g_control_tail.store(tail, std::memory_order_release);
+  return note_ns;
+}
+
+struct AudioStats
+{
+  std::vector<uint64_t> durations_ns; // one per block
+  std::vector<uint64_t> wake_late_ns; // one per block
+  std::vector<uint64_t> latencies_ns; // one per observed NoteOn
+  std::vector<uint8_t> tiers;         // one per block
+  size_t blocks = 0;
+  size_t deadline_misses = 0;
+};
+
+struct AudioThreadArgs
+{
+  const DriverConfig *cfg;
+  AudioStats *stats;
+};
+
+// stand-in for the codec input: a saw, 150 ms on / 100 ms off
+static void FillTestInput(float *buf, size_t n, const DriverConfig &cfg, float &phase,
+                          size_t &pos)
+{
+  const size_t on = (size_t)(0.15f * cfg.sample_rate), cycle = (size_t)(0.25f * cfg.sample_rate);
+  for (size_t i = 0; i < n; i++, pos = (pos + 1) % cycle)
+  {
+    phase += cfg.input_hz / cfg.sample_rate;
+    if (phase >= 1.f)
+      phase -= 1.f;
+    buf[i] = pos < on ? 0.5f * (2.f * phase - 1.f) : 0.f;
+  }
+}
+
+static void *AudioThread(void *p)
+{
+  AudioThreadArgs *args = (AudioThreadArgs *)p;
+  const DriverConfig &cfg = *args->cfg;
+  AudioStats &stats = *args->stats;
+
+  const size_t total_blocks = stats.durations_ns.size();
+  // deadlines come from the block count, a whole-ns period would drift
+  const double period_ns = 1e9 * cfg.block_size / cfg.sample_rate;
+
+  // buffers allocated before the first deadline, never in the loop
+  std::vector<float> in_l(cfg.block_size, 0.f), in_r(cfg.block_size, 0.f);
+  std::vector<float> out_l(cfg.block_size), out_r(cfg.block_size);
+  float *in[2] = {in_l.data(), in_r.data()};
+  float *out[2] = {out_l.data(), out_r.data()};
+
+  float in_phase = 0.f;
+  size_t in_pos = 0;
+
+  const uint64_t start = NowNs();
+  for (size_t k = 0; k < total_blocks; k++)
+  {
+    const uint64_t next = start + (uint64_t)((k + 1) * period_ns);
+    timespec ts = ToTimespec(next);
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);
+    // the DMA has filled it by now, not part of the callback's time
+    if (cfg.input_hz > 0.f)
+      FillTestInput(in_l.data(), cfg.block_size, cfg, in_phase, in_pos);
+
+    uint64_t t0 = NowNs();
+    // what loop() sent since the last block, like MIDI handled before the DMA
+    uint64_t note_ns = DrainControl();
+    // the "dense passage": middle third of the run
+    g_slowdown = (k >= total_blocks / 3 && k < 2 * total_blocks / 3) ? cfg.slowdown : 1.f;
+    AudioCallback(in, out, cfg.block_size);
+    uint64_t t1 = NowNs();
+
+    // like the DMA half-transfer: this block is played from next + period on,
+    // so it has to be ready by then
+    const uint64_t playout = start + (uint64_t)((k + 2) * period_ns);
+    stats.durations_ns[k] = t1 - t0;
+    stats.wake_late_ns[k] = (t0 > next) ? t0 - next : 0;
+    stats.tiers[k] = g_vm.QualityTier();
+    if (t1 > playout)
+      stats.deadline_misses++;
+    // a late block goes out when it is done; note_ns <= t0, so never negative
+    if (note_ns != 0 && stats.latencies_ns.size() < stats.latencies_ns.capacity())
+      stats.latencies_ns.push_back(std::max(playout, t1) - note_ns);
+    // the absolute schedule is kept, the DMA does not wait for us
+    stats.blocks = k + 1;
+  }
+  g_running.store(false);
+  return nullptr;
+}
+
+/**
+ * plays the part of loop(): MIDI in, then the control-rate update
+ */
+static void *ControlThread(void *p)
+{
+  const DriverConfig &cfg = *(const DriverConfig *)p;
+  FILE *telemetry_out = nullptr;
+  if (cfg.telemetry_path && !(telemetry_out = fopen(cfg.telemetry_path, "wb")))
+    perror(cfg.telemetry_path);
+  uint8_t tx[512];
+
+  const uint64_t control_period_ns = 1000000; // loop() paces at ~1 kHz
+  const uint64_t note_period_ns =
+      (cfg.notes_per_sec > 0.f) ? (uint64_t)(1e9 / cfg.notes_per_sec) : 0;
+
+  uint32_t rng = cfg.seed * 2654435761u + 1;
+  byte held = 0;
+  uint64_t next_note = NowNs() + note_period_ns;
+  while (g_running.load())
+  {
+    uint64_t now = NowNs();
+    if (note_period_ns != 0 && now >= next_note)
+    {
+      // traced before it is queued: the audio side applies it at the next
+      // block, where host_replay applies it too
+      ControlEvent e = {};
+      if (held != 0)
+      {
+        g_trace.CaptureMidi(0x80, held, 0);
+        e.type = CONTROL_NOTE_OFF;
+        e.note = held;
+        held = 0;
+      }
+      else
+      {
+        rng = rng * 1664525u + 1013904223u;
+        held = 36 + (byte)((rng >> 24) % 48);
+        g_trace.CaptureMidi(0x90, held, 100);
+        e.type = CONTROL_NOTE_ON;
+        e.note = held;
+        e.velocity = 100;
+        e.sent_ns = NowNs();
+      }
+      PushControl(e);
+      next_note += note_period_ns / 2;
+    }
+    g_hw.UpdateControls();
+    ControlEvent params = {};
+    params.type = CONTROL_PARAMS;
+    params.params = g_hw.Params();
+    PushControl(params);
+    g_stream.Service();
+    if (telemetry_out)
+    {
+      size_t len = g_telemetry.Drain(tx, sizeof(tx));
+      if (len > 0)
+        fwrite(tx, 1, len, telemetry_out);
+    }
+
+    timespec ts = ToTimespec(now + control_period_ns);
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);
+  }
+  // the audio thread has stopped, the engine is ours
+  if (held != 0)
+  {
+    g_trace.CaptureMidi(0x80, held, 0);
+    g_vm.NoteOff(1, held, 0);
+  }
+  if (telemetry_out)
+  {
+    size_t len;
+    while ((len = g_telemetry.Drain(tx, sizeof(tx))) > 0)
+      fwrite(tx, 1, len, telemetry_out);
+    fclose(telemetry_out);
+  }
+  return nullptr;
+}
+
+static bool WriteTrace(const char *path)
+{
+  g_trace.Stop();
+  FILE *f = fopen(path, "wb");
+  if (!f)
+  {
+    perror(path);
+    return false;
+  }
+  uint8_t buf[4096];
+  size_t len;
+  while ((len = g_trace.Drain(buf, sizeof(buf))) > 0)
+    fwrite(buf, 1, len, f);
+  fclose(f);
+  if (g_trace.Overflowed())
+    fprintf(stderr, "warning: control trace full, recording stopped early\n");
+  return true;
+}
+
+static uint64_t Percentile(std::vector<uint64_t> v, double pct)
+{
+  if (v.empty())
+    return 0;
+  std::sort(v.begin(), v.end());
+  size_t idx = (size_t)(pct / 100.0 * (v.size() - 1) + 0.5);
+  return v[idx];
+}
+
+static void PrintDistribution(const char *name, const std::vector<uint64_t> &v)
+{
+  printf("%-20s p50 %8.1f  p90 %8.1f  p99 %8.1f  p99.9 %8.1f  max %8.1f us\n", name,
+         Percentile(v, 50) / 1e3, Percentile(v, 90) / 1e3, Percentile(v, 99) / 1e3,
+         Percentile(v, 99.9) / 1e3, Percentile(v, 100) / 1e3);
+}
+
+static void Usage(const char *argv0)
+{
+  fprintf(stderr,
+          "usage: %s [--sr HZ] [--block N] [--seconds S] [--notes-per-sec R]\n"
+          "          [--fifo] [--priority P] [--cpu N] [--seed N] [--fx] [--csv FILE]\n"
+          "          [--telemetry FILE] [--record FILE] [--governor] [--slowdown K]\n"
+          "          [--samples DIR] [--one-shot] [--oversample N]\n"
+          "          [--input HZ] [--route off|filter|fm] [--follow off|gate|trigger]\n",
+          argv0);
+}
+
+static bool ParseArgs(int argc, char **argv, DriverConfig &cfg)
+{
+  static const option opts[] = {
+      {"sr", required_argument, nullptr, 'r'},
+      {"block", required_argument, nullptr, 'b'},
+      {"seconds", required_argument, nullptr, 's'},
+      {"notes-per-sec", required_argument, nullptr, 'n'},
+      {"fifo", no_argument, nullptr, 'f'},
+      {"priority", required_argument, nullptr, 'p'},
+      {"cpu", required_argument, nullptr, 'c'},
+      {"seed", required_argument, nullptr, 'e'},
+      {"fx", no_argument, nullptr, 'x'},
+      {"csv", required_argument, nullptr, 'o'},
+      {"telemetry", required_argument, nullptr, 't'},
+      {"record", required_argument, nullptr, 'R'},
+      {"governor", no_argument, nullptr, 'g'},
+      {"slowdown", required_argument, nullptr, 'k'},
+      {"samples", required_argument, nullptr, 'S'},
+      {"one-shot", no_argument, nullptr, '1'},
+      {"oversample", required_argument, nullptr, 'O'},
+      {"input", required_argument, nullptr, 'I'},
+      {"route", required_argument, nullptr, 'u'},
+      {"follow", required_argument, nullptr, 'w'},
+      {nullptr, 0, nullptr, 0},
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "", opts, nullptr)) != -1)
+  {
+    switch (c)
+    {
+    case 'r':
+      cfg.sample_rate = strtof(optarg, nullptr);
+      break;
+    case 'b':
+      cfg.block_size = strtoul(optarg, nullptr, 10);
+      break;
+    case 's':
+      cfg.seconds = strtof(optarg, nullptr);
+      break;
+    case 'n':
+      cfg.notes_per_sec = strtof(optarg, nullptr);
+      break;
+    case 'f':
+      cfg.fifo = true;
+      break;
+    case 'p':
+      cfg.priority = atoi(optarg);
+      break;
+    case 'c':
+      cfg.cpu = atoi(optarg);
+      break;
+    case 'e':
+      cfg.seed = strtoul(optarg, nullptr, 0);
+      break;
+    case 'x':
+      cfg.fx = true;
+      break;
+    case 'o':
+      cfg.csv_path = optarg;
+      break;
+    case 't':
+      cfg.telemetry_path = optarg;
+      break;
+    case 'R':
+      cfg.record_path = optarg;
+      break;
+    case 'g':
+      cfg.governor = true;
+      break;
+    case 'k':
+      cfg.slowdown = strtof(optarg, nullptr);
+      break;
+    case 'S':
+      cfg.samples_dir = optarg;
+      break;
+    case '1':
+      cfg.one_shot = true;
+      break;
+    case 'O':
+      cfg.oversample = strtoul(optarg, nullptr, 10);
+      break;
+    case 'I':
+      cfg.input_hz = strtof(optarg, nullptr);
+      break;
+    case 'u':
+      if (strcmp(optarg, "filter") == 0)
+        cfg.route = INPUT_ROUTE_FILTER;
+      else if (strcmp(optarg, "fm") == 0)
+        cfg.route = INPUT_ROUTE_FM;
+      else if (strcmp(optarg, "off") == 0)
+        cfg.route = INPUT_ROUTE_OFF;
+      else
+        return false;
+      break;
+    case 'w':
+      if (strcmp(optarg, "gate") == 0)
+        cfg.follow = FOLLOW_GATE;
+      else if (strcmp(optarg, "trigger") == 0)
+        cfg.follow = FOLLOW_TRIGGER;
+      else if (strcmp(optarg, "off") == 0)
+        cfg.follow = FOLLOW_OFF;
+      else
+        return false;
+      break;
+    default:
+      return false;
+    }
+  }
+  return cfg.sample_rate > 0.f && cfg.block_size > 0 && cfg.seconds > 0.f;
+}
+
+static void StartAudioThread(pthread_t &th, const DriverConfig &cfg, AudioThreadArgs &args)
+{
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  if (cfg.fifo)
+  {
+    sched_param sp;
+    sp.sched_priority = cfg.priority;
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    pthread_attr_setschedparam(&attr, &sp);
+  }
+  if (cfg.cpu >= 0)
+  {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cfg.cpu, &set);
+    pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+  }
+  if (pthread_create(&th, &attr, AudioThread, &args) != 0)
+  {
+    // typically EPERM without CAP_SYS_NICE / rtprio: fall back, but say so
+    fprintf(stderr, "warning: SCHED_FIFO refused, running audio thread at normal priority\n");
+    pthread_attr_destroy(&attr);
+    pthread_create(&th, nullptr, AudioThread, &args);
+    return;
+  }
+  pthread_attr_destroy(&attr);
+}
+
+int main(int argc, char **argv)
+{
+  DriverConfig cfg;
+  if (!ParseArgs(argc, argv, cfg))
+  {
+    Usage(argv[0]);
+    return 1;
+  }
+  if (cfg.fifo && mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    fprintf(stderr, "warning: mlockall failed, page faults may show up as misses\n");
+
+  // same bring-up as setup(), at the requested rate
+  g_hw.Init(1000);
+  g_vm.Init(cfg.sample_rate, cfg.oversample);
+  g_vm.SetInputRoute(cfg.route);
+  g_vm.SetFollowMode(cfg.follow);
+  g_vm.SetFmDepth(1.f);
+  g_telemetry.Init();
+  g_governor.Init(cfg.sample_rate, cfg.block_size, TelemetryCyclesPerSecond(), QUALITY_TIERS - 1);
+  g_governor_on = cfg.governor;
+  g_vm.SetSeed(cfg.seed);
+  if (!g_vm.Fx().Init(cfg.sample_rate, g_fx_arena, FX_ARENA_SIZE))
+    fprintf(stderr, "warning: FX delay lines do not fit the arena, bus bypassed\n");
+  if (cfg.fx)
+  {
+    // every effect on: worst case for the callback
+    g_vm.Fx().SetChorusMix(0.5f);
+    g_vm.Fx().SetDelayMix(0.4f);
+    g_vm.Fx().SetReverbMix(0.4f);
+  }
+  HostSetAnalogPin(CUTOFF_POT, 0.6f);
+  HostSetAnalogPin(SUSTAIN_POT, 0.8f);
+  HostSetAnalogPin(LFO_RATE_POT, 0.4f);
+  HostSetAnalogPin(LFO_CUTOFF_AMT_POT, 0.3f);
+  if (cfg.samples_dir)
+  {
+    if (OSC_BANK != 1)
+      fprintf(stderr, "warning: samples need an OSC_BANK=1 build, ignored\n");
+    size_t zones = g_samples.Load(cfg.samples_dir, g_sample_arena, SAMPLE_ARENA_SIZE);
+    if (zones == 0)
+    {
+      fprintf(stderr, "no samples in %s\n", cfg.samples_dir);
+      return 1;
+    }
+    g_stream.Init(g_vm.VoiceRate());
+    g_stream.Attach(&g_samples);
+    g_vm.SetSampleStream(&g_stream);
+    // middle position loops, top plays one-shot
+    PanelSetOscType(cfg.one_shot ? OSC_TYPE_TRI : OSC_TYPE_SAW);
+    PanelSettle(g_hw);
+  }
+  g_hw.UpdateControls();
+  g_vm.SetParams(g_hw.Params());
+  if (cfg.record_path)
+  {
+    g_trace.Init(g_trace_buf, TRACE_CAPACITY);
+    g_hw.SetTrace(&g_trace);
+    g_trace.Start(cfg.sample_rate, cfg.block_size, g_vm.Oversample());
+  }
+
+  const size_t total_blocks = (size_t)(cfg.seconds * cfg.sample_rate / cfg.block_size);
+  AudioStats stats;
+  stats.durations_ns.assign(total_blocks, 0);
+  stats.wake_late_ns.assign(total_blocks, 0);
+  stats.tiers.assign(total_blocks, 0);
+  stats.latencies_ns.reserve((size_t)(cfg.seconds * cfg.notes_per_sec) + 16);
+
+  AudioThreadArgs args = {&cfg, &stats};
+  pthread_t audio_th, control_th;
+  StartAudioThread(audio_th, cfg, args);
+  pthread_create(&control_th, nullptr, ControlThread, &cfg);
+  pthread_join(audio_th, nullptr);
+  pthread_join(control_th, nullptr);
+  if (cfg.record_path && !WriteTrace(cfg.record_path))
+    return 1;
+
+  stats.durations_ns.resize(stats.blocks);
+  stats.wake_late_ns.resize(stats.blocks);
+  const double period_us = 1e6 * cfg.block_size / cfg.sample_rate;
+  double sum_us = 0;
+  for (uint64_t d : stats.durations_ns)
+    sum_us += d / 1e3;
+
+  printf("sample rate %.0f Hz (voice x%zu), block %zu, period %.1f us, %zu blocks\n",
+         cfg.sample_rate, g_vm.Oversample(), cfg.block_size, period_us, stats.blocks);
+  printf("fx arena             %zu / %zu KiB%s\n", g_vm.Fx().MemoryUsed() / 1024,
+         g_vm.Fx().MemoryBudget() / 1024, cfg.fx ? "" : " (fx off)");
+  printf("telemetry dropped    %u\n", g_telemetry.Dropped());
+  printf("deadline misses      %zu (%.4f %%)\n", stats.deadline_misses,
+         stats.blocks ? 100.0 * stats.deadline_misses / stats.blocks : 0.0);
+  printf("mean load            %.2f %%\n",
+         stats.blocks ? 100.0 * sum_us / (stats.blocks * period_us) : 0.0);
+  PrintDistribution("callback duration", stats.durations_ns);
+  PrintDistribution("wakeup lateness", stats.wake_late_ns);
+  PrintDistribution("midi->output", stats.latencies_ns);
+  if (cfg.samples_dir)
+    printf("samples              %zu zones, %zu KiB resident, %u underruns\n", g_samples.Zones(),
+           g_samples.MemoryUsed() / 1024, g_stream.Underruns());
+  if (cfg.governor)
+  {
+    size_t per_tier[QUALITY_TIERS] = {};
+    for (size_t k = 0; k < stats.blocks; k++)
+      per_tier[stats.tiers[k]]++;
+    printf("governor             %u down, %u up, load %.2f at the end\n", g_governor.StepsDown(),
+           g_governor.StepsUp(), g_governor.Load());
+    for (int t = 0; t < QUALITY_TIERS; t++)
+      printf("  tier %d             %6.2f %% of blocks\n", t,
+             stats.blocks ? 100.0 * per_tier[t] / stats.blocks : 0.0);
+    // when each change landed
+    for (size_t k = 1; k < stats.blocks; k++)
+      if (stats.tiers[k] != stats.tiers[k - 1])
+        printf("  %8.3f s  tier %u -> %u\n", k * period_us / 1e6, stats.tiers[k - 1],
+               stats.tiers[k]);
+  }
+
+  if (cfg.csv_path)
+  {
+    FILE *f = fopen(cfg.csv_path, "w");
+    if (!f)
+    {
+      perror(cfg.csv_path);
+      return 1;
+    }
+    fprintf(f, "block,duration_ns,wake_late_ns,tier\n");
+    for (size_t k = 0; k < stats.blocks; k++)
+      fprintf(f, "%zu,%llu,%llu,%u\n", k, (unsigned long long)stats.durations_ns[k],
+              (unsigned long long)stats.wake_late_ns[k], stats.tiers[k]);
+    fclose(f);
+  }
+  return stats.deadline_misses == 0 ? 0 : 2;
+}
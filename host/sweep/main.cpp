@@ -0,0 +1,213 @@
+/**
+ * Parallel parameter-space sweep renderer (host only).
+ *
+ * Renders one independent Voice per grid cell over
+ * POT_OSC_PARAM x POT_ENV_OSC_AMT x POT_RESO for every OscType and LfoType,
+ * spread over all cores with a work-stealing pool. Writes one CSV row per
+ * cell: audio summary (RMS, peak, spectral centroid, aliasing estimate) and
+ * CPU cost. The bank is the one compiled in (OSC_BANK), one env per bank.
+ */
+#include "DaisyDuino.h"
+#include "SynthHardware.h"
+#include "Voice.h"
+#include "vs_master.h"
+#include "host_panel.h"
+#include "spectrum.h"
+#include "work_pool.h"
+
+#include <chrono>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+#ifndef OSC_BANK
+#define OSC_BANK 2
+#endif
+
+struct SweepConfig
+{
+  float sample_rate = 48000.f;
+  int steps = 5;
+  float seconds = 0.5f;
+  int note = 48;
+  size_t threads = 0;
+  const char *out_path = nullptr;
+};
+
+struct Cell
+{
+  OscType osc_type;
+  LfoType lfo_type;
+  float osc_param, env_osc_amt, reso; // raw pot positions 0..1
+};
+
+struct CellResult
+{
+  SpectrumSummary spectrum;
+  double ns_per_sample;
+};
+
+static double ThreadCpuNs()
+{
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static CellResult RenderCell(const SweepConfig &cfg, const Cell &cell, uint32_t seed)
+{
+  // every cell gets its own panel, hardware front-end and voice
+  HostPinTable pins = {};
+  HostBindPinTable(&pins);
+
+  SynthHardware hw;
+  hw.Init(1000);
+  PanelSetOscType(cell.osc_type);
+  PanelSetLfoType(cell.lfo_type);
+  PanelSetAmpMode(AMP_MODE_ADSR);
+  PanelSetPot(POT_OSC_PARAM, cell.osc_param);
+  PanelSetPot(POT_ENV_OSC_AMT, cell.env_osc_amt);
+  PanelSetPot(POT_RESO, cell.reso);
+  PanelSetPot(POT_LFO_OSC_AMT, 0.3f);
+  PanelSetPot(POT_CUTOFF, 0.7f);
+  PanelSetPot(POT_ENV_CUTOFF_AMT, 0.75f);
+  PanelSetPot(POT_LFO_CUTOFF_AMT, 0.3f);
+  PanelSetPot(POT_ATTACK, 0.f);
+  PanelSetPot(POT_DECAY, 0.3f);
+  PanelSetPot(POT_SUSTAIN, 0.7f);
+  PanelSetPot(POT_RELEASE, 0.2f);
+  PanelSetPot(POT_LFO_RATE, 0.5f);
+  PanelSettle(hw);
+
+  Voice voice;
+  voice.Init(cfg.sample_rate);
+  voice.SetSeed(seed);
+  voice.SetParams(hw.Params());
+  voice.NoteOn(1, (byte)cfg.note, 100);
+  // the soft clip is part of what the cell sounds like
+  VS_Master master;
+  master.Init(cfg.sample_rate);
+
+  const size_t block = 48;
+  const size_t total = (size_t)(cfg.seconds * cfg.sample_rate) / block * block;
+  std::vector<float> left(total), right(block);
+
+  double t0 = ThreadCpuNs();
+  for (size_t i = 0; i < total; i += block)
+  {
+    voice.ProcessBlock(&left[i], block);
+    master.ProcessMono(&left[i], &left[i], right.data(), block);
+  }
+  double t1 = ThreadCpuNs();
+  HostBindPinTable(nullptr);
+
+  CellResult r;
+  // analyse the second half, past the attack / decay
+  const size_t half = total / 2;
+  r.spectrum = AnalyzeSpectrum(&left[half], total - half, cfg.sample_rate, mtof((float)cfg.note));
+  r.ns_per_sample = (t1 - t0) / total;
+  return r;
+}
+
+static bool ParseArgs(int argc, char **argv, SweepConfig &cfg)
+{
+  static const option opts[] = {
+      {"sr", required_argument, nullptr, 'r'},
+      {"steps", required_argument, nullptr, 'n'},
+      {"seconds", required_argument, nullptr, 's'},
+      {"note", required_argument, nullptr, 'm'},
+      {"threads", required_argument, nullptr, 'j'},
+      {"out", required_argument, nullptr, 'o'},
+      {nullptr, 0, nullptr, 0},
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "", opts, nullptr)) != -1)
+  {
+    switch (c)
+    {
+    case 'r':
+      cfg.sample_rate = strtof(optarg, nullptr);
+      break;
+    case 'n':
+      cfg.steps = atoi(optarg);
+      break;
+    case 's':
+      cfg.seconds = strtof(optarg, nullptr);
+      break;
+    case 'm':
+      cfg.note = atoi(optarg);
+      break;
+    case 'j':
+      cfg.threads = strtoul(optarg, nullptr, 10);
+      break;
+    case 'o':
+      cfg.out_path = optarg;
+      break;
+    default:
+      return false;
+    }
+  }
+  return cfg.steps >= 1 && cfg.seconds > 0.f && cfg.note >= 0 && cfg.note < 128;
+}
+
+int main(int argc, char **argv)
+{
+  SweepConfig cfg;
+  if (!ParseArgs(argc, argv, cfg))
+  {
+    fprintf(stderr,
+            "usage: %s [--sr HZ] [--steps N] [--seconds S] [--note N] [--threads N] "
+            "[--out FILE]\n",
+            argv[0]);
+    return 1;
+  }
+
+  std::vector<Cell> cells;
+  for (int o = 0; o < OSC_TYPE_COUNT; o++)
+    for (int l = 0; l < LFO_TYPE_COUNT; l++)
+      for (int a = 0; a < cfg.steps; a++)
+        for (int b = 0; b < cfg.steps; b++)
+          for (int c = 0; c < cfg.steps; c++)
+          {
+            const float d = cfg.steps > 1 ? 1.f / (cfg.steps - 1) : 0.f;
+            cells.push_back({(OscType)o, (LfoType)l, a * d, b * d, c * d});
+          }
+  std::vector<CellResult> results(cells.size());
+
+  WorkPool pool(cfg.threads);
+  for (size_t i = 0; i < cells.size(); i++)
+    pool.Add([&, i](size_t) { results[i] = RenderCell(cfg, cells[i], (uint32_t)i + 1); });
+
+  auto start = std::chrono::steady_clock::now();
+  pool.Run();
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  FILE *f = cfg.out_path ? fopen(cfg.out_path, "w") : stdout;
+  if (!f)
+  {
+    perror(cfg.out_path);
+    return 1;
+  }
+  fprintf(f, "bank,osc_type,lfo_type,osc_param,env_osc_amt,reso,rms,peak,centroid_hz,"
+             "alias_ratio,ns_per_sample,realtime_load_pct\n");
+  double cpu_s = 0.0;
+  for (size_t i = 0; i < cells.size(); i++)
+  {
+    const Cell &c = cells[i];
+    const CellResult &r = results[i];
+    // share of one core needed to keep up in real time
+    const double load = r.ns_per_sample * cfg.sample_rate * 1e-7;
+    cpu_s += r.ns_per_sample * cfg.seconds * cfg.sample_rate * 1e-9;
+    fprintf(f, "%d,%s,%s,%.3f,%.3f,%.3f,%.5f,%.5f,%.1f,%.6f,%.2f,%.3f\n", OSC_BANK,
+            OscTypeName(c.osc_type), LfoTypeName(c.lfo_type), c.osc_param, c.env_osc_amt,
+            c.reso, r.spectrum.rms, r.spectrum.peak, r.spectrum.centroid_hz,
+            r.spectrum.alias_ratio, r.ns_per_sample, load);
+  }
+  if (f != stdout)
+    fclose(f);
+  fprintf(stderr, "%zu cells on %zu workers: %.2f s wall, %.2f s render cpu (x%.1f)\n",
+          cells.size(), pool.Workers(), wall_s, cpu_s, wall_s > 0 ? cpu_s / wall_s : 0.0);
+  return 0;
+}
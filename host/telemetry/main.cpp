@@ -0,0 +1,151 @@
+/**
+ * Telemetry decoder (host only).
+ *
+ * Reads the binary frames sent by Telemetry over USB CDC (or written by
+ * host_rt_driver --telemetry) from a file, a pipe or the serial device,
+ * and prints one CSV row per record. Resynchronises on the frame header
+ * after garbage or a bad checksum; a summary goes to stderr at the end.
+ *
+ *   cat /dev/ttyACM0 | program --mhz 480 > trace.csv
+ */
+#include "Telemetry.h"
+
+#include <deque>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct DecodeStats
+{
+  size_t frames = 0, bad_checksum = 0, skipped_bytes = 0, seq_gaps = 0;
+  uint32_t max_cycles = 0, max_dropped = 0;
+};
+
+// the input, with bytes of a rejected frame put back in front of it: the
+// sync bytes may have been payload, and a real frame can start anywhere
+// after them
+struct ByteSource
+{
+  FILE *in;
+  std::deque<uint8_t> pending;
+
+  int Next()
+  {
+    if (pending.empty())
+      return fgetc(in);
+    int c = pending.front();
+    pending.pop_front();
+    return c;
+  }
+
+  // false at the end of the input
+  bool Read(uint8_t *dst, size_t len)
+  {
+    for (size_t i = 0; i < len; i++)
+    {
+      int c = Next();
+      if (c == EOF)
+        return false;
+      dst[i] = (uint8_t)c;
+    }
+    return true;
+  }
+
+  void Unread(const uint8_t *src, size_t len) { pending.insert(pending.begin(), src, src + len); }
+};
+
+static const char *Usage = "usage: %s [--mhz CPU_MHZ] [FILE]   (stdin when no FILE)\n";
+
+int main(int argc, char **argv)
+{
+  float mhz = 480.f; // Daisy Seed core clock, 0 prints raw cycles only
+  const char *path = nullptr;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--mhz") == 0 && i + 1 < argc)
+      mhz = strtof(argv[++i], nullptr);
+    else if (argv[i][0] == '-' && argv[i][1] != '\0')
+    {
+      fprintf(stderr, Usage, argv[0]);
+      return 1;
+    }
+    else
+      path = argv[i];
+  }
+  FILE *in = (path && strcmp(path, "-") != 0) ? fopen(path, "rb") : stdin;
+  if (!in)
+  {
+    perror(path);
+    return 1;
+  }
+  setvbuf(stdout, nullptr, _IOLBF, 0); // rows show up live when piped
+
+  printf("seq,cycles,callback_us,gate,note,held,osc_type,lfo_type,amp_mode,tier,env,ring_depth,"
+         "dropped,midi_overflows,fx,fx_used_kb,fx_budget_kb\n");
+
+  const size_t payload = sizeof(TelemetryRecord);
+  uint8_t frame[payload + TELEMETRY_FRAME_OVERHEAD];
+  DecodeStats st;
+  bool have_seq = false;
+  uint32_t last_seq = 0;
+  ByteSource src{in, {}};
+  int c;
+  while ((c = src.Next()) != EOF)
+  {
+    if (c != TELEMETRY_SYNC_0)
+    {
+      st.skipped_bytes++;
+      continue;
+    }
+    int c1 = src.Next();
+    if (c1 != TELEMETRY_SYNC_1)
+    {
+      st.skipped_bytes++;
+      if (c1 == EOF)
+        break;
+      // c1 may itself start a frame
+      uint8_t b = (uint8_t)c1;
+      src.Unread(&b, 1);
+      continue;
+    }
+    if (!src.Read(frame + 2, sizeof(frame) - 2))
+      break;
+    uint8_t sum = 0;
+    for (size_t i = 2; i < 4 + payload; i++)
+      sum += frame[i];
+    if (frame[2] != TELEMETRY_VERSION || frame[3] != payload || sum != frame[4 + payload])
+    {
+      // a false sync: look for the next one from the byte after it
+      st.bad_checksum++;
+      src.Unread(frame + 2, sizeof(frame) - 2);
+      continue;
+    }
+
+    TelemetryRecord rec;
+    memcpy(&rec, frame + 4, payload);
+    if (have_seq && rec.seq != last_seq + 1)
+      st.seq_gaps++;
+    have_seq = true;
+    last_seq = rec.seq;
+    st.frames++;
+    if (rec.cycles > st.max_cycles)
+      st.max_cycles = rec.cycles;
+    if (rec.dropped > st.max_dropped)
+      st.max_dropped = rec.dropped;
+
+    printf("%u,%u,%.2f,%d,%u,%u,%u,%u,%u,%u,%.4f,%u,%u,%u,%d,%u,%u\n", rec.seq, rec.cycles,
+           mhz > 0.f ? rec.cycles / mhz : 0.f, (rec.flags & TELEMETRY_FLAG_GATE) ? 1 : 0,
+           rec.note, rec.held, rec.osc_type, rec.lfo_type, rec.amp_mode, rec.tier, rec.env,
+           rec.ring_depth, rec.dropped, rec.midi_overflows, (rec.flags & TELEMETRY_FLAG_FX) ? 1 : 0,
+           rec.fx_used_kb, rec.fx_budget_kb);
+  }
+  if (in != stdin)
+    fclose(in);
+
+  fprintf(stderr,
+          "%zu frames, %zu bad, %zu bytes skipped, %zu seq gaps (decimation or drops), "
+          "max %u cycles, %u dropped on the device\n",
+          st.frames, st.bad_checksum, st.skipped_bytes, st.seq_gaps, st.max_cycles,
+          st.max_dropped);
+  return 0;
+}
@@ -0,0 +1,385 @@
+/**
+ * Control-trace snapshot check (host only).
+ *
+ * Plays a seeded session into the engine the way the sketch does: panel
+ * passes through SynthHardware (which hands them to ControlTrace), MIDI
+ * through the same handlers, audio blocks in between. The first part sets
+ * things up (panel moves, morph captures, CCs, notes held and released),
+ * then CC 119 starts the trace half way through, with notes still held,
+ * and the session goes on until CC 119 stops it.
+ *
+ * From the start on, every block's control state is folded into a hash:
+ * the set the voice runs on, the held and sounding note, the gate, the
+ * modes, the morph and the sequencer mode. The trace is then replayed into
+ * a fresh engine the way host_replay does it and hashed the same way; the
+ * two have to match. Audio is not compared: oscillator and LFO phases and
+ * the envelopes are not part of the snapshot.
+ *
+ * Exits non-zero with the first block that differs.
+ */
+#include "DaisyDuino.h"
+#include "SynthHardware.h"
+#include "VoiceManager.h"
+#include "ControlTrace.h"
+#include "host_panel.h"
+#include "host_trace.h"
+
+#include <getopt.h>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+struct CheckConfig
+{
+  size_t before = 4000; // steps before the trace starts
+  size_t steps = 20000; // steps recorded
+  uint32_t seed = 1;
+  size_t block_size = 48;
+};
+
+// steps with no input before the start, for the pots and the morph to settle
+#define QUIET_STEPS 500
+
+// CCs that set state, as the session plays them (no sequencer: it
+// restarts its pattern with the replay)
+static const uint8_t STATE_CCS[] = {1, 5, 7, 91, 93, 94, 104, 114, 115};
+
+class Rng
+{
+public:
+  explicit Rng(uint32_t seed) : state_(seed ? seed : 1) {}
+  uint32_t Next()
+  {
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 17;
+    state_ ^= state_ << 5;
+    return state_;
+  }
+  float Unit() { return (Next() >> 8) * (1.f / 16777216.f); }
+
+private:
+  uint32_t state_;
+};
+
+static inline void HashBytes(uint64_t &h, const void *p, size_t n)
+{
+  const uint8_t *b = (const uint8_t *)p;
+  for (size_t i = 0; i < n; i++)
+    h = (h ^ b[i]) * 1099511628211ull;
+}
+
+// the engine's control state after a block
+static uint64_t StateHash(VoiceManager &vm)
+{
+  uint64_t h = 1469598103934665603ull; // FNV-1a
+  const ResolvedParams &r = vm.Resolved();
+  HashBytes(h, r.value, sizeof(r.value));
+  uint8_t modes[3] = {(uint8_t)r.osc_type, (uint8_t)r.amp_mode, (uint8_t)r.lfo_type};
+  HashBytes(h, modes, sizeof(modes));
+  TelemetryRecord rec = {};
+  vm.FillTelemetry(rec);
+  uint8_t notes[4] = {(uint8_t)(rec.flags & TELEMETRY_FLAG_GATE), rec.note, rec.held, rec.tier};
+  HashBytes(h, notes, sizeof(notes));
+  uint8_t morph[2] = {vm.Morph().Enabled(), (uint8_t)vm.Seq().Mode()};
+  HashBytes(h, morph, sizeof(morph));
+  return h;
+}
+
+/**
+ * the recorded session, driven like the sketch
+ */
+class Session
+{
+public:
+  Session(const CheckConfig &cfg, float sample_rate)
+      : cfg_(cfg), sample_rate_(sample_rate), rng_(cfg.seed), vm_(new VoiceManager()),
+        buf_(1u << 20), l_(cfg.block_size), r_(cfg.block_size)
+  {
+    hw_.Init(1000);
+    vm_->Init(sample_rate);
+    vm_->SetSeed(1);
+    trace_.Init(buf_.data(), buf_.size());
+    hw_.SetTrace(&trace_);
+    PanelSettle(hw_);
+    vm_->SetParams(hw_.Params());
+  }
+
+  void Run(std::vector<uint64_t> &hashes)
+  {
+    for (size_t i = 0; i < cfg_.before; i++)
+      Step(true, hashes);
+    for (size_t i = 0; i < QUIET_STEPS; i++)
+      Step(false, hashes);
+    Cc(1, TRACE_CC_RECORD, 127);
+    for (size_t i = 0; i < cfg_.steps; i++)
+      Step(true, hashes);
+    Cc(1, TRACE_CC_RECORD, 0);
+  }
+
+  size_t HeldAtStart() const { return held_at_start_; }
+
+  std::vector<uint8_t> Dump()
+  {
+    std::vector<uint8_t> raw;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = trace_.Drain(chunk, sizeof(chunk))) > 0)
+      raw.insert(raw.end(), chunk, chunk + n);
+    return raw;
+  }
+
+private:
+  /* the sketch's handlers */
+  void NoteOn(byte ch, byte note, byte vel)
+  {
+    trace_.CaptureMidi(0x90 | ((ch - 1) & 0x0f), note, vel);
+    vm_->NoteOn(ch, note, vel);
+  }
+  void NoteOff(byte ch, byte note)
+  {
+    trace_.CaptureMidi(0x80 | ((ch - 1) & 0x0f), note, 0);
+    vm_->NoteOff(ch, note, 0);
+  }
+  void Cc(byte ch, byte cc, byte value)
+  {
+    trace_.CaptureMidi(0xB0 | ((ch - 1) & 0x0f), cc, value);
+    if (cc == TRACE_CC_RECORD)
+    {
+      if (value >= 64)
+      {
+        trace_.Start(sample_rate_, cfg_.block_size, vm_->Oversample());
+        held_at_start_ = held_.size();
+      }
+      else
+      {
+        trace_.Stop();
+      }
+      return;
+    }
+    vm_->ControlChange(ch, cc, value);
+  }
+
+  void Unhold(byte note)
+  {
+    for (size_t i = 0; i < held_.size(); i++)
+      if (held_[i] == note)
+        held_.erase(held_.begin() + i--);
+  }
+
+  void Act()
+  {
+    switch (rng_.Next() % 8)
+    {
+    case 0:
+      PanelSetPot((PotId)(rng_.Next() % POT_COUNT), rng_.Unit());
+      panel_still_ = 0;
+      break;
+    case 1:
+      panel_still_ = 0;
+      switch (rng_.Next() % 3)
+      {
+      case 0:
+        PanelSetOscType((OscType)(rng_.Next() % OSC_TYPE_COUNT));
+        break;
+      case 1:
+        PanelSetAmpMode((AmpMode)(rng_.Next() % 3));
+        break;
+      default:
+        PanelSetLfoType((LfoType)(rng_.Next() % LFO_TYPE_COUNT));
+        break;
+      }
+      break;
+    case 2:
+    case 3:
+    {
+      byte note = (byte)(36 + rng_.Next() % 48);
+      NoteOn((byte)(1 + rng_.Next() % 2), note, (byte)(1 + rng_.Next() % 127));
+      Unhold(note);
+      held_.push_back(note);
+      break;
+    }
+    case 4:
+      if (!held_.empty())
+      {
+        byte note = held_[rng_.Next() % held_.size()];
+        NoteOff(1, note);
+        Unhold(note);
+      }
+      break;
+    case 5:
+      // the snapshot keeps an end as the readings it was captured from,
+      // which only give the same set once the panel has settled
+      if (panel_still_ >= TRACE_SETTLE_PASSES)
+        Cc(1, (rng_.Next() & 1) ? TRACE_CC_CAPTURE_B : TRACE_CC_CAPTURE_A, 127);
+      break;
+    default:
+    {
+      byte cc = STATE_CCS[rng_.Next() % sizeof(STATE_CCS)];
+      byte value = (byte)(rng_.Next() % 128);
+      // which half the morph is in inside its hysteresis band depends on
+      // where it came from, running state the snapshot does not carry
+      if (cc == 1 && value >= 61 && value <= 66)
+        value = 60;
+      Cc(1, cc, value);
+      break;
+    }
+    }
+  }
+
+  void Step(bool act, std::vector<uint64_t> &hashes)
+  {
+    if (act && rng_.Next() % 4 == 0)
+      Act();
+    hw_.UpdateControls();
+    vm_->SetParams(hw_.Params());
+    panel_still_++;
+    float *out[2] = {l_.data(), r_.data()};
+    vm_->ProcessBlock(out, cfg_.block_size);
+    trace_.TickBlock();
+    if (trace_.Recording())
+      hashes.push_back(StateHash(*vm_));
+  }
+
+  const CheckConfig &cfg_;
+  float sample_rate_;
+  Rng rng_;
+  SynthHardware hw_;
+  std::unique_ptr<VoiceManager> vm_;
+  ControlTrace trace_;
+  std::vector<ControlTraceEvent> buf_;
+  std::vector<float> l_, r_;
+  std::vector<byte> held_;
+  size_t held_at_start_ = 0;
+  size_t panel_still_ = 0; // passes since the last panel change
+};
+
+// host_replay's playback, hashing the control state instead of the audio
+static bool Replay(const std::vector<uint8_t> &raw, std::vector<uint64_t> &hashes)
+{
+  ControlTraceHeader header;
+  std::vector<ControlTraceEvent> events;
+  if (!LoadControlTrace(raw, header, events))
+    return false;
+  const size_t block_size = header.block_size;
+
+  SynthHardware hw;
+  std::unique_ptr<VoiceManager> vm(new VoiceManager());
+  hw.Init(1000);
+  vm->Init((float)header.sample_rate, (header.flags & TRACE_FLAG_OVERSAMPLE2) ? 2 : 1);
+  vm->SetSeed(1);
+  size_t first = 0;
+  while (first < events.size() && TraceApplyInput(events[first]))
+    first++;
+  PanelSettle(hw);
+  vm->SetParams(hw.Params());
+
+  std::vector<float> l(block_size), r(block_size);
+  float *out[2] = {l.data(), r.data()};
+  for (size_t i = first; i < events.size(); i++)
+  {
+    const ControlTraceEvent &e = events[i];
+    if (TraceApplyInput(e))
+      continue;
+    switch (e.kind)
+    {
+    case TRACE_MIDI:
+      TraceDispatchMidi(*vm, e.id, e.value & 0xff, e.value >> 8);
+      break;
+    case TRACE_PASSES:
+      for (uint16_t k = 0; k < e.value; k++)
+      {
+        hw.UpdateControls();
+        vm->SetParams(hw.Params());
+      }
+      break;
+    case TRACE_BLOCKS:
+      for (uint16_t k = 0; k < e.value; k++)
+      {
+        vm->ProcessBlock(out, block_size);
+        hashes.push_back(StateHash(*vm));
+      }
+      break;
+    default:
+      break;
+    }
+  }
+  return true;
+}
+
+static bool ParseArgs(int argc, char **argv, CheckConfig &cfg)
+{
+  static const option opts[] = {
+      {"before", required_argument, nullptr, 'p'},
+      {"steps", required_argument, nullptr, 'n'},
+      {"seed", required_argument, nullptr, 's'},
+      {"block", required_argument, nullptr, 'b'},
+      {nullptr, 0, nullptr, 0},
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "", opts, nullptr)) != -1)
+  {
+    switch (c)
+    {
+    case 'p':
+      cfg.before = (size_t)strtoull(optarg, nullptr, 10);
+      break;
+    case 'n':
+      cfg.steps = (size_t)strtoull(optarg, nullptr, 10);
+      break;
+    case 's':
+      cfg.seed = (uint32_t)strtoul(optarg, nullptr, 10);
+      break;
+    case 'b':
+      cfg.block_size = (size_t)strtoul(optarg, nullptr, 10);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [--before N] [--steps N] [--seed N] [--block N]\n", argv[0]);
+      return false;
+    }
+  }
+  if (cfg.block_size < 1 || cfg.block_size > 256)
+    cfg.block_size = 48;
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  CheckConfig cfg;
+  if (!ParseArgs(argc, argv, cfg))
+    return 1;
+
+  std::vector<uint64_t> live, replayed;
+  std::unique_ptr<Session> session(new Session(cfg, 48000.f));
+  session->Run(live);
+  if (!Replay(session->Dump(), replayed))
+  {
+    fprintf(stderr, "no control trace recorded\n");
+    return 1;
+  }
+
+  uint64_t live_hash = 1469598103934665603ull, replay_hash = live_hash;
+  for (uint64_t h : live)
+    HashBytes(live_hash, &h, sizeof(h));
+  for (uint64_t h : replayed)
+    HashBytes(replay_hash, &h, sizeof(h));
+  printf("seed %u: trace started after %zu steps with %zu notes held, %zu blocks recorded\n",
+         cfg.seed, cfg.before + QUIET_STEPS, session->HeldAtStart(), live.size());
+  printf("live state hash      %016llx\n", (unsigned long long)live_hash);
+  printf("replay state hash    %016llx\n", (unsigned long long)replay_hash);
+  if (live.size() != replayed.size())
+  {
+    fprintf(stderr, "replay rendered %zu blocks, the session %zu\n", replayed.size(), live.size());
+    return 1;
+  }
+  for (size_t i = 0; i < live.size(); i++)
+  {
+    if (live[i] != replayed[i])
+    {
+      fprintf(stderr, "first difference at block %zu of the trace\n", i);
+      return 1;
+    }
+  }
+  printf("every block matched\n");
+  return 0;
+}
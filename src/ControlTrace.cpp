@@ -0,0 +1,293 @@
+#include "ControlTrace.h"
+#include "SynthHardware.h"
+#include <string.h>
+
+static_assert(TRACE_POT_COUNT == POT_COUNT, "one trace id per PotId");
+static_assert(TRACE_SWITCH_COUNT == SW_COUNT, "one trace id per SwitchId");
+
+int ControlTracePotPin(uint8_t id)
+{
+  return SynthHardware::PotPin(id);
+}
+
+int ControlTraceSwitchPin(uint8_t id)
+{
+  return SynthHardware::SwitchPin(id);
+}
+
+void ControlTrace::Init(ControlTraceEvent *buffer, size_t capacity)
+{
+  buf_ = buffer;
+  capacity_ = capacity;
+  count_ = 0;
+  armed_ = recording_ = false;
+  draining_ = false;
+}
+
+void ControlTrace::Start(float sample_rate, size_t block_size, size_t oversample)
+{
+  count_ = 0;
+  overflow_ = false;
+  primed_ = false;
+  draining_ = false;
+  pending_passes_ = 0;
+  blocks_seen_ = blocks_.load(std::memory_order_relaxed);
+  header_.magic = TRACE_MAGIC;
+  header_.version = TRACE_VERSION;
+  header_.block_size = (uint16_t)block_size;
+  header_.sample_rate = (uint32_t)sample_rate;
+  oversample2_ = oversample >= 2;
+  armed_ = recording_ = buf_ != nullptr;
+  if (recording_)
+    Snapshot();
+}
+
+void ControlTrace::Stop()
+{
+  if (!armed_)
+    return;
+  if (recording_)
+  {
+    Sync();
+    FlushPasses();
+  }
+  armed_ = recording_ = false;
+  header_.events = (uint32_t)count_;
+  header_.flags = (overflow_ ? TRACE_FLAG_OVERFLOW : 0) | (oversample2_ ? TRACE_FLAG_OVERSAMPLE2 : 0);
+  drain_pos_ = 0;
+  draining_ = true;
+}
+
+void ControlTrace::Append(uint8_t kind, uint8_t id, uint16_t value)
+{
+  if (count_ >= capacity_)
+  {
+    // keep what we have, a truncated trace still replays
+    overflow_ = true;
+    recording_ = false;
+    return;
+  }
+  ControlTraceEvent &e = buf_[count_++];
+  e.kind = kind;
+  e.id = id;
+  e.value = value;
+}
+
+void ControlTrace::FlushPasses()
+{
+  while (pending_passes_ > 0)
+  {
+    uint16_t n = pending_passes_ > 0xffff ? 0xffff : (uint16_t)pending_passes_;
+    Append(TRACE_PASSES, 0, n);
+    pending_passes_ -= n;
+  }
+}
+
+// audio blocks rendered since the last event go in first
+void ControlTrace::Sync()
+{
+  uint32_t blocks = blocks_.load(std::memory_order_relaxed);
+  uint32_t n = blocks - blocks_seen_;
+  if (n == 0)
+    return;
+  FlushPasses();
+  blocks_seen_ = blocks;
+  while (n > 0)
+  {
+    uint16_t k = n > 0xffff ? 0xffff : (uint16_t)n;
+    Append(TRACE_BLOCKS, 0, k);
+    n -= k;
+  }
+}
+
+void ControlTrace::CapturePass(const uint16_t *pots, const uint8_t *switches)
+{
+  memcpy(now_pot_, pots, sizeof(now_pot_));
+  memcpy(now_sw_, switches, sizeof(now_sw_));
+  panel_seen_ = true;
+  if (!recording_)
+    return;
+  Sync();
+
+  bool flushed = false;
+  for (uint8_t i = 0; i < TRACE_POT_COUNT; i++)
+  {
+    uint16_t v = pots[i];
+    if (primed_ && v == pot_[i])
+      continue;
+    if (!flushed)
+    {
+      FlushPasses();
+      flushed = true;
+    }
+    pot_[i] = v;
+    Append(TRACE_POT, i, v);
+  }
+  for (uint8_t i = 0; i < TRACE_SWITCH_COUNT; i++)
+  {
+    uint8_t v = switches[i];
+    if (primed_ && v == sw_[i])
+      continue;
+    if (!flushed)
+    {
+      FlushPasses();
+      flushed = true;
+    }
+    sw_[i] = v;
+    Append(TRACE_SWITCH, i, v);
+  }
+  primed_ = true;
+  pending_passes_++;
+}
+
+void ControlTrace::CaptureMidi(uint8_t status, uint8_t data1, uint8_t data2)
+{
+  Track(status, data1, data2);
+  if (!recording_)
+    return;
+  Sync();
+  FlushPasses();
+  Append(TRACE_MIDI, status, (uint16_t)(data1 | (data2 << 8)));
+}
+
+/**
+ * snapshot
+ */
+void ControlTrace::Track(uint8_t status, uint8_t data1, uint8_t data2)
+{
+  data1 &= 0x7f;
+  if ((status & 0xe0) == 0x80)
+  {
+    memcpy(note_cc_seen_, cc_seen_, sizeof(cc_seen_));
+    memcpy(note_cc_status_, cc_status_, sizeof(cc_status_));
+    memcpy(note_cc_value_, cc_value_, sizeof(cc_value_));
+  }
+  switch (status & 0xf0)
+  {
+  case 0x90:
+    Unhold(data1);
+    // velocity 0 is a note-off
+    if (data2 == 0)
+      break;
+    held_status_[data1] = status;
+    held_velocity_[data1] = data2;
+    held_[held_count_++] = data1;
+    break;
+  case 0x80:
+    Unhold(data1);
+    break;
+  case 0xB0:
+    if (data1 == TRACE_CC_RECORD)
+      break;
+    if (data1 == TRACE_CC_CAPTURE_A || data1 == TRACE_CC_CAPTURE_B)
+    {
+      // the engine captures the panel it was last given, the last pass's
+      int end = data1 == TRACE_CC_CAPTURE_B;
+      if (data2 >= 64 && panel_seen_)
+      {
+        end_seen_[end] = true;
+        end_status_[end] = status;
+        memcpy(end_pot_[end], now_pot_, sizeof(now_pot_));
+        memcpy(end_sw_[end], now_sw_, sizeof(now_sw_));
+      }
+      break;
+    }
+    cc_seen_[data1 >> 5] |= 1u << (data1 & 31);
+    cc_status_[data1] = status;
+    cc_value_[data1] = data2;
+    break;
+  default:
+    break;
+  }
+}
+
+void ControlTrace::Unhold(uint8_t note)
+{
+  for (uint8_t i = 0; i < held_count_; i++)
+  {
+    if (held_[i] != note)
+      continue;
+    memmove(&held_[i], &held_[i + 1], held_count_ - i - 1);
+    held_count_--;
+    return;
+  }
+}
+
+void ControlTrace::AppendPanel(const uint16_t *pots, const uint8_t *switches)
+{
+  for (uint8_t i = 0; i < TRACE_POT_COUNT; i++)
+    Append(TRACE_POT, i, pots[i]);
+  for (uint8_t i = 0; i < TRACE_SWITCH_COUNT; i++)
+    Append(TRACE_SWITCH, i, switches[i]);
+}
+
+// ends first, so the panel the trace goes on from is the last one set
+void ControlTrace::Snapshot()
+{
+  if (panel_seen_)
+  {
+    for (int end = 0; end < 2; end++)
+    {
+      if (!end_seen_[end])
+        continue;
+      AppendPanel(end_pot_[end], end_sw_[end]);
+      Append(TRACE_PASSES, 0, TRACE_SETTLE_PASSES);
+      uint8_t cc = end ? TRACE_CC_CAPTURE_B : TRACE_CC_CAPTURE_A;
+      Append(TRACE_MIDI, end_status_[end], (uint16_t)(cc | (127 << 8)));
+    }
+    AppendPanel(now_pot_, now_sw_);
+    Append(TRACE_PASSES, 0, TRACE_SETTLE_PASSES);
+    memcpy(pot_, now_pot_, sizeof(pot_));
+    memcpy(sw_, now_sw_, sizeof(sw_));
+    primed_ = true;
+  }
+  // the notes under the settings they were played with, then the changes
+  for (uint8_t cc = 0; cc < 128; cc++)
+    if ((note_cc_seen_[cc >> 5] >> (cc & 31)) & 1u)
+      Append(TRACE_MIDI, note_cc_status_[cc], (uint16_t)(cc | (note_cc_value_[cc] << 8)));
+  for (uint8_t i = 0; i < held_count_; i++)
+  {
+    uint8_t note = held_[i];
+    Append(TRACE_MIDI, held_status_[note], (uint16_t)(note | (held_velocity_[note] << 8)));
+  }
+  for (uint8_t cc = 0; cc < 128; cc++)
+  {
+    if (!((cc_seen_[cc >> 5] >> (cc & 31)) & 1u))
+      continue;
+    if (((note_cc_seen_[cc >> 5] >> (cc & 31)) & 1u) && note_cc_status_[cc] == cc_status_[cc] &&
+        note_cc_value_[cc] == cc_value_[cc])
+      continue;
+    Append(TRACE_MIDI, cc_status_[cc], (uint16_t)(cc | (cc_value_[cc] << 8)));
+  }
+}
+
+size_t ControlTrace::Drain(uint8_t *buf, size_t capacity)
+{
+  if (!draining_)
+    return 0;
+  const size_t head = sizeof(ControlTraceHeader);
+  const size_t total = head + count_ * sizeof(ControlTraceEvent);
+  size_t len = 0;
+  while (drain_pos_ < total && len < capacity)
+  {
+    const uint8_t *src;
+    size_t avail;
+    if (drain_pos_ < head)
+    {
+      src = (const uint8_t *)&header_ + drain_pos_;
+      avail = head - drain_pos_;
+    }
+    else
+    {
+      src = (const uint8_t *)buf_ + (drain_pos_ - head);
+      avail = total - drain_pos_;
+    }
+    size_t n = capacity - len < avail ? capacity - len : avail;
+    memcpy(buf + len, src, n);
+    len += n;
+    drain_pos_ += n;
+  }
+  if (drain_pos_ >= total)
+    draining_ = false;
+  return len;
+}
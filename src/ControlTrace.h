@@ -0,0 +1,144 @@
+#pragma once
+#include "DaisyDuino.h"
+#include <atomic>
+
+// events the SDRAM trace buffer holds (4 bytes each)
+#define TRACE_CAPACITY (2 * 1024 * 1024)
+#define TRACE_MAGIC 0x54434D53 // "SMCT"
+#define TRACE_VERSION 1
+#define TRACE_POT_COUNT 12
+#define TRACE_SWITCH_COUNT 7
+
+// control passes that settle a panel given all at once: the pots' 2 ms
+// slew down to float resolution, the switch debouncers' 8 readings
+#define TRACE_SETTLE_PASSES 64
+// the engine's morph captures (see VoiceManager::ControlChange) and the
+// sketch's own start / stop: actions, not state to carry into a trace
+#define TRACE_CC_CAPTURE_A 112
+#define TRACE_CC_CAPTURE_B 113
+#define TRACE_CC_RECORD 119
+
+#define TRACE_FLAG_OVERFLOW 0x01
+// the voice ran 2x oversampled (VoiceManager::Init)
+#define TRACE_FLAG_OVERSAMPLE2 0x02
+
+enum ControlTraceKind
+{
+  TRACE_PASSES, // value = control passes run with the current inputs
+  TRACE_BLOCKS, // value = audio blocks rendered
+  TRACE_POT,    // id = PotId, value = raw analogRead()
+  TRACE_SWITCH, // id = SwitchId, value = raw pin level
+  TRACE_MIDI,   // id = status byte, value = data1 | data2 << 8
+};
+
+struct __attribute__((packed)) ControlTraceEvent
+{
+  uint8_t kind; // ControlTraceKind
+  uint8_t id;
+  uint16_t value;
+};
+
+// starts every dump, little-endian, followed by `events` ControlTraceEvent
+struct __attribute__((packed)) ControlTraceHeader
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t block_size;
+  uint32_t sample_rate;
+  uint32_t events;
+  uint32_t flags; // TRACE_FLAG_*
+};
+
+// pins behind the trace ids, shared by the recorder and the replay
+int ControlTracePotPin(uint8_t id);
+int ControlTraceSwitchPin(uint8_t id);
+
+/**
+ * Records what the front panel sees: raw pot and switch readings, MIDI
+ * messages and how control passes interleave with audio blocks. The
+ * stream only stores changes and run lengths, so replaying it in order
+ * (set pins, dispatch MIDI, run N passes, render N blocks) drives
+ * SynthHardware and the engine through the same sequence of inputs,
+ * deadbands and debouncers included.
+ *
+ * A trace can start at any time: Start() writes what the engine has been
+ * told so far as time-zero events, ahead of any block. That is the morph
+ * ends (the panel each was captured from, settled, then its capture CC),
+ * the current panel, every CC as it stood at the last note event, the held
+ * notes in the order they were played, then the CCs moved since. The voice's own running state (oscillator and
+ * LFO phase, envelopes, the sequencer's place in its pattern) is not
+ * carried over; it restarts with the replay.
+ *
+ * All writes happen on the loop() side; the audio callback only bumps a
+ * block counter.
+ */
+class ControlTrace
+{
+public:
+  void Init(ControlTraceEvent *buffer, size_t capacity);
+  // clears the buffer and writes the snapshot; with no pass seen yet, the
+  // first pass records the whole panel
+  void Start(float sample_rate, size_t block_size, size_t oversample = 1);
+  // ends the recording and arms Drain()
+  void Stop();
+  bool Recording() const { return recording_; }
+
+  /* audio side */
+  void TickBlock() { blocks_.fetch_add(1, std::memory_order_relaxed); }
+
+  /* loop() side */
+  // once per SynthHardware::UpdateControls, with the pass's readings
+  // (TRACE_POT_COUNT pots, TRACE_SWITCH_COUNT switch levels) before the
+  // controls are given them; also while not recording, for the snapshot
+  void CapturePass(const uint16_t *pots, const uint8_t *switches);
+  // every message the engine is given, recording or not
+  void CaptureMidi(uint8_t status, uint8_t data1, uint8_t data2);
+
+  size_t Events() const { return count_; }
+  bool Overflowed() const { return overflow_; }
+
+  // header + events after Stop(), as many bytes as fit, resumable
+  size_t Drain(uint8_t *buf, size_t capacity);
+  bool Draining() const { return draining_; }
+
+private:
+  void Sync();
+  void FlushPasses();
+  void Append(uint8_t kind, uint8_t id, uint16_t value);
+  void AppendPanel(const uint16_t *pots, const uint8_t *switches);
+  void Snapshot();
+  void Track(uint8_t status, uint8_t data1, uint8_t data2);
+  void Unhold(uint8_t note);
+
+  ControlTraceEvent *buf_ = nullptr;
+  size_t capacity_ = 0, count_ = 0;
+  bool armed_ = false, recording_ = false, overflow_ = false, primed_ = false;
+  bool oversample2_ = false;
+  ControlTraceHeader header_;
+  std::atomic<uint32_t> blocks_{0};
+  uint32_t blocks_seen_ = 0;
+  uint32_t pending_passes_ = 0;
+  uint16_t pot_[TRACE_POT_COUNT];
+  uint8_t sw_[TRACE_SWITCH_COUNT];
+  bool draining_ = false;
+  size_t drain_pos_ = 0;
+
+  /* what the engine has been told, kept for the snapshot */
+  bool panel_seen_ = false;
+  uint16_t now_pot_[TRACE_POT_COUNT];
+  uint8_t now_sw_[TRACE_SWITCH_COUNT];
+  bool end_seen_[2] = {false, false};
+  uint8_t end_status_[2];
+  uint16_t end_pot_[2][TRACE_POT_COUNT];
+  uint8_t end_sw_[2][TRACE_SWITCH_COUNT];
+  uint32_t cc_seen_[4] = {0, 0, 0, 0};
+  uint8_t cc_status_[128], cc_value_[128];
+  // the same as they stood at the last note event: some settings (the
+  // note priority) only reach the voice with the next note
+  uint32_t note_cc_seen_[4] = {0, 0, 0, 0};
+  uint8_t note_cc_status_[128], note_cc_value_[128];
+  // held notes, oldest first
+  uint8_t held_count_ = 0;
+  uint8_t held_[128];
+  uint8_t held_status_[128], held_velocity_[128];
+};
@@ -0,0 +1,68 @@
+#include "Governor.h"
+
+void Governor::Init(float sample_rate, size_t block_size, uint32_t cycles_per_second,
+                    uint8_t max_tier)
+{
+  budget_ = (float)cycles_per_second * block_size / sample_rate;
+  blocks_per_second_ = sample_rate / block_size;
+  load_coeff_ = 1.f / (0.05f * blocks_per_second_);
+  if (load_coeff_ > 1.f)
+    load_coeff_ = 1.f;
+  settle_blocks_ = (uint32_t)(0.005f * blocks_per_second_) + 2;
+  max_tier_ = max_tier;
+  tier_ = 0;
+  load_ = 0.f;
+  below_ = settle_ = 0;
+  steps_down_ = steps_up_ = 0;
+  SetThresholds(down_, up_, 2.f);
+}
+
+void Governor::SetThresholds(float down, float up, float hold_seconds)
+{
+  down_ = down;
+  up_ = up < down ? up : down;
+  hold_blocks_ = (uint32_t)(hold_seconds * blocks_per_second_);
+}
+
+bool Governor::Update(uint32_t cycles)
+{
+  float x = cycles / budget_;
+  load_ += load_coeff_ * (x - load_);
+
+  if (settle_ > 0)
+  {
+    settle_--;
+    return false;
+  }
+
+  // react to a single block: the next one may already be an overrun
+  if (x > down_)
+  {
+    below_ = 0;
+    if (tier_ < max_tier_)
+    {
+      tier_++;
+      steps_down_++;
+      settle_ = settle_blocks_;
+      // the average still holds the old tier's cost
+      load_ = x;
+      return true;
+    }
+    return false;
+  }
+
+  if (load_ < up_ && tier_ > 0)
+  {
+    if (++below_ >= hold_blocks_)
+    {
+      tier_--;
+      steps_up_++;
+      below_ = 0;
+      settle_ = settle_blocks_;
+      return true;
+    }
+  }
+  else
+    below_ = 0;
+  return false;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "DaisyDuino.h"
+
+/**
+ * Watches the measured cost of each audio callback against the block
+ * period and picks a quality tier (0 = full quality, higher = cheaper)
+ * before the callback runs out of time.
+ *
+ * Down: one tier as soon as a block goes over `down` of the budget, then
+ * a short settle so the new tier shows in the measurement before the next
+ * step. Up: one tier once the smoothed load has stayed under `up` for
+ * `hold` seconds. The gap between the two, and the hold, keep it from
+ * hunting between tiers on a steady load.
+ */
+class Governor
+{
+public:
+  // budget = cycles available per block (cycles per second * block / sr)
+  void Init(float sample_rate, size_t block_size, uint32_t cycles_per_second,
+            uint8_t max_tier);
+  void SetThresholds(float down, float up, float hold_seconds);
+
+  // once per block with the measured callback cost, true when the tier changed
+  bool Update(uint32_t cycles);
+
+  uint8_t Tier() const { return tier_; }
+  // smoothed load, 1 = the whole block period
+  float Load() const { return load_; }
+  uint32_t StepsDown() const { return steps_down_; }
+  uint32_t StepsUp() const { return steps_up_; }
+
+private:
+  float budget_ = 1.f;
+  float blocks_per_second_ = 1000.f;
+  float down_ = 0.8f, up_ = 0.5f;
+  uint32_t hold_blocks_ = 2000;
+  uint32_t settle_blocks_ = 8;
+  // one-pole load average, ~50 ms
+  float load_ = 0.f, load_coeff_ = 0.02f;
+  uint8_t tier_ = 0, max_tier_ = 0;
+  uint32_t below_ = 0, settle_ = 0;
+  uint32_t steps_down_ = 0, steps_up_ = 0;
+};
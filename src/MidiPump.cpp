@@ -0,0 +1,10 @@
+#include "MidiPump.h"
+
+void MidiPump::Init(uint16_t budget, size_t rx_capacity)
+{
+  budget_ = budget;
+  rx_full_ = rx_capacity > 1 ? rx_capacity - 1 : 1;
+  overflows_.store(0, std::memory_order_relaxed);
+  deferred_ = messages_ = 0;
+  max_per_pass_ = 0;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "DaisyDuino.h"
+#include <atomic>
+
+// MIDI messages parsed per loop() pass, 0 = drain whatever is waiting
+#ifndef MIDI_PASS_BUDGET
+#define MIDI_PASS_BUDGET 8
+#endif
+// UART receive buffer of the MIDI port (the core's default ring)
+#ifdef SERIAL_RX_BUFFER_SIZE
+#define MIDI_RX_BUFFER SERIAL_RX_BUFFER_SIZE
+#else
+#define MIDI_RX_BUFFER 64
+#endif
+// longest channel message, bounds the bytes a pass may consume
+#define MIDI_MAX_MESSAGE_BYTES 3
+
+/**
+ * Bounded MIDI parsing for loop(): each pass hands at most `budget`
+ * complete messages to the handlers, so a burst cannot hold off the
+ * control update, and whatever is left waits in the UART buffer for the
+ * next pass.
+ *
+ * The parser consumes one byte per read() call; a pass stops after
+ * budget * MIDI_MAX_MESSAGE_BYTES calls even without a complete message
+ * (running sysex). A pass that starts with the receive buffer full counts
+ * as an overflow: the UART has been dropping bytes since it filled.
+ */
+class MidiPump
+{
+public:
+  void Init(uint16_t budget = MIDI_PASS_BUDGET, size_t rx_capacity = MIDI_RX_BUFFER);
+  void SetBudget(uint16_t messages) { budget_ = messages; }
+  uint16_t Budget() const { return budget_; }
+
+  // read(): parses one byte, true when it completed a message (and ran its
+  // handler); pending(): bytes waiting in the receive buffer
+  template <typename Read, typename Pending>
+  uint16_t Pump(Read read, Pending pending);
+
+  /* counters, readable from the audio side (telemetry) */
+  // passes that found the receive buffer full
+  uint32_t Overflows() const { return overflows_.load(std::memory_order_relaxed); }
+  // passes that used up the budget with bytes still waiting
+  uint32_t Deferred() const { return deferred_; }
+  uint32_t Messages() const { return messages_; }
+  uint16_t MaxPerPass() const { return max_per_pass_; }
+
+private:
+  uint16_t budget_ = MIDI_PASS_BUDGET;
+  // the ring keeps one slot free: full at capacity - 1
+  size_t rx_full_ = MIDI_RX_BUFFER - 1;
+  std::atomic<uint32_t> overflows_{0};
+  uint32_t deferred_ = 0, messages_ = 0;
+  uint16_t max_per_pass_ = 0;
+};
+
+template <typename Read, typename Pending>
+uint16_t MidiPump::Pump(Read read, Pending pending)
+{
+  size_t waiting = pending();
+  if (waiting == 0)
+    return 0;
+  if (waiting >= rx_full_)
+    overflows_.fetch_add(1, std::memory_order_relaxed);
+
+  uint16_t n = 0;
+  uint32_t bytes = 0;
+  const uint32_t max_bytes = (uint32_t)budget_ * MIDI_MAX_MESSAGE_BYTES;
+  while (pending() > 0)
+  {
+    if (budget_ && (n >= budget_ || bytes >= max_bytes))
+    {
+      deferred_++;
+      break;
+    }
+    bytes++;
+    if (read())
+      n++;
+  }
+  messages_ += n;
+  if (n > max_per_pass_)
+    max_per_pass_ = n;
+  return n;
+}
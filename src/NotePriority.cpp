@@ -0,0 +1,98 @@
+#include "NotePriority.h"
+
+void NotePriority::Init()
+{
+  mode_ = NOTE_PRIORITY_LAST;
+  Clear();
+}
+
+void NotePriority::Clear()
+{
+  count_ = 0;
+  head_ = NONE;
+  for (int w = 0; w < 4; w++)
+    held_bits_[w] = 0;
+  for (int n = 0; n < 128; n++)
+  {
+    prev_[n] = next_[n] = NONE;
+    velocity_[n] = 0;
+  }
+}
+
+bool NotePriority::IsHeld(byte note) const
+{
+  note &= 0x7f;
+  return (held_bits_[note >> 5] >> (note & 31)) & 1u;
+}
+
+void NotePriority::Push(byte note, byte velocity)
+{
+  note &= 0x7f;
+  velocity_[note] = velocity;
+  if (IsHeld(note))
+  {
+    // retriggered while held: only moves to the front of the press order
+    if (head_ == note)
+      return;
+    Release(note);
+    velocity_[note] = velocity;
+  }
+  held_bits_[note >> 5] |= 1u << (note & 31);
+  prev_[note] = NONE;
+  next_[note] = head_;
+  if (head_ != NONE)
+    prev_[head_] = note;
+  head_ = note;
+  count_++;
+}
+
+void NotePriority::Release(byte note)
+{
+  note &= 0x7f;
+  if (!IsHeld(note))
+    return;
+  held_bits_[note >> 5] &= ~(1u << (note & 31));
+  if (prev_[note] != NONE)
+    next_[prev_[note]] = next_[note];
+  else
+    head_ = next_[note];
+  if (next_[note] != NONE)
+    prev_[next_[note]] = prev_[note];
+  prev_[note] = next_[note] = NONE;
+  count_--;
+}
+
+byte NotePriority::Current() const
+{
+  switch (mode_)
+  {
+  case NOTE_PRIORITY_LOW:
+    return Lowest();
+  case NOTE_PRIORITY_HIGH:
+    return Highest();
+  case NOTE_PRIORITY_LAST:
+  default:
+    return head_;
+  }
+}
+
+// count-trailing-zeros is RBIT + CLZ on the M7
+byte NotePriority::Lowest() const
+{
+  for (int w = 0; w < 4; w++)
+  {
+    if (held_bits_[w])
+      return (byte)((w << 5) + __builtin_ctz(held_bits_[w]));
+  }
+  return NONE;
+}
+
+byte NotePriority::Highest() const
+{
+  for (int w = 3; w >= 0; w--)
+  {
+    if (held_bits_[w])
+      return (byte)((w << 5) + 31 - __builtin_clz(held_bits_[w]));
+  }
+  return NONE;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "DaisyDuino.h"
+
+enum NotePriorityMode
+{
+  NOTE_PRIORITY_LAST,
+  NOTE_PRIORITY_LOW,
+  NOTE_PRIORITY_HIGH,
+};
+
+/**
+ * Set of held MIDI notes with constant-time push / release / lookup.
+ * - a 128-bit bitset answers low and high priority with one count-zeros per word
+ * - an intrusive doubly linked list indexed by note number keeps the press order
+ *   for last-note priority, unlinking a released note from anywhere in O(1)
+ * No scan, no stale entries, whatever order notes are released in.
+ */
+class NotePriority
+{
+public:
+  void Init();
+  void Clear();
+
+  void SetMode(NotePriorityMode mode) { mode_ = mode; }
+  NotePriorityMode GetMode() const { return mode_; }
+
+  void Push(byte note, byte velocity);
+  void Release(byte note);
+
+  bool Empty() const { return count_ == 0; }
+  byte Count() const { return count_; }
+  bool IsHeld(byte note) const;
+
+  // note that should sound under the current mode, only valid when !Empty()
+  byte Current() const;
+  byte Velocity(byte note) const { return velocity_[note & 0x7f]; }
+
+private:
+  static const byte NONE = 0xff;
+  NotePriorityMode mode_;
+  byte count_;
+
+  uint32_t held_bits_[4];
+
+  // most recent note at the head
+  byte head_;
+  byte prev_[128], next_[128];
+  byte velocity_[128];
+
+  byte Lowest() const;
+  byte Highest() const;
+};
@@ -0,0 +1,103 @@
+#include "ParamMorph.h"
+#include <math.h>
+
+void ParamMorph::Init(float sample_rate)
+{
+  slew_ = 1000.f / (MORPH_SLEW_MS * sample_rate);
+  live_.store(0, std::memory_order_relaxed);
+  ready_.store(false, std::memory_order_relaxed);
+  enabled_.store(false, std::memory_order_relaxed);
+  edges_.store(0, std::memory_order_relaxed);
+  applied_edges_ = 0;
+  target_.store(0.f, std::memory_order_relaxed);
+  position_ = 0.f;
+  half_ = 0;
+  applied_ = false;
+}
+
+/**
+ * loop() side
+ */
+void ParamMorph::SetEnds(const ResolvedParams (&ends)[2][2])
+{
+  uint8_t next = live_.load(std::memory_order_relaxed) ^ 1;
+  Table &t = tables_[next];
+  for (size_t h = 0; h < 2; h++)
+  {
+    t.modes[h] = ends[h][0];
+    for (size_t i = 0; i < RESOLVED_COUNT; i++)
+    {
+      bool log = i == RESOLVED_CUTOFF || (i == RESOLVED_LFO_RATE && ends[h][0].lfo_type != LFO_TYPE_NOISE);
+      float a = ends[h][0].value[i];
+      float b = ends[h][1].value[i];
+      if (log)
+      {
+        a = log2f(a > 1e-6f ? a : 1e-6f);
+        b = log2f(b > 1e-6f ? b : 1e-6f);
+      }
+      t.base[h][i] = a;
+      t.delta[h][i] = b - a;
+      t.log[h][i] = log;
+    }
+  }
+  live_.store(next, std::memory_order_release);
+  ready_.store(true, std::memory_order_release);
+}
+
+void ParamMorph::SetPosition(float position)
+{
+  target_.store(position < 0.f ? 0.f : (position > 1.f ? 1.f : position), std::memory_order_relaxed);
+}
+
+/**
+ * audio side
+ */
+bool ParamMorph::Process(size_t size, ResolvedParams &out)
+{
+  if (!Enabled())
+  {
+    applied_ = false;
+    return false;
+  }
+  const uint32_t edges = edges_.load(std::memory_order_acquire);
+  if (edges != applied_edges_)
+  {
+    applied_edges_ = edges;
+    applied_ = false;
+  }
+
+  // a one-pole glide towards the control, so 7-bit CC steps do not zip;
+  // the first block after an enable starts where the control is
+  float target = target_.load(std::memory_order_relaxed);
+  float k = size * slew_;
+  position_ += (target - position_) * (k < 1.f ? k : 1.f);
+  if (!applied_ || fabsf(target - position_) < 1e-4f)
+    position_ = target;
+
+  uint8_t live = live_.load(std::memory_order_acquire);
+  if (applied_ && position_ == applied_position_ && live == applied_table_)
+    return false;
+
+  if (!applied_)
+    half_ = position_ >= MORPH_THRESHOLD ? 1 : 0;
+  else if (half_ == 0 && position_ >= MORPH_THRESHOLD + MORPH_HYSTERESIS)
+    half_ = 1;
+  else if (half_ == 1 && position_ <= MORPH_THRESHOLD - MORPH_HYSTERESIS)
+    half_ = 0;
+
+  const Table &t = tables_[live];
+  const float x = position_;
+  for (size_t i = 0; i < RESOLVED_COUNT; i++)
+    out.value[i] = t.base[half_][i] + x * t.delta[half_][i];
+  for (size_t i = 0; i < RESOLVED_COUNT; i++)
+    if (t.log[half_][i])
+      out.value[i] = exp2f(out.value[i]);
+  out.osc_type = t.modes[half_].osc_type;
+  out.amp_mode = t.modes[half_].amp_mode;
+  out.lfo_type = t.modes[half_].lfo_type;
+
+  applied_ = true;
+  applied_position_ = position_;
+  applied_table_ = live;
+  return true;
+}
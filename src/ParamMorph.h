@@ -0,0 +1,82 @@
+#pragma once
+#include "DaisyDuino.h"
+#include "SynthParams.h"
+#include <atomic>
+
+// morph position where the switch-derived modes change from A's to B's
+#define MORPH_THRESHOLD 0.5f
+// either side of the threshold, so a wheel resting on it does not chatter
+#define MORPH_HYSTERESIS 0.02f
+// time the position takes to follow a jump of the control, ms
+#define MORPH_SLEW_MS 20.f
+
+/**
+ * Crossfade between two captured sounds, A at position 0 and B at 1.
+ *
+ * Both ends come in resolved (Voice::Resolve), so no knob curve is
+ * re-derived while the position moves. SetEnds() turns each value into
+ * the domain it is crossfaded in, once per capture: the cutoff and the
+ * LFO rate as log2 (so the middle of a morph is the middle in pitch /
+ * tempo; the noise tilt, which goes negative, stays linear), the envelope
+ * times in seconds, everything else as it is. Each block is then one
+ * multiply-add per value, plus an exp2f for the two log values.
+ *
+ * The modes (oscillator, amp and LFO type) cannot be crossfaded: below
+ * MORPH_THRESHOLD they are A's, above it B's. Each half is computed with
+ * its own modes, both ends resolved under them, so every value follows
+ * one curve all through the half; the only step is the mode change, which
+ * lands between two blocks with every value of the new half in place.
+ *
+ * loop() captures and sets the position; ProcessBlock() runs Process().
+ * Captures go to the table the audio side is not reading, then swap in.
+ */
+class ParamMorph
+{
+public:
+  void Init(float sample_rate);
+
+  /* loop() side */
+  // ends[half][end]: A (end 0) and B (end 1), each resolved under A's
+  // modes (half 0) and under B's (half 1)
+  void SetEnds(const ResolvedParams (&ends)[2][2]);
+  // 0 = A .. 1 = B
+  void SetPosition(float position);
+  // takes effect once both ends are set; every switch on or off counts as
+  // an edge, and the first block after one re-applies the set even when
+  // the audio side never saw the morph off
+  void SetEnabled(bool on)
+  {
+    if (enabled_.exchange(on, std::memory_order_relaxed) != on)
+      edges_.fetch_add(1, std::memory_order_release);
+  }
+  bool Enabled() const { return ready_.load(std::memory_order_acquire) && enabled_.load(std::memory_order_relaxed); }
+
+  /* audio side */
+  // moves the position on by one block of `size` samples; fills `out` and
+  // returns true when the voice has to take a new set
+  bool Process(size_t size, ResolvedParams &out);
+
+private:
+  struct Table
+  {
+    float base[2][RESOLVED_COUNT];
+    float delta[2][RESOLVED_COUNT];
+    bool log[2][RESOLVED_COUNT];
+    ResolvedParams modes[2]; // only the modes are read
+  };
+  Table tables_[2];
+  std::atomic<uint8_t> live_{0};
+  std::atomic<bool> ready_{false};
+  std::atomic<bool> enabled_{false};
+  std::atomic<uint32_t> edges_{0};
+  std::atomic<float> target_{0.f};
+
+  /* audio side */
+  float slew_ = 0.f; // per sample
+  float position_ = 0.f;
+  uint8_t half_ = 0;
+  bool applied_ = false; // last block's set is still the voice's
+  float applied_position_ = -1.f;
+  uint8_t applied_table_ = 0;
+  uint32_t applied_edges_ = 0;
+};
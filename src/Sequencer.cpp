@@ -0,0 +1,310 @@
+#include "Sequencer.h"
+#include <math.h>
+
+// a bass line to start from: octave jumps, a ratchet and two slides
+static const SeqStep DEFAULT_PATTERN[SEQ_STEPS] = {
+    {0, 110, 1, false}, {0, 70, 1, false},  {12, 100, 1, false}, {0, 0, 1, false},
+    {7, 100, 1, false}, {0, 80, 2, false},  {10, 90, 1, false},  {12, 100, 1, true},
+    {0, 110, 1, false}, {0, 70, 1, false},  {12, 100, 1, false}, {3, 90, 1, true},
+    {7, 100, 1, false}, {5, 80, 1, false},  {3, 90, 4, false},   {0, 0, 1, false},
+};
+
+void Sequencer::Init(float sample_rate)
+{
+  sample_rate_ = sample_rate;
+  for (size_t i = 0; i < SEQ_STEPS; i++)
+    steps_[i] = DEFAULT_PATTERN[i];
+  for (size_t i = 0; i < 4; i++)
+    held_[i].store(0, std::memory_order_relaxed);
+  for (size_t i = 0; i < 128; i++)
+    velocity_[i].store(0, std::memory_order_relaxed);
+  root_.store(60, std::memory_order_relaxed);
+  mode_.store(SEQ_MODE_OFF, std::memory_order_relaxed);
+  active_ = SEQ_MODE_OFF;
+  running_ = sounding_ = false;
+  now_ = 0;
+  gate_off_ = -1.;
+  rnd_.Init(RND_SEED_DEFAULT);
+}
+
+void Sequencer::SetTempo(float bpm)
+{
+  bpm_ = bpm < 20.f ? 20.f : (bpm > 400.f ? 400.f : bpm);
+}
+
+void Sequencer::SetDivision(uint8_t steps_per_beat)
+{
+  division_ = steps_per_beat < 1 ? 1 : (steps_per_beat > 8 ? 8 : steps_per_beat);
+}
+
+void Sequencer::SetRatchet(uint8_t hits)
+{
+  ratchet_ = hits < 1 ? 1 : (hits > SEQ_MAX_RATCHET ? SEQ_MAX_RATCHET : hits);
+}
+
+void Sequencer::SetStep(uint8_t index, const SeqStep &step)
+{
+  if (index >= SEQ_STEPS)
+    return;
+  steps_[index] = step;
+  if (steps_[index].ratchet < 1)
+    steps_[index].ratchet = 1;
+  else if (steps_[index].ratchet > SEQ_MAX_RATCHET)
+    steps_[index].ratchet = SEQ_MAX_RATCHET;
+}
+
+/**
+ * held notes
+ */
+void Sequencer::Hold(byte note, byte velocity)
+{
+  note &= 0x7f;
+  velocity_[note].store(velocity, std::memory_order_relaxed);
+  held_[note >> 5].fetch_or(1u << (note & 31), std::memory_order_release);
+  root_.store(note, std::memory_order_relaxed);
+}
+
+void Sequencer::Release(byte note)
+{
+  note &= 0x7f;
+  held_[note >> 5].fetch_and(~(1u << (note & 31)), std::memory_order_release);
+}
+
+bool Sequencer::AnyHeld() const
+{
+  for (size_t i = 0; i < 4; i++)
+    if (held_[i].load(std::memory_order_acquire))
+      return true;
+  return false;
+}
+
+bool Sequencer::IsHeld(int note) const
+{
+  return (held_[note >> 5].load(std::memory_order_acquire) >> (note & 31)) & 1u;
+}
+
+/**
+ * timeline
+ */
+size_t Sequencer::Process(size_t size, SeqEvent *events, size_t max_events)
+{
+  out_ = events;
+  count_ = 0;
+  max_ = max_events;
+
+  // a mode change silences whatever the last mode left sounding
+  SeqMode mode = Mode();
+  if (mode != active_)
+  {
+    if (sounding_)
+      Emit(SEQ_EVENT_NOTE_OFF, 0, note_, 0, false);
+    sounding_ = false;
+    running_ = false;
+    gate_off_ = -1.;
+    active_ = mode;
+  }
+  const uint64_t end = now_ + size;
+  if (active_ == SEQ_MODE_OFF)
+  {
+    now_ = end;
+    return count_;
+  }
+
+  // the arpeggiator plays while notes are held, the pattern all the time;
+  // both start on the first sample of the block they are started in
+  bool play = active_ == SEQ_MODE_STEP || AnyHeld();
+  if (running_ && !play)
+  {
+    running_ = false;
+    // a tied note has no gate-off of its own
+    if (sounding_ && gate_off_ < 0.)
+    {
+      Emit(SEQ_EVENT_NOTE_OFF, 0, note_, 0, false);
+      sounding_ = false;
+    }
+  }
+  else if (!running_ && play)
+  {
+    running_ = true;
+    next_hit_ = (double)now_;
+    hits_left_ = 0;
+    step_ = 0;
+    arp_note_ = -1;
+    arp_up_ = true;
+  }
+
+  while (count_ < max_)
+  {
+    // next thing due: the pending gate-off goes first on a tie
+    double t = running_ ? next_hit_ : HUGE_VAL;
+    bool off = sounding_ && gate_off_ >= 0. && gate_off_ <= t;
+    if (off)
+      t = gate_off_;
+    double at = ceil(t);
+    if (at >= (double)end)
+      break;
+    size_t offset = at > (double)now_ ? (size_t)(at - (double)now_) : 0;
+    if (off)
+    {
+      Emit(SEQ_EVENT_NOTE_OFF, offset, note_, 0, false);
+      sounding_ = false;
+      gate_off_ = -1.;
+      continue;
+    }
+
+    // a new step picks its note and cuts its length into hits
+    bool first = hits_left_ == 0;
+    uint8_t note = note_;
+    bool glide = false;
+    if (first)
+    {
+      uint8_t ratchet = ratchet_;
+      if (active_ == SEQ_MODE_ARP)
+      {
+        arp_note_ = NextArpNote();
+        note = (uint8_t)arp_note_;
+        step_velocity_ = velocity_[note].load(std::memory_order_relaxed);
+      }
+      else
+      {
+        NextStep(note, step_velocity_, ratchet, glide);
+      }
+      hits_left_ = ratchet;
+      hit_len_ = sample_rate_ * 60. / ((double)bpm_ * division_) / ratchet;
+      step_note_ = note;
+    }
+    note = step_note_;
+
+    if (step_velocity_ == 0)
+    {
+      // rest: ends a tie from the step before
+      if (sounding_)
+        Emit(SEQ_EVENT_NOTE_OFF, offset, note_, 0, false);
+      sounding_ = false;
+      gate_off_ = -1.;
+    }
+    else
+    {
+      Emit(SEQ_EVENT_NOTE_ON, offset, note, step_velocity_, glide && sounding_);
+      sounding_ = true;
+      note_ = note;
+      // the gate closes at least a sample before the next hit, so the
+      // envelopes see it and retrigger; full length or a slide ties over
+      bool tie = gate_ >= 1.f || (hits_left_ == 1 && NextGlides());
+      double len = gate_ * hit_len_;
+      if (len > hit_len_ - 1.)
+        len = hit_len_ - 1.;
+      gate_off_ = tie ? -1. : t + len;
+    }
+    hits_left_--;
+    next_hit_ = t + hit_len_;
+  }
+  now_ = end;
+  return count_;
+}
+
+void Sequencer::Emit(SeqEventType type, size_t offset, uint8_t note, uint8_t velocity, bool glide)
+{
+  if (count_ >= max_)
+    return;
+  SeqEvent &e = out_[count_++];
+  e.offset = (uint16_t)offset;
+  e.type = (uint8_t)type;
+  e.note = note;
+  e.velocity = velocity;
+  e.glide = glide;
+}
+
+void Sequencer::NextStep(uint8_t &note, uint8_t &velocity, uint8_t &ratchet, bool &glide)
+{
+  if (step_ >= length_)
+    step_ = 0;
+  const SeqStep &s = steps_[step_];
+  step_ = (uint8_t)((step_ + 1) % length_);
+  int n = root_.load(std::memory_order_relaxed) + s.offset;
+  note = (uint8_t)(n < 0 ? 0 : (n > 127 ? 127 : n));
+  velocity = s.velocity;
+  ratchet = s.ratchet;
+  glide = s.glide;
+}
+
+bool Sequencer::NextGlides() const
+{
+  if (active_ != SEQ_MODE_STEP)
+    return false;
+  const SeqStep &s = steps_[step_ < length_ ? step_ : 0];
+  return s.glide && s.velocity > 0;
+}
+
+/**
+ * arpeggiator order, over whatever is held right now
+ */
+int Sequencer::NextArpNote()
+{
+  auto above = [this](int from) {
+    for (int n = from + 1; n < 128; n++)
+      if (IsHeld(n))
+        return n;
+    return -1;
+  };
+  auto below = [this](int from) {
+    for (int n = from - 1; n >= 0; n--)
+      if (IsHeld(n))
+        return n;
+    return -1;
+  };
+
+  int cur = arp_note_;
+  int n = -1;
+  switch (order_)
+  {
+  case ARP_ORDER_DOWN:
+    n = below(cur < 0 ? 128 : cur);
+    if (n < 0)
+      n = below(128);
+    break;
+  case ARP_ORDER_UP_DOWN:
+    if (arp_up_)
+    {
+      n = above(cur);
+      if (n < 0)
+      {
+        arp_up_ = false;
+        n = below(cur);
+      }
+    }
+    else
+    {
+      n = below(cur);
+      if (n < 0)
+      {
+        arp_up_ = true;
+        n = above(cur);
+      }
+    }
+    if (n < 0)
+      n = above(-1);
+    break;
+  case ARP_ORDER_RANDOM:
+  {
+    int count = 0;
+    for (size_t i = 0; i < 4; i++)
+      count += __builtin_popcount(held_[i].load(std::memory_order_acquire));
+    if (count == 0)
+      break;
+    int pick = (int)((rnd_.NextBipolar() + 1.f) * 0.5f * count);
+    if (pick >= count)
+      pick = count - 1;
+    for (n = above(-1); n >= 0 && pick > 0; pick--)
+      n = above(n);
+    break;
+  }
+  default:
+    n = above(cur);
+    if (n < 0)
+      n = above(-1);
+    break;
+  }
+  // released between AnyHeld() and here: repeat the last note
+  return n >= 0 ? n : (cur >= 0 ? cur : 60);
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include "DaisyDuino.h"
+#include "SynthParams.h"
+#include "vs_random.h"
+#include <atomic>
+
+// steps in the pattern
+#define SEQ_STEPS 16
+// most hits in one step
+#define SEQ_MAX_RATCHET 4
+// events one audio block can carry, more wait for the next block
+#define SEQ_MAX_EVENTS 16
+
+// CC 108 picks one: 1/8, 1/8T, 1/16, 1/16T (steps per quarter note)
+static const uint8_t SEQ_DIVISIONS[4] = {2, 3, 4, 6};
+
+enum SeqEventType
+{
+  SEQ_EVENT_NOTE_ON,
+  SEQ_EVENT_NOTE_OFF,
+};
+
+// something for the voice to do at a sample of the current block
+struct SeqEvent
+{
+  uint16_t offset; // sample in the block
+  uint8_t type;    // SeqEventType
+  uint8_t note;
+  uint8_t velocity;
+  bool glide;      // slide from the sounding note, no retrigger
+};
+
+struct SeqStep
+{
+  int8_t offset;    // semitones from the root
+  uint8_t velocity; // 0 = rest
+  uint8_t ratchet;  // hits in the step, 1..SEQ_MAX_RATCHET
+  bool glide;       // slides in from the previous step, tied
+};
+
+/**
+ * Clock, arpeggiator and step sequencer, run from the audio callback.
+ *
+ * Time is counted in samples of the codec rate: every hit lands on the
+ * exact sample it is due, whatever the block size and whenever loop()
+ * runs, so fast arpeggios and ratchets do not jitter. Process() turns
+ * the next block's worth of timeline into SeqEvents; VoiceManager splits
+ * the block at their offsets.
+ *
+ * loop() only sets parameters and the held notes. Held notes are a
+ * bitset of atomic words, so the audio side always sees whole notes
+ * going in and out, never a half-updated list.
+ */
+class Sequencer
+{
+public:
+  void Init(float sample_rate);
+  // arpeggiator random order, same generator as the LFO random modes
+  void SetSeed(uint32_t seed) { rnd_.Init(seed); }
+
+  /* loop() side */
+  void SetMode(SeqMode mode) { mode_.store(mode, std::memory_order_relaxed); }
+  SeqMode Mode() const { return mode_.load(std::memory_order_relaxed); }
+  void SetTempo(float bpm);
+  // steps per quarter note: 2 = 1/8, 3 = 1/8T, 4 = 1/16, 6 = 1/16T
+  void SetDivision(uint8_t steps_per_beat);
+  // share of a hit the gate stays open, 1 ties into the next hit
+  void SetGate(float length) { gate_ = length < 0.05f ? 0.05f : (length > 1.f ? 1.f : length); }
+  // arpeggiator hits per step
+  void SetRatchet(uint8_t hits);
+  void SetArpOrder(ArpOrder order) { order_ = order; }
+  void SetLength(uint8_t steps) { length_ = steps < 1 ? 1 : (steps > SEQ_STEPS ? SEQ_STEPS : steps); }
+  void SetStep(uint8_t index, const SeqStep &step);
+
+  void Hold(byte note, byte velocity);
+  void Release(byte note);
+
+  /* audio side */
+  // events in the next `size` samples, in time order
+  size_t Process(size_t size, SeqEvent *events, size_t max_events);
+
+private:
+  bool AnyHeld() const;
+  bool IsHeld(int note) const;
+  int NextArpNote();
+  void NextStep(uint8_t &note, uint8_t &velocity, uint8_t &ratchet, bool &glide);
+  bool NextGlides() const;
+  void Emit(SeqEventType type, size_t offset, uint8_t note, uint8_t velocity, bool glide);
+
+  float sample_rate_ = 48000.f;
+
+  /* parameters, written by loop() */
+  std::atomic<SeqMode> mode_{SEQ_MODE_OFF};
+  float bpm_ = 120.f;
+  uint8_t division_ = 4;
+  float gate_ = 0.5f;
+  uint8_t ratchet_ = 1;
+  ArpOrder order_ = ARP_ORDER_UP;
+  uint8_t length_ = SEQ_STEPS;
+  SeqStep steps_[SEQ_STEPS];
+  std::atomic<uint32_t> held_[4];
+  std::atomic<uint8_t> velocity_[128];
+  // root of the step pattern: last note played
+  std::atomic<uint8_t> root_{60};
+
+  /* timeline, audio side */
+  SeqMode active_ = SEQ_MODE_OFF;
+  bool running_ = false;
+  uint64_t now_ = 0;      // first sample of the block being processed
+  double next_hit_ = 0.;  // samples
+  double gate_off_ = -1.; // samples, < 0 = none pending
+  double hit_len_ = 0.;
+  uint8_t hits_left_ = 0; // in the current step
+  uint8_t step_ = 0;
+  int arp_note_ = -1;
+  bool arp_up_ = true;
+  bool sounding_ = false;
+  uint8_t note_ = 0; // sounding
+  uint8_t step_note_ = 0, step_velocity_ = 0;
+  VS_Random rnd_;
+  uint32_t const RND_SEED_DEFAULT = 0x5EED5E9u;
+
+  SeqEvent *out_ = nullptr;
+  size_t count_ = 0, max_ = 0;
+};
@@ -1,56 +1,99 @@
 #include "SynthHardware.h"
 
+static DaisyDuinoSampleRate CodecRate()
+{
+#if AUDIO_RATE_KHZ == 96
+    return AUDIO_SR_96K;
+#elif AUDIO_RATE_KHZ == 32
+    return AUDIO_SR_32K;
+#else
+    return AUDIO_SR_48K;
+#endif
+}
+
+static const uint8_t POT_PINS[POT_COUNT] = {
+    OSC_PARAM_POT,      // POT_OSC_PARAM
+    OSC_ENV_AMT_POT,    // POT_ENV_OSC_AMT
+    OSC_LFO_AMT_POT,    // POT_LFO_OSC_AMT
+    CUTOFF_POT,         // POT_CUTOFF
+    RESO_POT,           // POT_RESO
+    ENV_CUTOFF_AMT_POT, // POT_ENV_CUTOFF_AMT
+    LFO_CUTOFF_AMT_POT, // POT_LFO_CUTOFF_AMT
+    ATTACK_POT,         // POT_ATTACK
+    DECAY_POT,          // POT_DECAY
+    SUSTAIN_POT,        // POT_SUSTAIN
+    RELEASE_POT,        // POT_RELEASE
+    LFO_RATE_POT,       // POT_LFO_RATE
+};
+
+static const uint8_t SWITCH_PINS[SW_COUNT] = {
+    OSC_TRI_SW,        // SW_OSC_TRI
+    OSC_SQ_SW,         // SW_OSC_SQ
+    AMP_ADSR_MODE_SW,  // SW_AMP_ADSR
+    AMP_DRONE_MODE_SW, // SW_AMP_DRONE
+    LFO_SIG_RAND_SW,   // SW_LFO_SIG_RAND
+    LFO_SHAPE_1_SW,    // SW_LFO_SHAPE_1
+    LFO_SHAPE_3_SW,    // SW_LFO_SHAPE_3
+};
+
+int SynthHardware::PotPin(uint8_t id)
+{
+    return id < POT_COUNT ? POT_PINS[id] : -1;
+}
+
+int SynthHardware::SwitchPin(uint8_t id)
+{
+    return id < SW_COUNT ? SWITCH_PINS[id] : -1;
+}
+
 void SynthHardware::Init(float ControlRate)
 {
-    hw_ = DAISY.init(DAISY_SEED, AUDIO_SR_48K);
+    hw_ = DAISY.init(DAISY_SEED, CodecRate());
     sample_rate_ = DAISY.AudioSampleRate();
     control_rate_ = ControlRate;
 
+    for (int i = 0; i < SW_COUNT; i++)
+    {
+        pinMode(SWITCH_PINS[i], INPUT_PULLUP);
+        switches_[i].Init(true);
+    }
+    for (int i = 0; i < POT_COUNT; i++)
+        pot_raw_[i] = (uint16_t)analogRead(POT_PINS[i]);
+
     /* VCO */
-    osc_param_ctl_.Init(OSC_PARAM_POT, control_rate_);
-    osc_param_param_.Init(osc_param_ctl_, -1, 1.f, Parameter::LINEAR);
-    env_osc_amt_ctl_.Init(OSC_ENV_AMT_POT, control_rate_);
-    env_osc_amt_param_.Init(env_osc_amt_ctl_, -1, 1.f, Parameter::LINEAR);
-    lfo_osc_amt_ctl_.Init(OSC_LFO_AMT_POT, control_rate_);
-    lfo_osc_amt_param_.Init(lfo_osc_amt_ctl_, 0.f, 1.f, Parameter::LINEAR);
-    osc_tri_sw_.Init(control_rate_, true, OSC_TRI_SW, INPUT_PULLUP);
-    osc_sq_sw_.Init(control_rate_, true, OSC_SQ_SW, INPUT_PULLUP);
+    pots_[POT_OSC_PARAM].Init(pot_raw_[POT_OSC_PARAM], control_rate_, -1, 1.f, PanelPot::LINEAR);
+    pots_[POT_ENV_OSC_AMT].Init(pot_raw_[POT_ENV_OSC_AMT], control_rate_, -1, 1.f, PanelPot::LINEAR);
+    pots_[POT_LFO_OSC_AMT].Init(pot_raw_[POT_LFO_OSC_AMT], control_rate_, 0.f, 1.f, PanelPot::LINEAR);
 
     /* VCF */
-    cutoff_ctl_.Init(CUTOFF_POT, control_rate_);
-    cutoff_param_.Init(cutoff_ctl_, 20.f, 18000.f, Parameter::LOGARITHMIC);
-    reso_ctl_.Init(RESO_POT, control_rate_);
-    reso_param_.Init(reso_ctl_, 0.f, 0.93f, Parameter::LINEAR);
+    pots_[POT_CUTOFF].Init(pot_raw_[POT_CUTOFF], control_rate_, 20.f, 18000.f, PanelPot::LOGARITHMIC);
+    pots_[POT_RESO].Init(pot_raw_[POT_RESO], control_rate_, 0.f, 0.93f, PanelPot::LINEAR);
     /* VCF MOD */
-    env_cutoff_amt_ctl_.Init(ENV_CUTOFF_AMT_POT, control_rate_);
-    env_cutoff_amt_param_.Init(env_cutoff_amt_ctl_, -1.f, 1.f, Parameter::LINEAR);
-    lfo_cutoff_amt_ctl_.Init(LFO_CUTOFF_AMT_POT, control_rate_);
-    lfo_cutoff_amt_param_.Init(lfo_cutoff_amt_ctl_, 0.f, 1.f, Parameter::LINEAR);
+    pots_[POT_ENV_CUTOFF_AMT].Init(pot_raw_[POT_ENV_CUTOFF_AMT], control_rate_, -1.f, 1.f, PanelPot::LINEAR);
+    pots_[POT_LFO_CUTOFF_AMT].Init(pot_raw_[POT_LFO_CUTOFF_AMT], control_rate_, 0.f, 1.f, PanelPot::LINEAR);
 
     /* ADSR */
-    a_ctl_.Init(ATTACK_POT, control_rate_);
-    d_ctl_.Init(DECAY_POT, control_rate_);
-    s_ctl_.Init(SUSTAIN_POT, control_rate_);
-    r_ctl_.Init(RELEASE_POT, control_rate_);
-    a_param_.Init(a_ctl_, 0, 1.f, Parameter::LINEAR);
-    d_param_.Init(d_ctl_, 0, 1.f, Parameter::LINEAR);
-    s_param_.Init(s_ctl_, 0, 1.f, Parameter::LINEAR);
-    r_param_.Init(r_ctl_, 0, 1.f, Parameter::LINEAR);
-
-    /* AMP MODE */
-    adsr_sw_.Init(control_rate_, true, AMP_ADSR_MODE_SW, INPUT_PULLUP);
-    drone_sw_.Init(control_rate_, true, AMP_DRONE_MODE_SW, INPUT_PULLUP);
+    pots_[POT_ATTACK].Init(pot_raw_[POT_ATTACK], control_rate_, 0, 1.f, PanelPot::LINEAR);
+    pots_[POT_DECAY].Init(pot_raw_[POT_DECAY], control_rate_, 0, 1.f, PanelPot::LINEAR);
+    pots_[POT_SUSTAIN].Init(pot_raw_[POT_SUSTAIN], control_rate_, 0, 1.f, PanelPot::LINEAR);
+    pots_[POT_RELEASE].Init(pot_raw_[POT_RELEASE], control_rate_, 0, 1.f, PanelPot::LINEAR);
 
     /* LFO */
-    lfo_rate_ctl_.Init(LFO_RATE_POT, control_rate_);
-    lfo_rate_param_.Init(lfo_rate_ctl_, 0.f, 1.f, Parameter::LINEAR);
-    lfo_sig_rand_sw_.Init(control_rate_, true, LFO_SIG_RAND_SW, INPUT_PULLUP);
-    lfo_shape_1_sw_.Init(control_rate_, true, LFO_SHAPE_1_SW, INPUT_PULLUP);
-    lfo_shape_3_sw_.Init(control_rate_, true, LFO_SHAPE_3_SW, INPUT_PULLUP);
+    pots_[POT_LFO_RATE].Init(pot_raw_[POT_LFO_RATE], control_rate_, 0.f, 1.f, PanelPot::LINEAR);
 }
 
 void SynthHardware::UpdateControls()
 {
+    // each input is read once per pass: the trace gets the very readings
+    // the controls below are given
+    for (int i = 0; i < POT_COUNT; i++)
+        pot_raw_[i] = (uint16_t)analogRead(POT_PINS[i]);
+    for (int i = 0; i < SW_COUNT; i++)
+        switch_raw_[i] = (uint8_t)digitalRead(SWITCH_PINS[i]);
+    if (trace_)
+        trace_->CapturePass(pot_raw_, switch_raw_);
+    for (int i = 0; i < SW_COUNT; i++)
+        switches_[i].Debounce(switch_raw_[i]);
     UpdateVCO();
     UpdateVCF();
     UpdateAMP();
@@ -59,79 +102,100 @@ void SynthHardware::UpdateControls()
 
 void SynthHardware::UpdateVCO()
 {
-    osc_param_ = osc_param_param_.Process();
-    osc_param_ = DeadbandBipolar(osc_param_, 0.05f);
-    osc_env_amt_ = env_osc_amt_param_.Process();
-    osc_env_amt_ = DeadbandBipolar(osc_env_amt_, 0.05f);
-    osc_lfo_amt_ = lfo_osc_amt_param_.Process();
-    osc_lfo_amt_ = Deadband01(osc_lfo_amt_, 0.02f);
-    osc_lfo_amt_ *= osc_lfo_amt_;
-    osc_tri_sw_.Debounce();
-    osc_sq_sw_.Debounce();
-    if (osc_tri_sw_.Pressed())
-        osc_type_ = OSC_TYPE_TRI;
-    else if (osc_sq_sw_.Pressed())
-        osc_type_ = OSC_TYPE_SQ;
+    params_.osc_param = pots_[POT_OSC_PARAM].Process(pot_raw_[POT_OSC_PARAM]);
+    params_.osc_param = DeadbandBipolar(params_.osc_param, 0.05f);
+    params_.env_osc_amt = pots_[POT_ENV_OSC_AMT].Process(pot_raw_[POT_ENV_OSC_AMT]);
+    params_.env_osc_amt = DeadbandBipolar(params_.env_osc_amt, 0.05f);
+    params_.lfo_osc_amt = pots_[POT_LFO_OSC_AMT].Process(pot_raw_[POT_LFO_OSC_AMT]);
+    params_.lfo_osc_amt = Deadband01(params_.lfo_osc_amt, 0.02f);
+    params_.lfo_osc_amt *= params_.lfo_osc_amt;
+    if (switches_[SW_OSC_TRI].Pressed())
+        params_.osc_type = OSC_TYPE_TRI;
+    else if (switches_[SW_OSC_SQ].Pressed())
+        params_.osc_type = OSC_TYPE_SQ;
     else
-        osc_type_ = OSC_TYPE_SAW;
+        params_.osc_type = OSC_TYPE_SAW;
 }
 
 void SynthHardware::UpdateVCF()
 {
-    cutoff_ = cutoff_param_.Process();
-    reso_ = reso_param_.Process();
-    cutoff_env_amt_ = env_cutoff_amt_param_.Process();
-    cutoff_lfo_amt_ = lfo_cutoff_amt_param_.Process();
+    params_.cutoff = pots_[POT_CUTOFF].Process(pot_raw_[POT_CUTOFF]);
+    params_.reso = pots_[POT_RESO].Process(pot_raw_[POT_RESO]);
+    params_.env_cutoff_amt = pots_[POT_ENV_CUTOFF_AMT].Process(pot_raw_[POT_ENV_CUTOFF_AMT]);
+    params_.lfo_cutoff_amt = pots_[POT_LFO_CUTOFF_AMT].Process(pot_raw_[POT_LFO_CUTOFF_AMT]);
 }
 
 void SynthHardware::UpdateAMP()
 {
-    att_ = a_param_.Process();
-    dec_ = d_param_.Process();
-    sus_ = s_param_.Process();
-    rel_ = r_param_.Process();
-    adsr_sw_.Debounce();
-    drone_sw_.Debounce();
-    if (adsr_sw_.Pressed())
-        amp_mode_ = AMP_MODE_ADSR;
-    else if (drone_sw_.Pressed())
-        amp_mode_ = AMP_MODE_DRONE;
+    params_.attack = pots_[POT_ATTACK].Process(pot_raw_[POT_ATTACK]);
+    params_.decay = pots_[POT_DECAY].Process(pot_raw_[POT_DECAY]);
+    params_.sustain = pots_[POT_SUSTAIN].Process(pot_raw_[POT_SUSTAIN]);
+    params_.release = pots_[POT_RELEASE].Process(pot_raw_[POT_RELEASE]);
+    if (switches_[SW_AMP_ADSR].Pressed())
+        params_.amp_mode = AMP_MODE_ADSR;
+    else if (switches_[SW_AMP_DRONE].Pressed())
+        params_.amp_mode = AMP_MODE_DRONE;
     else
-        amp_mode_ = AMP_MODE_RELEASE;
+        params_.amp_mode = AMP_MODE_RELEASE;
 }
 
 void SynthHardware::UpdateLFO()
 {
-    lfo_rate_ = lfo_rate_param_.Process();
-    lfo_sig_rand_sw_.Debounce();
-    lfo_shape_1_sw_.Debounce();
-    lfo_shape_3_sw_.Debounce();
-    if (lfo_sig_rand_sw_.Pressed() && lfo_shape_1_sw_.Pressed())
+    params_.lfo_rate = pots_[POT_LFO_RATE].Process(pot_raw_[POT_LFO_RATE]);
+    const bool sig_rand = switches_[SW_LFO_SIG_RAND].Pressed();
+    const bool shape_1 = switches_[SW_LFO_SHAPE_1].Pressed();
+    const bool shape_3 = switches_[SW_LFO_SHAPE_3].Pressed();
+    if (sig_rand && shape_1)
     {
-        lfo_type_ = LFO_TYPE_SIN;
+        params_.lfo_type = LFO_TYPE_SIN;
     }
-    else if (lfo_sig_rand_sw_.Pressed() && lfo_shape_3_sw_.Pressed())
+    else if (sig_rand && shape_3)
     {
-        lfo_type_ = LFO_TYPE_FM;
+        params_.lfo_type = LFO_TYPE_FM;
     }
-    else if (lfo_sig_rand_sw_.Pressed()) // lfo shape 2 selected
+    else if (sig_rand) // lfo shape 2 selected
     {
-        lfo_type_ = LFO_TYPE_TRI;
+        params_.lfo_type = LFO_TYPE_TRI;
     }
-    else if (!lfo_sig_rand_sw_.Pressed() && lfo_shape_1_sw_.Pressed())
+    else if (!sig_rand && shape_1)
     {
-        lfo_type_ = LFO_TYPE_STEPPED;
+        params_.lfo_type = LFO_TYPE_STEPPED;
     }
-    else if (!lfo_sig_rand_sw_.Pressed() && lfo_shape_3_sw_.Pressed())
+    else if (!sig_rand && shape_3)
     {
-        lfo_type_ = LFO_TYPE_NOISE;
+        params_.lfo_type = LFO_TYPE_NOISE;
     }
     else // random type 2 selected
     {
-        lfo_type_ = LFO_TYPE_SMOOTH;
+        params_.lfo_type = LFO_TYPE_SMOOTH;
     }
 }
 
+/**
+ * panel inputs
+ */
+void PanelPot::Init(uint16_t raw, float control_rate, float min, float max, Curve curve,
+                    float slew_seconds)
+{
+    coeff_ = 1.0f / (slew_seconds * control_rate * 0.5f);
+    if (coeff_ > 1.f)
+        coeff_ = 1.f;
+    val_ = (float)raw / ANALOG_READ_MAX;
+    pmin_ = min;
+    pmax_ = max;
+    lmin_ = logf(min < 0.0000001f ? 0.0000001f : min);
+    lmax_ = logf(max);
+    curve_ = curve;
+}
+
+float PanelPot::Process(uint16_t raw)
+{
+    val_ += coeff_ * ((float)raw / ANALOG_READ_MAX - val_);
+    if (curve_ == LOGARITHMIC)
+        return expf((val_ * (lmax_ - lmin_)) + lmin_);
+    return (val_ * (pmax_ - pmin_)) + pmin_;
+}
+
 static inline float Deadband01(float x, float db)
 {
     if (x <= db)
@@ -155,29 +219,29 @@ float SynthHardware::GetPot(PotId id) const
     switch (id)
     {
     case POT_OSC_PARAM:
-        return osc_param_;
+        return params_.osc_param;
     case POT_ENV_OSC_AMT:
-        return osc_env_amt_;
+        return params_.env_osc_amt;
     case POT_LFO_OSC_AMT:
-        return osc_lfo_amt_;
+        return params_.lfo_osc_amt;
     case POT_CUTOFF:
-        return cutoff_;
+        return params_.cutoff;
     case POT_RESO:
-        return reso_;
+        return params_.reso;
     case POT_ENV_CUTOFF_AMT:
-        return cutoff_env_amt_;
+        return params_.env_cutoff_amt;
     case POT_LFO_CUTOFF_AMT:
-        return cutoff_lfo_amt_;
+        return params_.lfo_cutoff_amt;
     case POT_ATTACK:
-        return att_;
+        return params_.attack;
     case POT_DECAY:
-        return dec_;
+        return params_.decay;
     case POT_SUSTAIN:
-        return sus_;
+        return params_.sustain;
     case POT_RELEASE:
-        return rel_;
+        return params_.release;
     case POT_LFO_RATE:
-        return lfo_rate_;
+        return params_.lfo_rate;
     default:
         return 0;
     }
@@ -185,15 +249,15 @@ float SynthHardware::GetPot(PotId id) const
 
 OscType SynthHardware::GetOscType() const
 {
-    return osc_type_;
+    return params_.osc_type;
 }
 
 AmpMode SynthHardware::GetAmpMode() const
 {
-    return amp_mode_;
+    return params_.amp_mode;
 }
 
 LfoType SynthHardware::GetLfoType() const
 {
-    return lfo_type_;
+    return params_.lfo_type;
 }
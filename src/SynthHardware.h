@@ -1,5 +1,18 @@
 #pragma once
 #include "DaisyDuino.h"
+#include "ControlTrace.h"
+#include "SynthParams.h"
+
+// analogRead() full scale, the core's default 10-bit resolution
+#ifndef ANALOG_READ_MAX
+#define ANALOG_READ_MAX 1023
+#endif
+
+// codec rate in kHz: 32, 48 or 96 (osc_bank_b_32k / osc_bank_b_96k, or
+// -D AUDIO_RATE_KHZ in any env's build_flags)
+#ifndef AUDIO_RATE_KHZ
+#define AUDIO_RATE_KHZ 48
+#endif
 
 // VCO
 #define OSC_PARAM_POT A0
@@ -40,34 +53,61 @@ enum PotId
   POT_SUSTAIN,
   POT_RELEASE,
   POT_LFO_RATE,
+  POT_COUNT,
 };
 
-enum AmpMode
+enum SwitchId
 {
-  AMP_MODE_ADSR,
-  AMP_MODE_RELEASE,
-  AMP_MODE_DRONE,
+  SW_OSC_TRI,
+  SW_OSC_SQ,
+  SW_AMP_ADSR,
+  SW_AMP_DRONE,
+  SW_LFO_SIG_RAND,
+  SW_LFO_SHAPE_1,
+  SW_LFO_SHAPE_3,
+  SW_COUNT,
 };
 
-enum OscType
+static inline float Deadband01(float x, float db);
+static inline float DeadbandBipolar(float x, float db);
+
+/**
+ * One pot, slewed and mapped the way DaisyDuino's AnalogControl +
+ * Parameter do it, but handed its reading rather than reading the pin:
+ * SynthHardware reads every pin once per pass, so the control trace
+ * records the exact value the engine was given.
+ */
+class PanelPot
 {
-  OSC_TYPE_TRI,
-  OSC_TYPE_SAW,
-  OSC_TYPE_SQ,
+public:
+  enum Curve
+  {
+    LINEAR,
+    LOGARITHMIC,
+  };
+  // `raw` is the reading the pot starts from
+  void Init(uint16_t raw, float control_rate, float min, float max, Curve curve,
+            float slew_seconds = 0.002f);
+  float Process(uint16_t raw);
+
+private:
+  float coeff_, val_;
+  float pmin_, pmax_, lmin_, lmax_;
+  Curve curve_;
 };
 
-enum LfoType
+// DaisyDuino's Switch debouncer, on a level read by SynthHardware
+class PanelSwitch
 {
-  LFO_TYPE_SIN,
-  LFO_TYPE_TRI,
-  LFO_TYPE_FM,
-  LFO_TYPE_STEPPED,
-  LFO_TYPE_SMOOTH,
-  LFO_TYPE_NOISE,
-};
+public:
+  void Init(bool invert) { invert_ = invert; state_ = 0; }
+  void Debounce(uint8_t level) { state_ = (state_ << 1) | ((level != 0) != invert_ ? 1 : 0); }
+  bool Pressed() const { return state_ == 0xff; }
 
-static inline float Deadband01(float x, float db);
-static inline float DeadbandBipolar(float x, float db);
+private:
+  uint8_t state_ = 0;
+  bool invert_ = false;
+};
 
 class SynthHardware
 {
@@ -75,6 +115,9 @@ public:
   void Init(float ControlRate);
   void UpdateControls(); // call at control rate
 
+  // everything the engine needs, as of the last UpdateControls()
+  const SynthParams &Params() const { return params_; }
+
   float GetPot(PotId id) const;
   AmpMode GetAmpMode() const;
   OscType GetOscType() const;
@@ -82,52 +125,31 @@ public:
 
   DaisyHardware &Raw() { return hw_; }
 
+  // raw inputs are captured here on every pass, nullptr = off
+  void SetTrace(ControlTrace *trace) { trace_ = trace; }
+
+  // pins behind PotId / SwitchId, -1 when out of range
+  static int PotPin(uint8_t id);
+  static int SwitchPin(uint8_t id);
+
 private:
   DaisyHardware hw_;
+  ControlTrace *trace_ = nullptr;
   float sample_rate_;
   float control_rate_;
 
-  /********             VCO             ********/
-  // AnalogControl + Parameter for each pot
-  AnalogControl osc_param_ctl_, env_osc_amt_ctl_, lfo_osc_amt_ctl_;
-  Parameter osc_param_param_, env_osc_amt_param_, lfo_osc_amt_param_;
-  // switches
-  Switch osc_tri_sw_, osc_sq_sw_;
-  // Helper
-  void UpdateVCO();
+  // this pass's readings, PotId / SwitchId order
+  uint16_t pot_raw_[POT_COUNT];
+  uint8_t switch_raw_[SW_COUNT];
+  PanelPot pots_[POT_COUNT];
+  PanelSwitch switches_[SW_COUNT];
 
-  /********             VCF             ********/
-  // AnalogControl + Parameter for each pot
-  AnalogControl cutoff_ctl_, reso_ctl_, env_cutoff_amt_ctl_, lfo_cutoff_amt_ctl_;
-  Parameter cutoff_param_, reso_param_, env_cutoff_amt_param_, lfo_cutoff_amt_param_;
-  // Helper
+  // Helpers
+  void UpdateVCO();
   void UpdateVCF();
-
-  /********             ADSR             ********/
-  // AnalogControl + Parameter for each pot
-  AnalogControl a_ctl_, d_ctl_, s_ctl_, r_ctl_;
-  Parameter a_param_, d_param_, s_param_, r_param_;
-  /********             AMP             ********/
-  // switches
-  Switch adsr_sw_, drone_sw_;
-  // Helper
   void UpdateAMP();
-
-  /********             LFO             ********/
-  // AnalogControl + Parameter for each pot
-  AnalogControl lfo_rate_ctl_;
-  Parameter lfo_rate_param_;
-  // switches
-  Switch lfo_sig_rand_sw_, lfo_shape_1_sw_, lfo_shape_3_sw_;
-  // Helper
   void UpdateLFO();
 
   // store last processed values
-  float osc_param_, osc_env_amt_, osc_lfo_amt_;
-  float cutoff_, reso_, cutoff_env_amt_, cutoff_lfo_amt_;
-  float att_, dec_, sus_, rel_;
-  float lfo_rate_;
-  OscType osc_type_;
-  AmpMode amp_mode_;
-  LfoType lfo_type_;
+  SynthParams params_;
 };
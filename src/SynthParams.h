@@ -0,0 +1,119 @@
+#pragma once
+
+enum AmpMode
+{
+  AMP_MODE_ADSR,
+  AMP_MODE_RELEASE,
+  AMP_MODE_DRONE,
+};
+
+enum OscType
+{
+  OSC_TYPE_TRI,
+  OSC_TYPE_SAW,
+  OSC_TYPE_SQ,
+};
+
+enum LfoType
+{
+  LFO_TYPE_SIN,
+  LFO_TYPE_TRI,
+  LFO_TYPE_FM,
+  LFO_TYPE_STEPPED,
+  LFO_TYPE_SMOOTH,
+  LFO_TYPE_NOISE,
+};
+
+// what the external audio input feeds (set over MIDI, not from the panel)
+enum InputRoute
+{
+  INPUT_ROUTE_OFF,
+  INPUT_ROUTE_FILTER, // replaces the oscillator, through ladder + VCA
+  INPUT_ROUTE_FM,     // linear FM of the oscillator at audio rate
+};
+
+// what the input's envelope follower does to the envelopes
+enum FollowMode
+{
+  FOLLOW_OFF,
+  FOLLOW_GATE,    // holds the gate while the input is above threshold
+  FOLLOW_TRIGGER, // each onset retriggers, gate held through the attack
+};
+
+// who plays the voice (set over MIDI, not from the panel)
+enum SeqMode
+{
+  SEQ_MODE_OFF,  // MIDI notes, as played
+  SEQ_MODE_ARP,  // the held notes, one per step
+  SEQ_MODE_STEP, // the step pattern, transposed by the last note played
+};
+
+enum ArpOrder
+{
+  ARP_ORDER_UP,
+  ARP_ORDER_DOWN,
+  ARP_ORDER_UP_DOWN, // ends are not repeated
+  ARP_ORDER_RANDOM,
+};
+
+/**
+ * Everything the engine reads at control rate, as plain values.
+ * SynthHardware fills one from the front panel (after the Parameter
+ * mapping and deadbands); hosts and tests can build their own.
+ */
+struct SynthParams
+{
+  /* VCO */
+  float osc_param = 0.f;   // -1..1
+  float env_osc_amt = 0.f; // -1..1
+  float lfo_osc_amt = 0.f; // 0..1
+  OscType osc_type = OSC_TYPE_SAW;
+
+  /* VCF */
+  float cutoff = 1000.f;      // Hz, 20..18000
+  float reso = 0.f;           // 0..0.93
+  float env_cutoff_amt = 0.f; // -1..1
+  float lfo_cutoff_amt = 0.f; // 0..1
+
+  /* ADSR, knob positions 0..1 */
+  float attack = 0.f;
+  float decay = 0.f;
+  float sustain = 1.f;
+  float release = 0.f;
+  AmpMode amp_mode = AMP_MODE_ADSR;
+
+  /* LFO */
+  float lfo_rate = 0.f; // knob position 0..1
+  LfoType lfo_type = LFO_TYPE_SIN;
+};
+
+// values of a ResolvedParams, one per PotId and in the same order
+enum ResolvedId
+{
+  RESOLVED_OSC_PARAM,
+  RESOLVED_ENV_OSC_AMT,
+  RESOLVED_LFO_OSC_AMT,
+  RESOLVED_CUTOFF, // Hz
+  RESOLVED_RESO,
+  RESOLVED_ENV_CUTOFF_AMT,
+  RESOLVED_LFO_CUTOFF_AMT,
+  RESOLVED_ATTACK, // seconds
+  RESOLVED_DECAY,  // seconds
+  RESOLVED_SUSTAIN,
+  RESOLVED_RELEASE,  // seconds
+  RESOLVED_LFO_RATE, // Hz, FM ratio or noise tilt, per lfo_type
+  RESOLVED_COUNT,
+};
+
+/**
+ * A SynthParams with the knob curves applied (Voice::Resolve): what the
+ * voice actually runs on, so setting one costs no powf. ParamMorph
+ * crossfades two of them.
+ */
+struct ResolvedParams
+{
+  float value[RESOLVED_COUNT];
+  OscType osc_type;
+  AmpMode amp_mode;
+  LfoType lfo_type;
+};
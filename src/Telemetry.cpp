@@ -0,0 +1,102 @@
+#include "Telemetry.h"
+#include <string.h>
+#if !defined(__arm__)
+#include <time.h>
+#endif
+
+uint32_t TelemetryCycles()
+{
+#if defined(__arm__)
+  return DWT->CYCCNT;
+#else
+  // host: nanoseconds stand in for cycles
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec);
+#endif
+}
+
+uint32_t TelemetryCyclesPerSecond()
+{
+#if defined(__arm__)
+  return SystemCoreClock;
+#else
+  return 1000000000u;
+#endif
+}
+
+void Telemetry::Init(uint16_t decimation)
+{
+  head_.store(0);
+  tail_.store(0);
+  dropped_.store(0);
+  block_ = 0;
+  decimation_ = decimation ? decimation : 1;
+  countdown_ = 0;
+#if defined(__arm__)
+  // the M7 cycle counter has to be unlocked and started once
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->LAR = 0xC5ACCE55;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+bool Telemetry::Tick()
+{
+  block_++;
+  if (countdown_ > 0)
+  {
+    countdown_--;
+    return false;
+  }
+  countdown_ = decimation_ - 1;
+  return true;
+}
+
+bool Telemetry::Push(TelemetryRecord &rec)
+{
+  const uint32_t head = head_.load(std::memory_order_relaxed);
+  const uint32_t tail = tail_.load(std::memory_order_acquire);
+  rec.seq = block_;
+  rec.ring_depth = (uint16_t)(head - tail);
+  rec.dropped = (uint16_t)dropped_.load(std::memory_order_relaxed);
+  if (head - tail >= TELEMETRY_CAPACITY)
+  {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  ring_[head & (TELEMETRY_CAPACITY - 1)] = rec;
+  head_.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+size_t Telemetry::Depth() const
+{
+  return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_relaxed);
+}
+
+size_t Telemetry::Drain(uint8_t *buf, size_t capacity)
+{
+  const size_t frame = sizeof(TelemetryRecord) + TELEMETRY_FRAME_OVERHEAD;
+  const uint32_t head = head_.load(std::memory_order_acquire);
+  uint32_t tail = tail_.load(std::memory_order_relaxed);
+  size_t len = 0;
+  while (tail != head && len + frame <= capacity)
+  {
+    uint8_t *p = buf + len;
+    p[0] = TELEMETRY_SYNC_0;
+    p[1] = TELEMETRY_SYNC_1;
+    p[2] = TELEMETRY_VERSION;
+    p[3] = (uint8_t)sizeof(TelemetryRecord);
+    memcpy(p + 4, &ring_[tail & (TELEMETRY_CAPACITY - 1)], sizeof(TelemetryRecord));
+    uint8_t sum = 0;
+    for (size_t i = 2; i < 4 + sizeof(TelemetryRecord); i++)
+      sum += p[i];
+    p[4 + sizeof(TelemetryRecord)] = sum;
+    len += frame;
+    tail++;
+  }
+  tail_.store(tail, std::memory_order_release);
+  return len;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "DaisyDuino.h"
+#include <atomic>
+
+// records in flight, power of two
+#define TELEMETRY_CAPACITY 256
+// frame: sync0 sync1 version length payload checksum
+#define TELEMETRY_SYNC_0 0xA5
+#define TELEMETRY_SYNC_1 0x5A
+#define TELEMETRY_VERSION 4
+#define TELEMETRY_FRAME_OVERHEAD 5
+
+#define TELEMETRY_FLAG_GATE 0x01
+// the FX bus fitted its arena (otherwise it stays bypassed)
+#define TELEMETRY_FLAG_FX 0x02
+
+// one per sampled audio block, little-endian on the wire
+struct __attribute__((packed)) TelemetryRecord
+{
+  uint32_t seq;        // audio block index, gaps = decimation or drops
+  uint32_t cycles;     // callback cost (CPU cycles on the board)
+  float env;           // amp envelope at the end of the block
+  uint8_t flags;       // TELEMETRY_FLAG_*
+  uint8_t note;        // note the voice is playing
+  uint8_t held;        // held notes
+  uint8_t osc_type;    // OscType
+  uint8_t lfo_type;    // LfoType
+  uint8_t amp_mode;    // AmpMode
+  uint8_t tier;        // quality tier picked by the Governor
+  uint16_t ring_depth; // telemetry records waiting when this one was pushed
+  uint16_t dropped;    // records lost to a full ring so far (wraps)
+  uint16_t midi_overflows; // loop() passes that found the MIDI UART full (wraps)
+  uint16_t fx_used_kb;     // FX arena carved into delay lines, KiB
+  uint16_t fx_budget_kb;   // FX arena size, KiB
+};
+
+// free-running cycle counter (DWT on the M7), started by Telemetry::Init
+uint32_t TelemetryCycles();
+// TelemetryCycles() ticks per second
+uint32_t TelemetryCyclesPerSecond();
+
+/**
+ * Binary telemetry channel from the audio callback to the USB CDC link.
+ * Single producer (audio callback) / single consumer (loop()) ring: the
+ * audio side never waits, it drops and counts when the ring is full;
+ * loop() drains whole frames in batches, only as much as the link takes.
+ */
+class Telemetry
+{
+public:
+  // keep one block in `decimation`
+  void Init(uint16_t decimation = 1);
+
+  /* audio side */
+  // call once per block, true when this block should be recorded
+  bool Tick();
+  bool Push(TelemetryRecord &rec);
+
+  /* loop() side */
+  // encodes as many whole frames as fit in `capacity` bytes
+  size_t Drain(uint8_t *buf, size_t capacity);
+  size_t Depth() const;
+  uint32_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  TelemetryRecord ring_[TELEMETRY_CAPACITY];
+  std::atomic<uint32_t> head_; // written by the audio side
+  std::atomic<uint32_t> tail_; // written by loop()
+  std::atomic<uint32_t> dropped_;
+  uint32_t block_ = 0;
+  uint16_t decimation_ = 1, countdown_ = 0;
+};
@@ -2,11 +2,14 @@
 
 void Voice::Init(float sample_rate)
 {
+  sample_rate_ = sample_rate;
+
   /* VCO */
   osc_.Init(sample_rate);
 
   /* VCF */
   flt_.Init(sample_rate);
+  params_.max_cutoff = VS_RateLimits::For(sample_rate).max_cutoff;
 
   /* ADSR */
   env_amp_.Init(sample_rate);
@@ -24,83 +27,168 @@ void Voice::Init(float sample_rate)
 
   /* LFO */
   lfo_.Init(sample_rate);
+
+  /* EXTERNAL INPUT */
+  follower_.Init(sample_rate);
 }
 
-void Voice::ProcessBlock(float **out, size_t size)
+const float Voice::SILENCE[Voice::MAX_BLOCK] = {};
+
+void Voice::ProcessBlock(float *out, size_t size, const float *in)
 {
-  for (size_t i = 0; i < size; i++)
+  for (size_t start = 0; start < size; start += MAX_BLOCK)
   {
-    float env = env_amp_.Process(gate_);
-    float lfo = lfo_.Process(current_freq_);
-
-    float cutoff = ComputeCutoff(env, lfo);
-    flt_.SetFreq(cutoff);
-
-    float sig = osc_.Process(current_freq_, env, lfo);
-    float filt = flt_.Process(sig * flt_drive_);
+    size_t n = size - start;
+    if (n > MAX_BLOCK)
+      n = MAX_BLOCK;
+    const float *src = in ? in + start : SILENCE;
+    if (in && follow_mode_ != FOLLOW_OFF)
+      UpdateFollower(src, n);
 
-    float amp = ComputeAmp(env);
+    // the LFO does not depend on the envelope, render it for the whole chunk
+    lfo_.ProcessBlock(lfo_buf_, n, current_freq_);
 
-    float s = SoftClipTanh3(filt * amp);
-    out[0][i] = out[1][i] = s;
+    if (in && route_ == INPUT_ROUTE_FILTER)
+    {
+      RenderWith(InputStage(), src, out + start, n);
+    }
+    else
+    {
+      switch (osc_.GetType())
+      {
+      case OSC_TYPE_SQ:
+        RenderOsc<OSC_TYPE_SQ>(src, out + start, n);
+        break;
+      case OSC_TYPE_TRI:
+        RenderOsc<OSC_TYPE_TRI>(src, out + start, n);
+        break;
+      default:
+        RenderOsc<OSC_TYPE_SAW>(src, out + start, n);
+        break;
+      }
+    }
   }
 }
 
-float Voice::ComputeCutoff(float env, float lfo)
+template <OscType Osc>
+void Voice::RenderOsc(const float *in, float *out, size_t n)
+{
+  // bank 1 with samples loaded: SAW and TRI play the stream
+  if (OSC_BANK == 1 && Osc != OSC_TYPE_SQ && osc_.Sampled())
+    RenderOscAs<Osc, true>(in, out, n);
+  else
+    RenderOscAs<Osc, false>(in, out, n);
+}
+
+template <OscType Osc, bool Sampled>
+void Voice::RenderOscAs(const float *in, float *out, size_t n)
 {
-  const float maxModOct = 5.0f;
-  float env_oct = env_cutoff_depth_ * maxModOct;
-  float lfo_oct = lfo_cutoff_depth_ * maxModOct;
-  float total_oct = (env * env_oct) + (lfo * lfo_oct);
-  float cutoff = base_cutoff_ * exp2f(total_oct);
-  if (cutoff < 20.f)
-    cutoff = 20.f;
-  if (cutoff > 18000.f)
-    cutoff = 18000.f;
-  return cutoff;
+  if (route_ == INPUT_ROUTE_FM && in != SILENCE)
+    RenderWith(FmOscStage<Osc, OSC_BANK, Sampled>(osc_), in, out, n);
+  else
+    RenderWith(OscStage<Osc, OSC_BANK, Sampled>(osc_), in, out, n);
 }
 
-float Voice::ComputeAmp(float env)
+template <typename Source>
+void Voice::RenderWith(Source source, const float *in, float *out, size_t n)
 {
   switch (amp_mode_)
   {
   case AMP_MODE_ADSR:
-    return env;
+    Render(MakeChain(source, LadderStage(flt_), VcaStage<AMP_MODE_ADSR>(env_rel_)), in, out, n);
+    break;
   case AMP_MODE_DRONE:
-    return 1.f;
+    Render(MakeChain(source, LadderStage(flt_), VcaStage<AMP_MODE_DRONE>(env_rel_)), in, out, n);
+    break;
   case AMP_MODE_RELEASE:
-    return env_rel_.Process(gate_);
+    Render(MakeChain(source, LadderStage(flt_), VcaStage<AMP_MODE_RELEASE>(env_rel_)), in, out, n);
+    break;
   default:
     // should never happen, but worst case, keeps amp to 0
-    return 0;
+    memset(out, 0, n * sizeof(float));
+    break;
+  }
+}
+
+template <typename VoiceChain>
+void Voice::Render(VoiceChain chain, const float *in, float *out, size_t n)
+{
+  chain.Prepare(params_);
+
+  const bool gate = gate_ || follow_gate_;
+  VoiceFrame f;
+  f.freq = current_freq_;
+  f.gate = gate;
+  f.env = env_level_;
+  uint32_t glide = glide_left_;
+  for (size_t i = 0; i < n; i++)
+  {
+    if (glide)
+    {
+      f.freq *= glide_mul_;
+      if (--glide == 0)
+        f.freq = glide_target_;
+    }
+    f.env = env_amp_.Process(gate);
+    f.lfo = lfo_buf_[i];
+    out[i] = chain.Process(in[i], f);
+  }
+  glide_left_ = glide;
+  current_freq_ = f.freq;
+  env_level_ = f.env;
+}
+
+/**
+ * envelope follower, once per chunk
+ */
+void Voice::UpdateFollower(const float *in, size_t n)
+{
+  follower_.Process(in, n);
+  if (follow_mode_ == FOLLOW_GATE)
+  {
+    follow_gate_ = follower_.Gate();
+    return;
+  }
+  // trigger: retrigger on the onset, hold the gate until the attack is done
+  if (follower_.Rising())
+  {
+    env_amp_.Retrigger(false);
+    env_rel_.Retrigger(false);
+    follow_gate_ = true;
+  }
+  else if (follow_gate_ && env_amp_.GetCurrentSegment() != ADSR_SEG_ATTACK)
+  {
+    follow_gate_ = false;
   }
 }
 
-static inline float SoftClipTanh3(float x)
+void Voice::SetFollowMode(FollowMode mode)
 {
-  // clamp to keep the approximation bounded + stable
-  if (x > 3.f)
-    x = 3.f;
-  if (x < -3.f)
-    x = -3.f;
-
-  // tanh-ish approx: x * (27 + x^2) / (27 + 9x^2)
-  float x2 = x * x;
-  return x * (27.f + x2) / (27.f + 9.f * x2);
+  follow_mode_ = mode;
+  follow_gate_ = false;
 }
 
-void Voice::NoteOn(byte inChannel, byte inNote, byte inVelocity)
+void Voice::NoteOn(byte inChannel, byte inNote, byte inVelocity, bool glide)
 {
   // Note Off can come in as Note On w/ 0 Velocity
   if (inVelocity == 0.f)
   {
     gate_ = false;
+    return;
   }
-  else
+  float freq = mtof(inNote);
+  if (glide && gate_ && glide_samples_ >= 1.f && current_freq_ > 0.f)
   {
-    current_freq_ = mtof(inNote);
-    gate_ = true;
+    // the oscillator keeps running, only the pitch moves
+    glide_target_ = freq;
+    glide_mul_ = powf(freq / current_freq_, 1.f / glide_samples_);
+    glide_left_ = (uint32_t)glide_samples_;
+    return;
   }
+  glide_left_ = 0;
+  current_freq_ = freq;
+  gate_ = true;
+  osc_.Trigger(current_freq_);
 }
 
 void Voice::NoteOff(byte inChannel, byte inNote, byte inVelocity)
@@ -108,35 +196,68 @@ void Voice::NoteOff(byte inChannel, byte inNote, byte inVelocity)
   gate_ = false;
 }
 
-void Voice::UpdateParamsFromHardware(const SynthHardware &hw)
+void Voice::SetParams(const SynthParams &p)
 {
-  /* VCO */
-  osc_.UpdateParamsFromHardware(hw);
+  ResolvedParams r;
+  Resolve(p, r);
+  SetResolved(r);
+}
+
+void Voice::Resolve(const SynthParams &p, ResolvedParams &r) const
+{
+  r.value[RESOLVED_OSC_PARAM] = p.osc_param;
+  r.value[RESOLVED_ENV_OSC_AMT] = p.env_osc_amt;
+  r.value[RESOLVED_LFO_OSC_AMT] = p.lfo_osc_amt;
+  r.value[RESOLVED_CUTOFF] = p.cutoff;
+  r.value[RESOLVED_RESO] = p.reso;
+  r.value[RESOLVED_ENV_CUTOFF_AMT] = p.env_cutoff_amt;
+  r.value[RESOLVED_LFO_CUTOFF_AMT] = p.lfo_cutoff_amt;
+  r.value[RESOLVED_ATTACK] = MapKnobToTime(p.attack, A_MIN, A_MAX, A_CURVE);
+  r.value[RESOLVED_DECAY] = MapKnobToTime(p.decay, D_MIN, D_MAX, D_CURVE);
+  r.value[RESOLVED_SUSTAIN] = p.sustain;
+  r.value[RESOLVED_RELEASE] = MapKnobToTime(p.release, R_MIN, R_MAX, R_CURVE);
+  r.value[RESOLVED_LFO_RATE] = lfo_.RateFor(p.lfo_type, p.lfo_rate);
+  r.osc_type = p.osc_type;
+  r.amp_mode = p.amp_mode;
+  r.lfo_type = p.lfo_type;
+}
+
+void Voice::SetResolved(const ResolvedParams &r)
+{
+  resolved_ = r;
+  /* VCO, set up by the chain's oscillator stage */
+  params_.osc_param = r.value[RESOLVED_OSC_PARAM];
+  params_.env_osc_depth = r.value[RESOLVED_ENV_OSC_AMT];
+  params_.lfo_osc_depth = r.value[RESOLVED_LFO_OSC_AMT];
+  osc_.SetType(r.osc_type);
   /* VCF */
-  base_cutoff_ = hw.GetPot(POT_CUTOFF);
-  float reso = hw.GetPot(POT_RESO);
+  params_.base_cutoff = r.value[RESOLVED_CUTOFF];
+  float reso = r.value[RESOLVED_RESO];
   flt_.SetRes(reso);
-  flt_drive_ = 1 + reso * reso * 4;
-  if (flt_drive_ > 3.f)
-    flt_drive_ = 3.f;
-  env_cutoff_depth_ = hw.GetPot(POT_ENV_CUTOFF_AMT);
-  lfo_cutoff_depth_ = hw.GetPot(POT_LFO_CUTOFF_AMT);
+  params_.flt_drive = 1 + reso * reso * 4;
+  if (params_.flt_drive > 3.f)
+    params_.flt_drive = 3.f;
+  params_.env_cutoff_depth = r.value[RESOLVED_ENV_CUTOFF_AMT];
+  params_.lfo_cutoff_depth = r.value[RESOLVED_LFO_CUTOFF_AMT];
   /* ADSR */
-  env_amp_.SetSustainLevel(hw.GetPot(POT_SUSTAIN));
-  float attack_s = MapKnobToTime(hw.GetPot(POT_ATTACK), A_MIN, A_MAX, A_CURVE);
-  float decay_s = MapKnobToTime(hw.GetPot(POT_DECAY), D_MIN, D_MAX, D_CURVE);
-  float release_s = MapKnobToTime(hw.GetPot(POT_RELEASE), R_MIN, R_MAX, R_CURVE);
-  env_amp_.SetTime(ADSR_SEG_ATTACK, attack_s);
-  env_amp_.SetTime(ADSR_SEG_DECAY, decay_s);
+  env_amp_.SetSustainLevel(r.value[RESOLVED_SUSTAIN]);
+  float release_s = r.value[RESOLVED_RELEASE];
+  env_amp_.SetTime(ADSR_SEG_ATTACK, r.value[RESOLVED_ATTACK]);
+  env_amp_.SetTime(ADSR_SEG_DECAY, r.value[RESOLVED_DECAY]);
   env_amp_.SetTime(ADSR_SEG_RELEASE, release_s);
   env_rel_.SetTime(ADSR_SEG_RELEASE, release_s);
   /* VCA */
-  amp_mode_ = hw.GetAmpMode();
+  amp_mode_ = r.amp_mode;
   /* LFO */
-  lfo_.UpdateParamsFromHardware(hw);
+  lfo_.SetRate(r.lfo_type, r.value[RESOLVED_LFO_RATE]);
+}
+
+void Voice::SetSeed(uint32_t seed)
+{
+  lfo_.SetSeed(seed);
 }
 
-float Voice::MapKnobToTime(float knob, float t_min, float t_max, float curve)
+float Voice::MapKnobToTime(float knob, float t_min, float t_max, float curve) const
 {
   float shaped = powf(knob, curve);
   return t_min * powf(t_max / t_min, shaped);
@@ -1,50 +1,110 @@
 #pragma once
 #include "DaisyDuino.h"
-#include "SynthHardware.h"
+#include "SynthParams.h"
 #include "vs_osc.h"
 #include "vs_lfo.h"
-
-static inline float SoftClipTanh3(float x);
+#include "vs_chain.h"
+#include "vs_follower.h"
 
 class Voice
 {
 public:
   void Init(float sample_rate);
 
-  void NoteOn(byte inChannel, byte inNote, byte inVelocity);
+  // glide: slide from the sounding note over the glide time, legato
+  void NoteOn(byte inChannel, byte inNote, byte inVelocity, bool glide = false);
   void NoteOff(byte inChannel, byte inNote, byte inVelocity);
 
-  void ProcessBlock(float **out, size_t size);
+  // mono, unclipped (VS_Master follows); `in` is the external input
+  // (`size` samples), read in place; nullptr = none, every route then
+  // falls back to the oscillator
+  void ProcessBlock(float *out, size_t size, const float *in = nullptr);
+
+  // called at control-rate from outside; Resolve() then SetResolved()
+  void SetParams(const SynthParams &p);
+  // the knob curves alone (the powf work), touches no voice state
+  void Resolve(const SynthParams &p, ResolvedParams &r) const;
+  void SetResolved(const ResolvedParams &r);
+  const ResolvedParams &Resolved() const { return resolved_; }
+
+  // reseeds every random source, for reproducible renders
+  void SetSeed(uint32_t seed);
+
+  // bank 1: plays samples from `stream` (nullptr = synthetic placeholders)
+  void SetSampleStream(VS_SampleStream *stream) { osc_.SetStream(stream); }
+
+  /* external input */
+  void SetInputRoute(InputRoute route) { route_ = route; }
+  void SetFmDepth(float depth) { params_.fm_depth = depth; }
+  void SetFollowMode(FollowMode mode);
+  void SetFollowThreshold(float open) { follower_.SetThreshold(open); }
+
+  // portamento time for gliding notes, constant whatever the interval
+  void SetGlide(float seconds) { glide_samples_ = seconds * sample_rate_; }
 
-  // called at control-rate from outside
-  void UpdateParamsFromHardware(const SynthHardware &hw);
+  // filter modulation every `samples` samples instead of every sample
+  void SetModInterval(size_t samples) { params_.mod_interval = samples ? samples : 1; }
+
+  // state snapshot, for telemetry
+  float GetEnvLevel() const { return env_level_; }
+  OscType GetOscType() const { return osc_.GetType(); }
+  LfoType GetLfoType() const { return lfo_.GetType(); }
+  AmpMode GetAmpMode() const { return amp_mode_; }
 
 private:
+  // audio blocks are processed in chunks of at most this many samples
+  static const size_t MAX_BLOCK = 64;
+
   /* VCO */
   VS_Osc osc_;
   float current_freq_ = 0.0f;
   float current_vel_ = 1.0f;
+  float sample_rate_ = 48000.f;
+  // exponential slide towards glide_target_, per sample
+  float glide_samples_ = 0.f;
+  float glide_target_ = 0.f, glide_mul_ = 1.f;
+  uint32_t glide_left_ = 0;
 
   /* VCF */
   MoogLadder flt_;
-  float base_cutoff_ = 1000.0f;
-  float flt_drive_;
-  float env_cutoff_depth_ = 0.0f;
-  float lfo_cutoff_depth_ = 0.0f;
-  float ComputeCutoff(float env, float lfo);
+
+  // control-rate parameters read by the chain stages
+  VoiceParams params_;
+  // as last set
+  ResolvedParams resolved_ = {};
 
   /* LFO */
   VS_Lfo lfo_;
+  float lfo_buf_[MAX_BLOCK];
 
   /* ADSR */
   Adsr env_amp_;
   Adsr env_rel_;
   bool gate_ = false;
+  float env_level_ = 0.f;
   AmpMode amp_mode_ = AMP_MODE_ADSR;
-  float ComputeAmp(float env);
+
+  /* EXTERNAL INPUT */
+  InputRoute route_ = INPUT_ROUTE_OFF;
+  FollowMode follow_mode_ = FOLLOW_OFF;
+  VS_Follower follower_;
+  bool follow_gate_ = false;
+  // the first stage's input when there is no external one
+  static const float SILENCE[MAX_BLOCK];
+  void UpdateFollower(const float *in, size_t n);
   // ADSR SHAPING PARAMS + HELPERS
   const float A_MIN = 0.002f, A_MAX = 2.f, A_CURVE = .7f;
   const float D_MIN = 0.003f, D_MAX = 1.5f, D_CURVE = .5f;
   const float R_MIN = 0.01f, R_MAX = 3.0f, R_CURVE = .5f;
-  float MapKnobToTime(float knob, float t_min, float t_max, float curve);
+  float MapKnobToTime(float knob, float t_min, float t_max, float curve) const;
+
+  // switch positions and the input route pick one fused chain per chunk
+  template <OscType Osc>
+  void RenderOsc(const float *in, float *out, size_t n);
+  template <OscType Osc, bool Sampled>
+  void RenderOscAs(const float *in, float *out, size_t n);
+  template <typename Source>
+  void RenderWith(Source source, const float *in, float *out, size_t n);
+  template <typename VoiceChain>
+  void Render(VoiceChain chain, const float *in, float *out, size_t n);
 };
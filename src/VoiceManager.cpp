@@ -1,107 +1,418 @@
 #include "VoiceManager.h"
 
+/**
+ * quality tiers, cheapest last: filter modulation at a sub-rate first,
+ * then the master clip at the codec rate, then the reverb, then the
+ * chorus; the delay and the voice always stay
+ */
+struct QualityTierSettings
+{
+  size_t mod_interval; // samples between filter cutoff updates
+  bool master_2x;      // oversampled master clip
+  uint8_t fx_bypass;   // FX_* shed at this tier
+};
+
+static const QualityTierSettings QUALITY_TIER_TABLE[QUALITY_TIERS] = {
+    {1, true, 0},
+    {4, true, 0},
+    {16, false, 0},
+    {16, false, FX_REVERB},
+    {32, false, FX_REVERB | FX_CHORUS},
+};
+
 /*
  * ABSTRACTION / ENCAPSULATION MANAGEMENT
  */
-void VoiceManager::Init(float sample_rate)
+void VoiceManager::Init(float sample_rate, size_t oversample)
+{
+  oversample_ = oversample >= 2 ? 2 : 1;
+  voice_rate_ = sample_rate * oversample_;
+  mod_scale_ = (size_t)(voice_rate_ / 48000.f + 0.5f);
+  if (mod_scale_ < 1)
+    mod_scale_ = 1;
+  voice_.Init(voice_rate_);
+  voice_.SetModInterval(QUALITY_TIER_TABLE[tier_].mod_interval * mod_scale_);
+  decim_.Init();
+  notes_.Init();
+  // the timeline counts codec samples
+  seq_.Init(sample_rate);
+  master_.Init(sample_rate);
+  master_.SetOversampled(QUALITY_TIER_TABLE[tier_].master_2x);
+  morph_.Init(sample_rate);
+  morph_captured_[0] = morph_captured_[1] = false;
+}
+
+void VoiceManager::ProcessBlock(float **out, size_t size, const float *const *in)
+{
+  const float *src = in ? in[0] : nullptr;
+  // what loop() played since the last block, before the sequencer looks
+  // at the held notes
+  ApplyNoteEvents();
+  ApplyPanel(size);
+  // sequencer events split the block at their exact samples
+  size_t count = seq_.Process(size, seq_events_, SEQ_MAX_EVENTS);
+  size_t done = 0;
+  for (size_t i = 0; i < count; i++)
+  {
+    const SeqEvent &e = seq_events_[i];
+    if (e.offset > done)
+    {
+      RenderVoice(out[0], done, e.offset - done, src);
+      done = e.offset;
+    }
+    ApplySeqEvent(e);
+  }
+  if (done < size)
+    RenderVoice(out[0], done, size - done, src);
+
+  // the voice is mono: with no effect running, the master stage writes
+  // both channels straight from it
+  fx_.BeginBlock();
+  if (fx_.Active())
+  {
+    memcpy(out[1], out[0], size * sizeof(float));
+    fx_.ProcessBlock(out, size);
+    master_.ProcessStereo(out[0], out[1], size);
+  }
+  else
+  {
+    master_.ProcessMono(out[0], out[0], out[1], size);
+  }
+}
+
+void VoiceManager::RenderVoice(float *out, size_t start, size_t n, const float *src)
+{
+  out += start;
+  if (src)
+    src += start;
+  if (oversample_ == 1)
+  {
+    voice_.ProcessBlock(out, n, src);
+    return;
+  }
+  for (size_t pos = 0; pos < n; pos += HALFBAND_CHUNK)
+  {
+    size_t len = n - pos;
+    if (len > HALFBAND_CHUNK)
+      len = HALFBAND_CHUNK;
+    if (src)
+    {
+      for (size_t i = 0; i < len; i++)
+        os_in_[2 * i] = os_in_[2 * i + 1] = src[pos + i];
+    }
+    voice_.ProcessBlock(os_buf_, 2 * len, src ? os_in_ : nullptr);
+    decim_.Process(os_buf_, out + pos, len);
+  }
+}
+
+void VoiceManager::SetParams(const SynthParams &p)
+{
+  panel_ = p;
+  voice_.Resolve(p, panel_buf_[panel_back_]);
+  panel_back_ = panel_middle_.exchange(panel_back_ | PANEL_FRESH, std::memory_order_acq_rel) & 3;
+}
+
+// the morph moves once per block, before any of it is rendered; the
+// panel's latest set takes over whenever the morph is off, and again on
+// the block the morph is switched off
+void VoiceManager::ApplyPanel(size_t size)
 {
-  voice_.Init(sample_rate);
+  bool fresh = false;
+  if (panel_middle_.load(std::memory_order_relaxed) & PANEL_FRESH)
+  {
+    panel_front_ = panel_middle_.exchange(panel_front_, std::memory_order_acq_rel) & 3;
+    panel_ready_ = fresh = true;
+  }
+  if (morph_.Process(size, morph_out_))
+  {
+    voice_.SetResolved(morph_out_);
+    morph_on_ = true;
+    return;
+  }
+  const bool on = morph_.Enabled();
+  if (!on && panel_ready_ && (fresh || morph_on_))
+    voice_.SetResolved(panel_buf_[panel_front_]);
+  morph_on_ = on;
+}
+
+void VoiceManager::CaptureMorph(uint8_t end)
+{
+  if (end > 1)
+    return;
+  morph_ends_[end] = panel_;
+  morph_captured_[end] = true;
+  if (!morph_captured_[0] || !morph_captured_[1])
+    return;
+  // each half runs under its own end's modes: both ends resolved twice
+  ResolvedParams ends[2][2];
+  for (size_t h = 0; h < 2; h++)
+    for (size_t e = 0; e < 2; e++)
+    {
+      SynthParams p = morph_ends_[e];
+      p.osc_type = morph_ends_[h].osc_type;
+      p.amp_mode = morph_ends_[h].amp_mode;
+      p.lfo_type = morph_ends_[h].lfo_type;
+      voice_.Resolve(p, ends[h][e]);
+    }
+  morph_.SetEnds(ends);
 }
 
-void VoiceManager::ProcessBlock(float **out, size_t size)
+void VoiceManager::SetQualityTier(uint8_t tier)
 {
-  voice_.ProcessBlock(out, size);
+  if (tier >= QUALITY_TIERS)
+    tier = QUALITY_TIERS - 1;
+  tier_ = tier;
+  voice_.SetModInterval(QUALITY_TIER_TABLE[tier].mod_interval * mod_scale_);
+  master_.SetOversampled(QUALITY_TIER_TABLE[tier].master_2x);
+  fx_.SetBypass(QUALITY_TIER_TABLE[tier].fx_bypass);
 }
 
-void VoiceManager::UpdateParamsFromHardware(const SynthHardware &hw)
+void VoiceManager::SetSeed(uint32_t seed)
 {
-  voice_.UpdateParamsFromHardware(hw);
+  voice_.SetSeed(seed);
+  seq_.SetSeed(seed);
+}
+
+void VoiceManager::FillTelemetry(TelemetryRecord &rec) const
+{
+  rec.env = voice_.GetEnvLevel();
+  rec.flags = (sounding_ ? TELEMETRY_FLAG_GATE : 0) | (fx_.Ready() ? TELEMETRY_FLAG_FX : 0);
+  rec.note = current_note_;
+  rec.held = notes_.Count();
+  rec.osc_type = (uint8_t)voice_.GetOscType();
+  rec.lfo_type = (uint8_t)voice_.GetLfoType();
+  rec.amp_mode = (uint8_t)voice_.GetAmpMode();
+  rec.tier = tier_;
+  rec.fx_used_kb = (uint16_t)(fx_.MemoryUsed() / 1024);
+  rec.fx_budget_kb = (uint16_t)(fx_.MemoryBudget() / 1024);
 }
 
 /**
  * ACTUAL VOICE MANAGEMENT
  * (handling of midi note priority and voice retrig)
  */
+void VoiceManager::SetNotePriority(NotePriorityMode mode)
+{
+  PostNote(NOTE_EVENT_PRIORITY, 0, (byte)mode, 0);
+}
+
 void VoiceManager::NoteOn(byte inChannel, byte inNote, byte inVelocity)
+{
+  PostNote(NOTE_EVENT_ON, inChannel, inNote, inVelocity);
+}
+
+void VoiceManager::NoteOff(byte inChannel, byte inNote, byte inVelocity)
+{
+  PostNote(NOTE_EVENT_OFF, inChannel, inNote, inVelocity);
+}
+
+void VoiceManager::SetSeqMode(SeqMode mode)
+{
+  PostNote(NOTE_EVENT_SEQ_MODE, 0, (byte)mode, 0);
+}
+
+void VoiceManager::PostNote(uint8_t type, byte channel, byte note, byte velocity)
+{
+  const uint32_t head = note_head_.load(std::memory_order_relaxed);
+  if (head - note_tail_.load(std::memory_order_acquire) >= NOTE_QUEUE_SIZE)
+  {
+    note_drops_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  NoteEvent &e = note_queue_[head & (NOTE_QUEUE_SIZE - 1)];
+  e.type = type;
+  e.channel = channel;
+  e.note = note;
+  e.velocity = velocity;
+  note_head_.store(head + 1, std::memory_order_release);
+}
+
+void VoiceManager::ApplyNoteEvents()
+{
+  uint32_t tail = note_tail_.load(std::memory_order_relaxed);
+  const uint32_t head = note_head_.load(std::memory_order_acquire);
+  for (; tail != head; tail++)
+  {
+    const NoteEvent &e = note_queue_[tail & (NOTE_QUEUE_SIZE - 1)];
+    switch (e.type)
+    {
+    case NOTE_EVENT_ON:
+      ApplyNoteOn(e.channel, e.note, e.velocity);
+      break;
+    case NOTE_EVENT_OFF:
+      ApplyNoteOff(e.channel, e.note, e.velocity);
+      break;
+    case NOTE_EVENT_SEQ_MODE:
+      ApplySeqMode((SeqMode)e.note);
+      break;
+    default:
+      notes_.SetMode((NotePriorityMode)e.note);
+      break;
+    }
+  }
+  note_tail_.store(tail, std::memory_order_release);
+}
+
+void VoiceManager::ApplyNoteOn(byte inChannel, byte inNote, byte inVelocity)
 {
   // Note Off can come in as Note On w/ 0 Velocity
   if (inVelocity == 0.f)
   {
-    NoteOff(inChannel, inNote, inVelocity);
+    ApplyNoteOff(inChannel, inNote, inVelocity);
+    return;
   }
-  else
+  notes_.Push(inNote, inVelocity);
+  // the sequencer always knows what is held, it plays the voice itself
+  seq_.Hold(inNote, inVelocity);
+  if (seq_.Mode() != SEQ_MODE_OFF)
+    return;
+  byte next_note = notes_.Current();
+  // in low / high priority a new note may not take over the voice; one
+  // the sequencer left sounding always hands over, with a retrigger
+  if (!sounding_ || seq_sounding_ || next_note != current_note_)
   {
-    PushNote(inNote);
-    current_velo_ = inVelocity;
-    voice_.NoteOn(inChannel, inNote, current_velo_);
+    const bool legato = sounding_ && !seq_sounding_;
+    current_note_ = next_note;
+    current_velo_ = notes_.Velocity(next_note);
+    // legato: glides when a glide time is set
+    voice_.NoteOn(inChannel, current_note_, current_velo_, legato);
+    sounding_ = true;
+    seq_sounding_ = false;
   }
 }
 
-void VoiceManager::NoteOff(byte inChannel, byte inNote, byte inVelocity)
+void VoiceManager::ApplyNoteOff(byte inChannel, byte inNote, byte inVelocity)
 {
-  if (current_note_ == inNote)
+  notes_.Release(inNote);
+  seq_.Release(inNote);
+  // the sequencer's last note is ended by its own stop note-off
+  if (seq_.Mode() != SEQ_MODE_OFF || seq_sounding_)
+    return;
+  if (notes_.Empty())
   {
-    byte next_note = PopNote();
-    if (held_count_ <= 0)
+    if (sounding_)
     {
+      sounding_ = false;
       current_velo_ = 0;
       voice_.NoteOff(inChannel, inNote, current_velo_);
     }
-    else
-    {
-      voice_.NoteOn(inChannel, next_note, current_velo_);
-    }
+    return;
   }
-  else
+  // fall back on the note that now has priority, legato
+  byte next_note = notes_.Current();
+  if (next_note != current_note_)
   {
-    DeleteNote(inNote);
+    current_note_ = next_note;
+    current_velo_ = notes_.Velocity(next_note);
+    voice_.NoteOn(inChannel, current_note_, current_velo_, true);
   }
 }
 
-void VoiceManager::PushNote(byte inNote)
+// GM-style mod wheel (morph), portamento, volume and effect sends, then
+// the external input (route / follower mode in three ranges of the CC
+// value), the sequencer, the morph captures and the note priority
+bool VoiceManager::ControlChange(byte inChannel, byte inControl, byte inValue)
 {
-  if (held_notes_tracker_[inNote])
+  (void)inChannel;
+  float v = inValue / 127.f;
+  switch (inControl)
   {
-    current_note_ = inNote;
-    return;
+  case 1:
+    morph_.SetPosition(v);
+    return true;
+  case 5:
+    SetGlide(v * v);
+    return true;
+  case 7:
+    master_.SetOutputGain(v * v);
+    return true;
+  case 91:
+    fx_.SetReverbMix(v);
+    return true;
+  case 93:
+    fx_.SetChorusMix(v);
+    return true;
+  case 94:
+    fx_.SetDelayMix(v);
+    return true;
+  case 102:
+    SetInputRoute((InputRoute)(inValue / 43));
+    return true;
+  case 103:
+    SetFollowMode((FollowMode)(inValue / 43));
+    return true;
+  case 104:
+    SetFmDepth(2.f * v);
+    return true;
+  case 105:
+    SetFollowThreshold(v * v);
+    return true;
+  case 106:
+    SetSeqMode((SeqMode)(inValue / 43));
+    return true;
+  case 107:
+    seq_.SetTempo(40.f + 2.f * inValue);
+    return true;
+  case 108:
+    seq_.SetDivision(SEQ_DIVISIONS[inValue / 32]);
+    return true;
+  case 109:
+    seq_.SetArpOrder((ArpOrder)(inValue / 32));
+    return true;
+  case 110:
+    seq_.SetGate(v);
+    return true;
+  case 111:
+    seq_.SetRatchet(1 + inValue / 32);
+    return true;
+  case 112:
+    if (inValue >= 64)
+      CaptureMorph(0);
+    return true;
+  case 113:
+    if (inValue >= 64)
+      CaptureMorph(1);
+    return true;
+  case 114:
+    morph_.SetEnabled(inValue >= 64);
+    return true;
+  case 115:
+    SetNotePriority((NotePriorityMode)(inValue / 43));
+    return true;
+  default:
+    return false;
   }
-  current_note_ = inNote;
-  held_notes_values_[top_] = inNote;
-  held_notes_tracker_[inNote] = true;
-  held_count_++;
-  top_++;
 }
 
-byte VoiceManager::PopNote()
+// a note played directly stops when the sequencer takes over; the
+// sequencer silences its own note when it is switched off
+void VoiceManager::ApplySeqMode(SeqMode mode)
 {
-  held_count_--;
-  held_notes_tracker_[current_note_] = false;
-  if (held_count_ <= 0)
+  if (mode != SEQ_MODE_OFF && seq_.Mode() == SEQ_MODE_OFF && sounding_ && !seq_sounding_)
   {
-    top_ = 0;
-    return 0;
+    voice_.NoteOff(1, current_note_, 0);
+    sounding_ = false;
   }
-  for (int i = top_ - 1; i >= 0; --i)
-  {
-    byte note = held_notes_values_[i];
-    if (held_notes_tracker_[note])
-    {
-      current_note_ = note;
-      top_ = i + 1;
-      return note;
-    }
-  }
-  held_count_ = 0;
-  top_ = 0;
-  return 0; // should never reach here...
+  seq_.SetMode(mode);
 }
 
-void VoiceManager::DeleteNote(byte inNote)
+// at the event's own sample, the sample stream included
+void VoiceManager::ApplySeqEvent(const SeqEvent &e)
 {
-  if (held_notes_tracker_[inNote])
+  if (e.type == SEQ_EVENT_NOTE_ON)
+  {
+    current_note_ = e.note;
+    current_velo_ = e.velocity;
+    sounding_ = true;
+    seq_sounding_ = true;
+    voice_.NoteOn(1, e.note, e.velocity, e.glide);
+  }
+  else if (seq_sounding_)
   {
-    held_notes_tracker_[inNote] = false;
-    if (held_count_ > 0)
-      held_count_--;
+    // the stop note-off comes a block after a mode change: a note played
+    // directly since then is not the sequencer's to end
+    sounding_ = false;
+    seq_sounding_ = false;
+    voice_.NoteOff(1, e.note, 0);
   }
 }
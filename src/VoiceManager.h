@@ -1,29 +1,161 @@
 #pragma once
 #include "Voice.h"
+#include "NotePriority.h"
+#include "vs_fx.h"
+#include "Telemetry.h"
+#include "vs_halfband.h"
+#include "Sequencer.h"
+#include "vs_master.h"
+#include "ParamMorph.h"
+#include <atomic>
+
+// quality tiers, 0 = full quality, see QUALITY_TIER_TABLE in VoiceManager.cpp
+#define QUALITY_TIERS 5
+
+// note events loop() can queue between two audio blocks, power of two
+#define NOTE_QUEUE_SIZE 64
+
+// the voice runs at this multiple of the codec rate, 1 or 2 (per build env)
+#ifndef ENGINE_OVERSAMPLE
+#define ENGINE_OVERSAMPLE 1
+#endif
 
 class VoiceManager
 {
 public:
-  void Init(float sample_rate);
+  // sample_rate is the codec's; with oversample 2 the voice runs at twice
+  // that and is decimated before the FX bus
+  void Init(float sample_rate, size_t oversample = 1);
+  // rate the voice (and anything attached to it) runs at
+  float VoiceRate() const { return voice_rate_; }
+  size_t Oversample() const { return oversample_; }
 
+  // note changes (these, SetSeqMode and SetNotePriority) are queued and
+  // applied by ProcessBlock before it renders, so the held notes and the
+  // sounding note only ever change on the audio side; a full queue drops
+  // the event and counts it
   void NoteOn(byte inChannel, byte inNote, byte inVelocity);
   void NoteOff(byte inChannel, byte inNote, byte inVelocity);
+  uint32_t NoteDrops() const { return note_drops_.load(std::memory_order_relaxed); }
+  // the MIDI CC map (see the README), shared by the sketch and the host
+  // tools; false for a controller the engine does not use
+  bool ControlChange(byte inChannel, byte inControl, byte inValue);
+
+  // `in` is the codec's input block, as handed to the callback (nullptr =
+  // none); only in[0] is used, read in place
+  void ProcessBlock(float **out, size_t size, const float *const *in = nullptr);
+  // called at control-rate from outside: resolved here, handed to the
+  // voice by ProcessBlock unless the morph is driving it
+  void SetParams(const SynthParams &p);
+  void SetSeed(uint32_t seed);
+
+  // can be changed while notes are held, takes effect on the next note event
+  void SetNotePriority(NotePriorityMode mode);
+
+  // bank 1 sample playback, see VS_SampleStream
+  void SetSampleStream(VS_SampleStream *stream) { voice_.SetSampleStream(stream); }
+
+  /* external input, see InputRoute / FollowMode */
+  void SetInputRoute(InputRoute route) { voice_.SetInputRoute(route); }
+  void SetFmDepth(float depth) { voice_.SetFmDepth(depth); }
+  void SetFollowMode(FollowMode mode) { voice_.SetFollowMode(mode); }
+  void SetFollowThreshold(float open) { voice_.SetFollowThreshold(open); }
+
+  // master FX bus, runs after the voice once Init'ed with its arena
+  VS_FxBus &Fx() { return fx_; }
 
-  void ProcessBlock(float **out, size_t size);
-  void UpdateParamsFromHardware(const SynthHardware &hw);
+  // DC blocker, soft clip and output gain, after the FX
+  VS_Master &Master() { return master_; }
+
+  // clock / arpeggiator / step sequencer, plays the voice from inside
+  // ProcessBlock when its mode is not off
+  Sequencer &Seq() { return seq_; }
+  void SetSeqMode(SeqMode mode);
+  // portamento for legato notes and sequencer slides, 0 = off
+  void SetGlide(float seconds) { voice_.SetGlide(seconds); }
+
+  // crossfade between two captured panel states, run from ProcessBlock;
+  // while it is enabled the panel's own settings are only kept for the
+  // next capture
+  ParamMorph &Morph() { return morph_; }
+  // end 0 = A, 1 = B: the panel as last passed to SetParams
+  void CaptureMorph(uint8_t end);
+
+  // 0 = full quality .. QUALITY_TIERS - 1 = cheapest, set from the Governor
+  void SetQualityTier(uint8_t tier);
+  uint8_t QualityTier() const { return tier_; }
+
+  // voice / note state for a telemetry record (cycles and seq left to the caller)
+  void FillTelemetry(TelemetryRecord &rec) const;
+  // the set the voice runs on, as of the last block
+  const ResolvedParams &Resolved() const { return voice_.Resolved(); }
 
 private:
   Voice voice_;
+  VS_FxBus fx_;
+  VS_Master master_;
+  Sequencer seq_;
+  SeqEvent seq_events_[SEQ_MAX_EVENTS];
+  ParamMorph morph_;
+  ResolvedParams morph_out_;
+  bool morph_on_ = false; // as the last block saw it
+  SynthParams panel_;
+
+  /* panel, loop() -> audio side: a triple buffer, neither side waits and
+     the audio side always takes a whole set */
+  static const uint8_t PANEL_FRESH = 4;
+  ResolvedParams panel_buf_[3];
+  std::atomic<uint8_t> panel_middle_{1}; // index, | PANEL_FRESH once written
+  uint8_t panel_back_ = 0;               // loop() side
+  uint8_t panel_front_ = 2;              // audio side
+  bool panel_ready_ = false;             // audio side, a set has come in
+  void ApplyPanel(size_t size);
+  SynthParams morph_ends_[2];
+  bool morph_captured_[2] = {false, false};
+
+  // voice (+ decimation) for [start, start + n) of the block, mono
+  void RenderVoice(float *out, size_t start, size_t n, const float *src);
+  void ApplySeqEvent(const SeqEvent &e);
+
+  /* loop() -> audio side, single producer / single consumer */
+  enum NoteEventType : uint8_t
+  {
+    NOTE_EVENT_ON,
+    NOTE_EVENT_OFF,
+    NOTE_EVENT_SEQ_MODE,
+    NOTE_EVENT_PRIORITY,
+  };
+  struct NoteEvent
+  {
+    uint8_t type; // NoteEventType
+    byte channel, note, velocity;
+  };
+  NoteEvent note_queue_[NOTE_QUEUE_SIZE];
+  std::atomic<uint32_t> note_head_{0}; // written by loop()
+  std::atomic<uint32_t> note_tail_{0}; // written by the audio side
+  std::atomic<uint32_t> note_drops_{0};
+  void PostNote(uint8_t type, byte channel, byte note, byte velocity);
+  void ApplyNoteEvents();
+  void ApplyNoteOn(byte inChannel, byte inNote, byte inVelocity);
+  void ApplyNoteOff(byte inChannel, byte inNote, byte inVelocity);
+  void ApplySeqMode(SeqMode mode);
+  uint8_t tier_ = 0;
+
+  /* multirate */
+  float voice_rate_ = 48000.f;
+  size_t oversample_ = 1;
+  // modulation keeps its 48 kHz rate: tier intervals are scaled by this
+  size_t mod_scale_ = 1;
+  VS_Decimator decim_;
+  float os_buf_[2 * HALFBAND_CHUNK];
+  // the input, sample-and-hold up to the voice rate
+  float os_in_[2 * HALFBAND_CHUNK];
 
-  // LAST note priority stack
+  // held notes + priority (last / low / high)
+  NotePriority notes_;
+  bool sounding_ = false;
+  // the sounding note was started by the sequencer, which may end it
+  bool seq_sounding_ = false;
   byte current_note_ = 0;
   byte current_velo_ = 0;
-  byte held_count_ = 0;
-  byte top_ = 0;
-  byte held_notes_values_[128];
-  bool held_notes_tracker_[128];
-
-  void PushNote(byte inNote);
-  byte PopNote();
-  void DeleteNote(byte inNote);
 };
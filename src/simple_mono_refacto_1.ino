@@ -1,20 +1,70 @@
 #include "DaisyDuino.h"
 #include "SynthHardware.h"
 #include "VoiceManager.h"
+#include "Governor.h"
+#include "MidiPump.h"
 #include <MIDI.h>
+#if OSC_BANK == 1
+#include <STM32SD.h>
+#endif
 
 MIDI_CREATE_DEFAULT_INSTANCE();
 
 SynthHardware g_hw;
 VoiceManager g_vm;
+// FX delay lines live in SDRAM, reserved once at link time
+static float DSY_SDRAM_BSS g_fx_arena[FX_ARENA_SIZE];
+// per-block records, drained to USB CDC by loop()
+Telemetry g_telemetry;
+// sheds quality before the callback overruns
+Governor g_governor;
+// control trace, started / stopped with CC 119 and dumped over USB CDC
+static ControlTraceEvent DSY_SDRAM_BSS g_trace_buf[TRACE_CAPACITY];
+ControlTrace g_trace;
+// bounded MIDI parsing per loop() pass, counts UART overflows
+MidiPump g_midi_pump;
+#if OSC_BANK == 1
+// bank 1 multisample from the SD card: resident parts in SDRAM, the rest
+// streamed by loop()
+static float DSY_SDRAM_BSS g_sample_arena[SAMPLE_ARENA_SIZE];
+VS_SampleSet g_samples;
+VS_SampleStream g_stream;
+#endif
 
 static void AudioCallback(float **in, float **out, size_t size)
 {
-  g_vm.ProcessBlock(out, size);
+  uint32_t start = TelemetryCycles();
+  g_trace.TickBlock();
+  g_vm.ProcessBlock(out, size, in);
+  uint32_t cycles = TelemetryCycles() - start;
+  if (g_governor.Update(cycles))
+    g_vm.SetQualityTier(g_governor.Tier());
+  if (g_telemetry.Tick())
+  {
+    TelemetryRecord rec;
+    g_vm.FillTelemetry(rec);
+    rec.cycles = cycles;
+    rec.midi_overflows = (uint16_t)g_midi_pump.Overflows();
+    g_telemetry.Push(rec);
+  }
+}
+
+// sends whatever the CDC link can take right now, never waits on the host;
+// a finished control trace goes out first, telemetry waits until it is done
+static void DrainTelemetry()
+{
+  static uint8_t tx[512];
+  size_t room = Serial.availableForWrite();
+  if (room > sizeof(tx))
+    room = sizeof(tx);
+  size_t len = g_trace.Draining() ? g_trace.Drain(tx, room) : g_telemetry.Drain(tx, room);
+  if (len > 0)
+    Serial.write(tx, len);
 }
 
 void handleNoteOn(byte ch, byte note, byte vel)
 {
+  g_trace.CaptureMidi(0x90 | ((ch - 1) & 0x0f), note, vel);
   if (vel == 0.f)
   {
     digitalWrite(LED_BUILTIN, 0);
@@ -29,28 +79,82 @@ void handleNoteOn(byte ch, byte note, byte vel)
 
 void handleNoteOff(byte ch, byte note, byte vel)
 {
+  g_trace.CaptureMidi(0x80 | ((ch - 1) & 0x0f), note, vel);
   digitalWrite(LED_BUILTIN, 0);
   g_vm.NoteOff(ch, note, vel);
 }
 
+// the engine's CC map lives in VoiceManager::ControlChange, shared with
+// the host tools; CC 119 starts / stops the control trace
+void handleControlChange(byte ch, byte cc, byte value)
+{
+  g_trace.CaptureMidi(0xB0 | ((ch - 1) & 0x0f), cc, value);
+  if (cc == 119)
+  {
+    if (value >= 64)
+      g_trace.Start(DAISY.get_samplerate(), DAISY.AudioBlockSize(), g_vm.Oversample());
+    else
+      g_trace.Stop();
+    return;
+  }
+  g_vm.ControlChange(ch, cc, value);
+}
+
 void setup()
 {
   g_hw.Init(1000);
   float sr = DAISY.get_samplerate();
 
-  g_vm.Init(sr);
+  g_vm.Init(sr, ENGINE_OVERSAMPLE);
+  // lines that do not fit leave the bus bypassed: the synth still plays,
+  // dry. Three flashes say so before audio starts, and every telemetry
+  // record carries the flag and the arena use
+  if (!g_vm.Fx().Init(sr, g_fx_arena, FX_ARENA_SIZE))
+  {
+    pinMode(LED_BUILTIN, OUTPUT);
+    for (int i = 0; i < 3; i++)
+    {
+      digitalWrite(LED_BUILTIN, 1);
+      delay(150);
+      digitalWrite(LED_BUILTIN, 0);
+      delay(150);
+    }
+  }
+
+  Serial.begin(115200);
+  g_telemetry.Init();
+  g_governor.Init(sr, DAISY.AudioBlockSize(), TelemetryCyclesPerSecond(), QUALITY_TIERS - 1);
+  g_trace.Init(g_trace_buf, TRACE_CAPACITY);
+  g_hw.SetTrace(&g_trace);
+
+#if OSC_BANK == 1
+  // no card or no samples: the bank keeps its synthetic shapes
+  if (SD.begin() && g_samples.Load("/samples", g_sample_arena, SAMPLE_ARENA_SIZE) > 0)
+  {
+    g_stream.Init(g_vm.VoiceRate());
+    g_stream.Attach(&g_samples);
+    g_vm.SetSampleStream(&g_stream);
+  }
+#endif
 
   pinMode(LED_BUILTIN, OUTPUT);
   MIDI.setHandleNoteOn(handleNoteOn);
   MIDI.setHandleNoteOff(handleNoteOff);
+  MIDI.setHandleControlChange(handleControlChange);
   MIDI.begin(MIDI_CHANNEL_OMNI);
+  g_midi_pump.Init(MIDI_PASS_BUDGET, MIDI_RX_BUFFER);
 
   DAISY.begin(AudioCallback);
 }
 
 void loop()
 {
-  MIDI.read();
+  // the library parses one byte per read(): loop until the budget is spent
+  g_midi_pump.Pump([] { return MIDI.read(); }, [] { return Serial1.available(); });
   g_hw.UpdateControls();
-  g_vm.UpdateParamsFromHardware(g_hw);
+  g_vm.SetParams(g_hw.Params());
+#if OSC_BANK == 1
+  g_stream.Service();
+#endif
+  DrainTelemetry();
 }
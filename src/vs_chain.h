@@ -0,0 +1,204 @@
+#pragma once
+#include "DaisyDuino.h"
+#include "SynthParams.h"
+#include "vs_osc.h"
+
+/**
+ * Compile-time voice graph.
+ *
+ * A voice path is a typed chain of stages, e.g.
+ *   Chain<OscStage<OSC_TYPE_SAW>, LadderStage, VcaStage<AMP_MODE_ADSR>>
+ * Stages are thin views over state the voice owns, and Chain::Process is a
+ * plain nested call: the compiler inlines the whole chain into the caller's
+ * sample loop, with no virtual calls and no per-sample mode switch. Each
+ * mode / bank combination is its own type, picked once per block (and so
+ * is bank 1's choice between samples and synthetic shapes).
+ *
+ * A stage provides:
+ *   void Prepare(const VoiceParams &p);           once per block
+ *   float Process(float in, const VoiceFrame &f); once per sample
+ *
+ * The first stage's `in` is the external audio input, read straight from
+ * the codec's buffer (silence when there is none).
+ */
+
+// control-rate snapshot, the only place stages read parameters from
+struct VoiceParams
+{
+  // oscillator shape and mod depths, see VS_Osc::Prepare
+  float osc_param = 0.f;
+  float env_osc_depth = 0.f;
+  float lfo_osc_depth = 0.f;
+  float base_cutoff = 1000.f;
+  float flt_drive = 1.f;
+  float env_cutoff_depth = 0.f;
+  float lfo_cutoff_depth = 0.f;
+  // from the sample rate, see VS_RateLimits
+  float max_cutoff = 18000.f;
+  // external input as FM: frequency * (1 + fm_depth * in)
+  float fm_depth = 0.f;
+  // samples between cutoff updates, raised by the lower quality tiers
+  size_t mod_interval = 1;
+};
+
+// per-sample modulation, shared by every stage
+struct VoiceFrame
+{
+  float freq;
+  float env;
+  float lfo;
+  bool gate;
+};
+
+template <typename... Stages>
+class Chain;
+
+template <>
+class Chain<>
+{
+public:
+  inline void Prepare(const VoiceParams &) {}
+  inline float Process(float in, const VoiceFrame &) { return in; }
+};
+
+template <typename Head, typename... Tail>
+class Chain<Head, Tail...>
+{
+public:
+  Chain(Head head, Tail... tail) : head_(head), tail_(tail...) {}
+
+  inline void Prepare(const VoiceParams &p)
+  {
+    head_.Prepare(p);
+    tail_.Prepare(p);
+  }
+
+  inline float Process(float in, const VoiceFrame &f)
+  {
+    return tail_.Process(head_.Process(in, f), f);
+  }
+
+private:
+  Head head_;
+  Chain<Tail...> tail_;
+};
+
+template <typename... Stages>
+inline Chain<Stages...> MakeChain(Stages... stages)
+{
+  return Chain<Stages...>(stages...);
+}
+
+/**
+ * stages
+ */
+template <OscType Type, int Bank = OSC_BANK, bool Sampled = false>
+class OscStage
+{
+public:
+  explicit OscStage(VS_Osc &osc) : osc_(osc) {}
+  inline void Prepare(const VoiceParams &p)
+  {
+    osc_.Prepare<Type, Bank>(p.osc_param, p.env_osc_depth, p.lfo_osc_depth);
+  }
+  inline float Process(float, const VoiceFrame &f)
+  {
+    return osc_.ProcessAs<Type, Bank, Sampled>(f.freq, f.env, f.lfo);
+  }
+
+private:
+  VS_Osc &osc_;
+};
+
+// oscillator with the external input as linear FM
+template <OscType Type, int Bank = OSC_BANK, bool Sampled = false>
+class FmOscStage
+{
+public:
+  explicit FmOscStage(VS_Osc &osc) : osc_(osc) {}
+  inline void Prepare(const VoiceParams &p)
+  {
+    osc_.Prepare<Type, Bank>(p.osc_param, p.env_osc_depth, p.lfo_osc_depth);
+    depth_ = p.fm_depth;
+  }
+  inline float Process(float in, const VoiceFrame &f)
+  {
+    float freq = f.freq * (1.f + depth_ * in);
+    if (freq < 0.f)
+      freq = 0.f;
+    return osc_.ProcessAs<Type, Bank, Sampled>(freq, f.env, f.lfo);
+  }
+
+private:
+  VS_Osc &osc_;
+  float depth_;
+};
+
+// the external input in place of the oscillator
+class InputStage
+{
+public:
+  inline void Prepare(const VoiceParams &) {}
+  inline float Process(float in, const VoiceFrame &) { return in; }
+};
+
+// moog ladder with env + LFO cutoff modulation, drive grows with resonance
+class LadderStage
+{
+public:
+  explicit LadderStage(MoogLadder &flt) : flt_(flt) {}
+
+  inline void Prepare(const VoiceParams &p)
+  {
+    const float maxModOct = 5.0f;
+    base_cutoff_ = p.base_cutoff;
+    drive_ = p.flt_drive;
+    env_oct_ = p.env_cutoff_depth * maxModOct;
+    lfo_oct_ = p.lfo_cutoff_depth * maxModOct;
+    max_cutoff_ = p.max_cutoff;
+    interval_ = p.mod_interval;
+    countdown_ = 0;
+  }
+
+  inline float Process(float in, const VoiceFrame &f)
+  {
+    if (countdown_ == 0)
+    {
+      float total_oct = (f.env * env_oct_) + (f.lfo * lfo_oct_);
+      float cutoff = base_cutoff_ * exp2f(total_oct);
+      if (cutoff < 20.f)
+        cutoff = 20.f;
+      if (cutoff > max_cutoff_)
+        cutoff = max_cutoff_;
+      flt_.SetFreq(cutoff);
+      countdown_ = interval_;
+    }
+    countdown_--;
+    return flt_.Process(in * drive_);
+  }
+
+private:
+  MoogLadder &flt_;
+  float base_cutoff_, drive_, env_oct_, lfo_oct_, max_cutoff_;
+  size_t interval_, countdown_;
+};
+
+template <AmpMode Mode>
+class VcaStage
+{
+public:
+  // the release-only envelope is only ticked in AMP_MODE_RELEASE
+  explicit VcaStage(Adsr &env_rel) : env_rel_(env_rel) {}
+  inline void Prepare(const VoiceParams &) {}
+  inline float Process(float in, const VoiceFrame &f)
+  {
+    if (Mode == AMP_MODE_ADSR)
+      return in * f.env;
+    if (Mode == AMP_MODE_DRONE)
+      return in;
+    return in * env_rel_.Process(f.gate);
+  }
+
+private:
+  Adsr &env_rel_;
+};
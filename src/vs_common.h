@@ -0,0 +1,5 @@
+#pragma once
+
+// per-sample code that has to end up inside the caller's sample loop,
+// whatever the optimiser's size budget (the firmware builds with -Os)
+#define VS_INLINE inline __attribute__((always_inline))
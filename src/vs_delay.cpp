@@ -0,0 +1,81 @@
+#include "vs_delay.h"
+#include <string.h>
+
+// 32-byte D-cache lines on the M7
+#define ARENA_ALIGN_FLOATS 8
+
+void VS_Arena::Init(float *base, size_t size)
+{
+    base_ = base;
+    capacity_ = size;
+    used_ = 0;
+}
+
+float *VS_Arena::Allocate(size_t size)
+{
+    size_t start = (used_ + ARENA_ALIGN_FLOATS - 1) & ~(size_t)(ARENA_ALIGN_FLOATS - 1);
+    if (base_ == nullptr || start + size > capacity_)
+        return nullptr;
+    used_ = start + size;
+    return base_ + start;
+}
+
+bool VS_DelayLine::Init(VS_Arena &arena, size_t length)
+{
+    size_t len = 1;
+    while (len < length)
+        len <<= 1;
+    buf_ = arena.Allocate(len);
+    if (buf_ == nullptr)
+        return false;
+    mask_ = len - 1;
+    Clear();
+    return true;
+}
+
+void VS_DelayLine::Clear()
+{
+    if (buf_ != nullptr)
+        memset(buf_, 0, (mask_ + 1) * sizeof(float));
+    write_ = 0;
+}
+
+size_t VS_DelayLine::ClearSpan(size_t start, size_t count)
+{
+    if (buf_ == nullptr || start > mask_)
+        return 0;
+    if (count > mask_ + 1 - start)
+        count = mask_ + 1 - start;
+    memset(buf_ + start, 0, count * sizeof(float));
+    return count;
+}
+
+void VS_DelayLine::Read(float *out, size_t size, size_t delay) const
+{
+    size_t start = (write_ - delay) & mask_;
+    size_t first = mask_ + 1 - start;
+    if (first >= size)
+    {
+        memcpy(out, buf_ + start, size * sizeof(float));
+    }
+    else
+    {
+        memcpy(out, buf_ + start, first * sizeof(float));
+        memcpy(out + first, buf_, (size - first) * sizeof(float));
+    }
+}
+
+void VS_DelayLine::Write(const float *in, size_t size)
+{
+    size_t first = mask_ + 1 - write_;
+    if (first >= size)
+    {
+        memcpy(buf_ + write_, in, size * sizeof(float));
+    }
+    else
+    {
+        memcpy(buf_ + write_, in, first * sizeof(float));
+        memcpy(buf_, in + first, (size - first) * sizeof(float));
+    }
+    write_ = (write_ + size) & mask_;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Bump allocator over a fixed block of memory handed over at boot (the
+ * SDRAM on the Daisy). Nothing is ever freed; the whole point is that all
+ * delay memory is laid out once, with a known budget, and never touches
+ * the heap.
+ */
+class VS_Arena
+{
+public:
+  void Init(float *base, size_t size);
+  // cache-line aligned, nullptr when the budget is exhausted
+  float *Allocate(size_t size);
+
+  size_t Used() const { return used_; }
+  size_t Capacity() const { return capacity_; }
+
+private:
+  float *base_ = nullptr;
+  size_t capacity_ = 0, used_ = 0;
+};
+
+/**
+ * Power-of-two ring buffer that is only accessed a block at a time:
+ * one contiguous write burst per block and one contiguous read run per tap,
+ * split in two at most where the ring wraps. Much friendlier to the SDRAM
+ * controller and the D-cache than scattered per-sample accesses.
+ * A block read must lie entirely in the past: delay >= size.
+ */
+class VS_DelayLine
+{
+public:
+  // length is rounded up to a power of two, false if the arena is full
+  bool Init(VS_Arena &arena, size_t length);
+  void Clear();
+  // zeroes up to `count` samples from `start` on, for a clear spread over
+  // several blocks; returns how many it zeroed (0 past the end)
+  size_t ClearSpan(size_t start, size_t count);
+
+  size_t Length() const { return mask_ + 1; }
+
+  // `size` samples, the first one written `delay` samples before the next write
+  void Read(float *out, size_t size, size_t delay) const;
+  void Write(const float *in, size_t size);
+
+private:
+  float *buf_ = nullptr;
+  size_t mask_ = 0;
+  size_t write_ = 0;
+};
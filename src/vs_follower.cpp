@@ -0,0 +1,27 @@
+#include "vs_follower.h"
+
+void VS_Follower::Init(float sample_rate)
+{
+    sr_ = sample_rate;
+    level_ = 0.f;
+    gate_ = rising_ = false;
+}
+
+void VS_Follower::Process(const float *in, size_t n)
+{
+    float peak = 0.f;
+    for (size_t i = 0; i < n; i++)
+        peak = fmaxf(peak, fabsf(in[i]));
+
+    // one-pole step over the whole block
+    float time = peak > level_ ? attack_s_ : release_s_;
+    float coeff = 1.f - expf(-(float)n / (time * sr_));
+    level_ += coeff * (peak - level_);
+
+    bool was_open = gate_;
+    if (gate_)
+        gate_ = level_ > 0.5f * open_;
+    else
+        gate_ = level_ > open_;
+    rising_ = gate_ && !was_open;
+}
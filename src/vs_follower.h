@@ -0,0 +1,31 @@
+#pragma once
+#include "DaisyDuino.h"
+
+/**
+ * Block-rate envelope follower for the external input: one peak per block,
+ * smoothed with separate attack / release times, and a gate with
+ * hysteresis on top. Costs one pass over the block for the peak and one
+ * expf per block.
+ */
+class VS_Follower
+{
+public:
+  void Init(float sample_rate);
+  // one block of input
+  void Process(const float *in, size_t n);
+
+  // linear, 0..1 full scale; the gate closes at half the open threshold
+  void SetThreshold(float open) { open_ = open; }
+
+  float Level() const { return level_; }
+  bool Gate() const { return gate_; }
+  // the gate opened on the last block
+  bool Rising() const { return rising_; }
+
+private:
+  float sr_ = 48000.f;
+  float attack_s_ = 0.002f, release_s_ = 0.03f;
+  float open_ = 0.05f;
+  float level_ = 0.f;
+  bool gate_ = false, rising_ = false;
+};
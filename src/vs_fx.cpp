@@ -0,0 +1,336 @@
+#include "vs_fx.h"
+
+// Freeverb tunings, in samples at 44.1 kHz
+static const size_t COMB_TUNING[] = {1116, 1188, 1277, 1356};
+static const size_t ALLPASS_TUNING[] = {556, 441};
+static const size_t STEREO_SPREAD = 23;
+
+bool VS_FxBus::Init(float sample_rate, float *arena, size_t arena_size)
+{
+    sample_rate_ = sample_rate;
+    arena_.Init(arena, arena_size);
+    ready_ = false;
+    clearing_ = 0;
+
+    /* CHORUS */
+    chorus_center_ = CHORUS_CENTER_S * sample_rate_;
+    chorus_depth_ = CHORUS_DEPTH_S * sample_rate_;
+    chorus_inc_ = CHORUS_RATE / sample_rate_;
+    if (!chorus_line_.Init(arena_, (size_t)(chorus_center_ + chorus_depth_) + MAX_BLOCK + 2))
+        return false;
+
+    /* DELAY */
+    if (!delay_line_.Init(arena_, (size_t)(DELAY_MAX_S * sample_rate_) + 1))
+        return false;
+    SetDelayTime(0.375f);
+
+    /* REVERB */
+    const float scale = sample_rate_ / 44100.f;
+    for (int side = 0; side < 2; side++)
+    {
+        for (int c = 0; c < COMBS; c++)
+        {
+            comb_len_[side][c] = (size_t)((COMB_TUNING[c] + side * STEREO_SPREAD) * scale);
+            comb_lp_[side][c] = 0.f;
+            if (!comb_[side][c].Init(arena_, comb_len_[side][c]))
+                return false;
+        }
+        for (int a = 0; a < ALLPASSES; a++)
+        {
+            allpass_len_[side][a] = (size_t)((ALLPASS_TUNING[a] + side * STEREO_SPREAD) * scale);
+            if (!allpass_[side][a].Init(arena_, allpass_len_[side][a]))
+                return false;
+        }
+    }
+    ready_ = true;
+    return true;
+}
+
+/**
+ * control-rate setters
+ * an effect's line is cleared while it is still bypassed, so switching it
+ * back on never replays stale audio
+ */
+void VS_FxBus::SetChorusMix(float mix)
+{
+    if (chorus_mix_ <= 0.f && mix > 0.f)
+        ClearChorus();
+    chorus_mix_ = fclamp(mix, 0.f, 1.f);
+}
+
+void VS_FxBus::SetDelayMix(float mix)
+{
+    if (delay_mix_ <= 0.f && mix > 0.f)
+        ClearDelay();
+    delay_mix_ = fclamp(mix, 0.f, 1.f);
+}
+
+void VS_FxBus::SetDelayTime(float seconds)
+{
+    // block reads need at least one block of delay
+    float samples = fclamp(seconds, 0.f, DELAY_MAX_S) * sample_rate_;
+    delay_samples_ = (size_t)samples;
+    if (delay_samples_ < MAX_BLOCK)
+        delay_samples_ = MAX_BLOCK;
+    if (delay_samples_ > delay_line_.Length() - MAX_BLOCK)
+        delay_samples_ = delay_line_.Length() - MAX_BLOCK;
+}
+
+void VS_FxBus::SetDelayFeedback(float feedback)
+{
+    delay_feedback_ = fclamp(feedback, 0.f, 0.95f);
+}
+
+void VS_FxBus::SetReverbMix(float mix)
+{
+    if (reverb_mix_ <= 0.f && mix > 0.f)
+        ClearReverb();
+    reverb_mix_ = fclamp(mix, 0.f, 1.f);
+}
+
+void VS_FxBus::SetReverbSize(float size)
+{
+    reverb_feedback_ = 0.7f + 0.28f * fclamp(size, 0.f, 1.f);
+}
+
+/**
+ * audio side (the Governor sheds effects from the callback)
+ * effects coming back start from silence, not from where they stopped;
+ * their lines are cleared a slice per block, a whole memset of the reverb
+ * would land in a single callback
+ */
+void VS_FxBus::SetBypass(uint8_t mask)
+{
+    clearing_ |= bypass_ & ~mask;
+    bypass_ = mask;
+}
+
+// i-th line of an effect, nullptr past the last one
+VS_DelayLine *VS_FxBus::Line(uint8_t effect, int i)
+{
+    switch (effect)
+    {
+    case FX_CHORUS:
+        return i == 0 ? &chorus_line_ : nullptr;
+    case FX_DELAY:
+        return i == 0 ? &delay_line_ : nullptr;
+    default:
+        if (i < 2 * COMBS)
+            return &comb_[i / COMBS][i % COMBS];
+        i -= 2 * COMBS;
+        if (i < 2 * ALLPASSES)
+            return &allpass_[i / ALLPASSES][i % ALLPASSES];
+        return nullptr;
+    }
+}
+
+void VS_FxBus::ResetState(uint8_t effect)
+{
+    if (effect == FX_DELAY)
+        delay_lp_ = 0.f;
+    if (effect == FX_REVERB)
+        for (int side = 0; side < 2; side++)
+            for (int c = 0; c < COMBS; c++)
+                comb_lp_[side][c] = 0.f;
+}
+
+void VS_FxBus::BeginBlock()
+{
+    size_t budget = FX_CLEAR_PER_BLOCK;
+    while (clearing_ && budget > 0)
+    {
+        // one effect at a time, lowest bit first
+        const uint8_t effect = clearing_ & (uint8_t)-clearing_;
+        VS_DelayLine *line = Line(effect, clear_line_);
+        if (line == nullptr)
+        {
+            ResetState(effect);
+            clearing_ &= ~effect;
+            clear_line_ = 0;
+            clear_pos_ = 0;
+            continue;
+        }
+        size_t n = line->ClearSpan(clear_pos_, budget);
+        budget -= n;
+        clear_pos_ += n;
+        if (clear_pos_ >= line->Length())
+        {
+            clear_line_++;
+            clear_pos_ = 0;
+        }
+    }
+}
+
+void VS_FxBus::ClearChorus()
+{
+    chorus_line_.Clear();
+}
+
+void VS_FxBus::ClearDelay()
+{
+    delay_line_.Clear();
+    delay_lp_ = 0.f;
+}
+
+void VS_FxBus::ClearReverb()
+{
+    for (int side = 0; side < 2; side++)
+    {
+        for (int c = 0; c < COMBS; c++)
+        {
+            comb_[side][c].Clear();
+            comb_lp_[side][c] = 0.f;
+        }
+        for (int a = 0; a < ALLPASSES; a++)
+            allpass_[side][a].Clear();
+    }
+}
+
+/**
+ * audio-rate processing
+ */
+bool VS_FxBus::Active() const
+{
+    const uint8_t off = bypass_ | clearing_;
+    return ready_ && ((chorus_mix_ > 0.f && !(off & FX_CHORUS)) ||
+                      (delay_mix_ > 0.f && !(off & FX_DELAY)) ||
+                      (reverb_mix_ > 0.f && !(off & FX_REVERB)));
+}
+
+void VS_FxBus::ProcessBlock(float **out, size_t size)
+{
+    if (!ready_)
+        return;
+    const uint8_t off = bypass_ | clearing_;
+    for (size_t start = 0; start < size; start += MAX_BLOCK)
+    {
+        size_t n = size - start;
+        if (n > MAX_BLOCK)
+            n = MAX_BLOCK;
+        float *l = out[0] + start;
+        float *r = out[1] + start;
+        for (size_t i = 0; i < n; i++)
+            dry_[i] = 0.5f * (l[i] + r[i]);
+
+        // mixes are read once per block, the setters may run in between
+        if (chorus_mix_ > 0.f && !(off & FX_CHORUS))
+            ProcessChorus(l, r, n);
+        if (delay_mix_ > 0.f && !(off & FX_DELAY))
+            ProcessDelay(l, r, n);
+        if (reverb_mix_ > 0.f && !(off & FX_REVERB))
+            ProcessReverb(l, r, n);
+    }
+}
+
+/**
+ * two taps off one line, LFOs a quarter period apart for width
+ * the whole span the taps can reach is fetched in one run, then
+ * interpolated from internal RAM
+ */
+void VS_FxBus::ProcessChorus(float *l, float *r, size_t size)
+{
+    const float mix = chorus_mix_ * 0.5f;
+    ReadChorusTap(tmp_, size, chorus_phase_);
+    ReadChorusTap(tmp2_, size, chorus_phase_ + 0.25f);
+    for (size_t i = 0; i < size; i++)
+    {
+        l[i] = dry_[i] * (1.f - mix) + tmp_[i] * mix;
+        r[i] = dry_[i] * (1.f - mix) + tmp2_[i] * mix;
+    }
+    chorus_line_.Write(dry_, size);
+    chorus_phase_ += chorus_inc_ * size;
+    if (chorus_phase_ >= 1.f)
+        chorus_phase_ -= 1.f;
+}
+
+void VS_FxBus::ReadChorusTap(float *out, size_t size, float phase)
+{
+    const size_t d_max = (size_t)(chorus_center_ + chorus_depth_) + 1;
+    const size_t d_min = (size_t)(chorus_center_ - chorus_depth_);
+    const size_t span = size + d_max - d_min + 2;
+    chorus_line_.Read(chorus_window_, span, d_max + 1);
+
+    for (size_t i = 0; i < size; i++)
+    {
+        float p = phase + chorus_inc_ * i;
+        p -= (int)p;
+        // triangle LFO in [-1, 1]
+        float tri = 4.f * fabsf(p - 0.5f) - 1.f;
+        float d = chorus_center_ + chorus_depth_ * tri;
+        // position of sample i - d inside the window
+        float pos = (float)i + (float)(d_max + 1) - d;
+        size_t idx = (size_t)pos;
+        float frac = pos - (float)idx;
+        out[i] = chorus_window_[idx] + (chorus_window_[idx + 1] - chorus_window_[idx]) * frac;
+    }
+}
+
+/**
+ * mono feedback delay with a damped loop, returned to both sides
+ */
+void VS_FxBus::ProcessDelay(float *l, float *r, size_t size)
+{
+    const float mix = delay_mix_;
+    const float fb = delay_feedback_;
+    float lp = delay_lp_;
+    delay_line_.Read(tmp_, size, delay_samples_);
+    for (size_t i = 0; i < size; i++)
+    {
+        float y = tmp_[i];
+        lp += DELAY_DAMP * (y - lp);
+        tmp2_[i] = dry_[i] + fb * lp;
+        l[i] += mix * y;
+        r[i] += mix * y;
+    }
+    delay_line_.Write(tmp2_, size);
+    delay_lp_ = lp;
+}
+
+void VS_FxBus::ProcessReverb(float *l, float *r, size_t size)
+{
+    ProcessReverbSide(0, l, size);
+    ProcessReverbSide(1, r, size);
+}
+
+/**
+ * parallel damped combs into series allpasses (Freeverb), one side
+ * every line is longer than a block, so each is one read run + one write burst
+ */
+void VS_FxBus::ProcessReverbSide(int side, float *io, size_t size)
+{
+    float wet[MAX_BLOCK];
+    for (size_t i = 0; i < size; i++)
+        wet[i] = 0.f;
+
+    const float fb = reverb_feedback_;
+    for (int c = 0; c < COMBS; c++)
+    {
+        float lp = comb_lp_[side][c];
+        comb_[side][c].Read(tmp_, size, comb_len_[side][c]);
+        for (size_t i = 0; i < size; i++)
+        {
+            float y = tmp_[i];
+            lp = y * (1.f - REVERB_DAMP) + lp * REVERB_DAMP;
+            tmp2_[i] = dry_[i] * REVERB_INPUT_GAIN + lp * fb;
+            wet[i] += y;
+        }
+        comb_[side][c].Write(tmp2_, size);
+        comb_lp_[side][c] = lp;
+    }
+
+    for (int a = 0; a < ALLPASSES; a++)
+    {
+        allpass_[side][a].Read(tmp_, size, allpass_len_[side][a]);
+        for (size_t i = 0; i < size; i++)
+        {
+            float buf = tmp_[i];
+            tmp2_[i] = wet[i] + buf * 0.5f;
+            wet[i] = buf - wet[i];
+        }
+        allpass_[side][a].Write(tmp2_, size);
+    }
+
+    const float mix = reverb_mix_ * 3.f;
+    for (size_t i = 0; i < size; i++)
+        io[i] += mix * wet[i];
+}
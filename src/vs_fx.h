@@ -0,0 +1,106 @@
+#pragma once
+#include "DaisyDuino.h"
+#include "vs_delay.h"
+
+// memory reserved for the FX delay lines, in floats (2 MB of SDRAM)
+#define FX_ARENA_SIZE (512 * 1024)
+
+// delay memory zeroed per block for effects coming back from bypass, in
+// floats (8 KB: the reverb is clean again after about 10 blocks)
+#define FX_CLEAR_PER_BLOCK 2048
+
+// effect bits for VS_FxBus::SetBypass
+#define FX_CHORUS 0x01
+#define FX_DELAY 0x02
+#define FX_REVERB 0x04
+
+/**
+ * Master FX bus after the voice: chorus, feedback delay and a small
+ * Freeverb-style reverb, processed a block at a time on the stereo output.
+ * Every delay line is carved from one arena at Init (no heap), and each
+ * effect costs nothing while its mix is 0.
+ */
+class VS_FxBus
+{
+public:
+  // false if the lines do not fit the arena, the bus then stays bypassed
+  bool Init(float sample_rate, float *arena, size_t arena_size);
+  // once per audio block, whether or not ProcessBlock runs
+  void BeginBlock();
+  // in place on out[0] / out[1]
+  void ProcessBlock(float **out, size_t size);
+
+  // called at control-rate from outside, all 0..1
+  void SetChorusMix(float mix);
+  void SetDelayMix(float mix);
+  void SetDelayTime(float seconds);
+  void SetDelayFeedback(float feedback);
+  void SetReverbMix(float mix);
+  void SetReverbSize(float size);
+  // effects in `mask` are skipped whatever their mix (quality shedding);
+  // one coming back stays off until BeginBlock has cleared its lines
+  void SetBypass(uint8_t mask);
+  uint8_t Bypass() const { return bypass_; }
+  // false when every effect is off or shed: the output is the mono input
+  bool Active() const;
+
+  // memory budget, in bytes
+  size_t MemoryUsed() const { return arena_.Used() * sizeof(float); }
+  size_t MemoryBudget() const { return arena_.Capacity() * sizeof(float); }
+  // Init fitted every line
+  bool Ready() const { return ready_; }
+
+private:
+  static const size_t MAX_BLOCK = 64;
+  VS_Arena arena_;
+  float sample_rate_;
+  bool ready_ = false;
+  uint8_t bypass_ = 0;
+  // effects whose lines BeginBlock is still clearing, and where it is
+  uint8_t clearing_ = 0;
+  int clear_line_ = 0;
+  size_t clear_pos_ = 0;
+  VS_DelayLine *Line(uint8_t effect, int i);
+  void ResetState(uint8_t effect);
+  float dry_[MAX_BLOCK];
+  float tmp_[MAX_BLOCK], tmp2_[MAX_BLOCK];
+
+  /* CHORUS */
+  float const CHORUS_CENTER_S = 0.012f;
+  float const CHORUS_DEPTH_S = 0.003f;
+  float const CHORUS_RATE = 0.3f;
+  VS_DelayLine chorus_line_;
+  float chorus_mix_ = 0.f;
+  float chorus_center_, chorus_depth_;
+  float chorus_phase_ = 0.f, chorus_inc_;
+  // covers one block plus the modulation span at up to 96 kHz
+  float chorus_window_[MAX_BLOCK + 800];
+  void ClearChorus();
+  void ProcessChorus(float *l, float *r, size_t size);
+  void ReadChorusTap(float *out, size_t size, float phase);
+
+  /* DELAY */
+  float const DELAY_MAX_S = 2.f;
+  float const DELAY_DAMP = 0.35f;
+  VS_DelayLine delay_line_;
+  float delay_mix_ = 0.f;
+  size_t delay_samples_;
+  float delay_feedback_ = 0.4f;
+  float delay_lp_ = 0.f;
+  void ClearDelay();
+  void ProcessDelay(float *l, float *r, size_t size);
+
+  /* REVERB */
+  static const int COMBS = 4;
+  static const int ALLPASSES = 2;
+  VS_DelayLine comb_[2][COMBS], allpass_[2][ALLPASSES];
+  size_t comb_len_[2][COMBS], allpass_len_[2][ALLPASSES];
+  float comb_lp_[2][COMBS];
+  float reverb_mix_ = 0.f;
+  float reverb_feedback_ = 0.84f;
+  float const REVERB_DAMP = 0.2f;
+  float const REVERB_INPUT_GAIN = 0.015f;
+  void ClearReverb();
+  void ProcessReverb(float *l, float *r, size_t size);
+  void ProcessReverbSide(int side, float *io, size_t size);
+};
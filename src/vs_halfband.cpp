@@ -0,0 +1,44 @@
+#include "vs_halfband.h"
+
+void VS_Decimator::Init()
+{
+    const size_t n = sizeof(coef_) / sizeof(coef_[0]);
+    float sum = 0.f;
+    for (size_t i = 0; i < n; i++)
+    {
+        const float k = (float)(2 * i + 1);
+        float sinc = sinf(PI_F * k * 0.5f) / (PI_F * k);
+        // Blackman over the full length, evaluated at HALF + k
+        float x = (HALF + k) / (HALFBAND_TAPS - 1);
+        float w = 0.42f - 0.5f * cosf(TWOPI_F * x) + 0.08f * cosf(2.f * TWOPI_F * x);
+        coef_[i] = sinc * w;
+        sum += coef_[i];
+    }
+    // unity at DC: 0.5 + 2 * sum(odd taps)
+    for (size_t i = 0; i < n; i++)
+        coef_[i] *= 0.25f / sum;
+    memset(buf_, 0, sizeof(buf_));
+}
+
+void VS_Decimator::Process(const float *in, float *out, size_t n)
+{
+    const size_t hist = HALFBAND_TAPS - 1;
+    const size_t taps = sizeof(coef_) / sizeof(coef_[0]);
+    while (n > 0)
+    {
+        size_t m = n < HALFBAND_CHUNK ? n : HALFBAND_CHUNK;
+        memcpy(buf_ + hist, in, 2 * m * sizeof(float));
+        for (size_t j = 0; j < m; j++)
+        {
+            const float *c = buf_ + 2 * j + HALF;
+            float acc = 0.5f * c[0];
+            for (size_t i = 0; i < taps; i++)
+                acc += coef_[i] * (c[-(int)(2 * i + 1)] + c[2 * i + 1]);
+            out[j] = acc;
+        }
+        memmove(buf_, buf_ + 2 * m, hist * sizeof(float));
+        in += 2 * m;
+        out += m;
+        n -= m;
+    }
+}
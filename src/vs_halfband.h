@@ -0,0 +1,27 @@
+#pragma once
+#include "DaisyDuino.h"
+
+// odd, with (TAPS - 1) / 2 odd so the outermost taps are not zero
+#define HALFBAND_TAPS 47
+// outputs per internal pass
+#define HALFBAND_CHUNK 64
+
+/**
+ * 2:1 decimator for an oversampled voice: linear-phase halfband FIR
+ * (Blackman-windowed sinc), every other tap is zero so only the odd taps
+ * and the centre are computed. Flat (0.1 dB) to ~0.4 of the output rate,
+ * -60 dB or better from ~0.62: what aliases lands above 18 kHz at 48 kHz.
+ */
+class VS_Decimator
+{
+public:
+  void Init();
+  // 2 * n samples in, n out
+  void Process(const float *in, float *out, size_t n);
+
+private:
+  static const size_t HALF = (HALFBAND_TAPS - 1) / 2;
+  // taps 1, 3, ... HALF around the centre (the centre one is 0.5)
+  float coef_[(HALF + 1) / 2];
+  float buf_[HALFBAND_TAPS - 1 + 2 * HALFBAND_CHUNK];
+};
@@ -2,92 +2,172 @@
 
 void VS_Lfo::Init(float sample_rate)
 {
+    sr_recip_ = 1.f / sample_rate;
+    fm_max_ = VS_RateLimits::For(sample_rate).max_fm_freq;
     osc_.Init(sample_rate);
-    smooth_rnd_.Init(sample_rate);
-    stepped_rnd_.Init(sample_rate);
-    white_noise_.Init();
-    noise_color_.Init(sample_rate);
-    noise_color_.SetFreq(color_freq_);
-    low_noise_2_.Init(sample_rate);
-    low_noise_2_.SetFreq(color_freq_);
+    SetSeed(RND_SEED_DEFAULT);
+
+    // one-pole lowpass used twice by the colored noise (same curve as DaisySP Tone)
+    float b = 2.0f - cosf(TWOPI_F * color_freq_ * sr_recip_);
+    color_c2_ = b - sqrtf(b * b - 1.0f);
+    color_c1_ = 1.0f - color_c2_;
 }
 
-float VS_Lfo::Process(float note_freq)
+void VS_Lfo::SetSeed(uint32_t seed)
 {
-    float freq = lfo_rate_;
-    float samp = 0;
+    rnd_.Init(seed);
+    rnd_phase_ = 0.f;
+    rnd_held_ = rnd_.NextBipolar();
+    rnd_from_ = 0.f;
+    rnd_interval_ = rnd_held_;
+    color_lp_ = color_lp2_ = 0.f;
+}
+
+/**
+ * block processing: the mode is resolved once per block, each branch is a
+ * tight loop over the buffer
+ */
+void VS_Lfo::ProcessBlock(float *out, size_t size, float note_freq)
+{
+    float freq;
     switch (type_)
     {
     case LFO_TYPE_SIN:
-        samp = osc_.Process();
-        break;
     case LFO_TYPE_TRI:
-        samp = osc_.Process();
+        for (size_t i = 0; i < size; i++)
+            out[i] = osc_.Process();
         break;
     case LFO_TYPE_FM:
         freq = note_freq * lfo_rate_;
-        if (freq > 20000.f)
-            freq = 20000.f;
+        if (freq > fm_max_)
+            freq = fm_max_;
         osc_.SetFreq(freq);
-        samp = osc_.Process();
+        for (size_t i = 0; i < size; i++)
+            out[i] = osc_.Process();
         break;
     case LFO_TYPE_STEPPED:
-        samp = stepped_rnd_.Process();
+        ProcessSteppedBlock(out, size);
         break;
     case LFO_TYPE_SMOOTH:
-        samp = smooth_rnd_.Process();
+        ProcessSmoothBlock(out, size);
         break;
     case LFO_TYPE_NOISE:
-        samp = ProcessColoredNoiseSample();
+        ProcessColoredNoiseBlock(out, size);
         break;
     default:
+        for (size_t i = 0; i < size; i++)
+            out[i] = 0.f;
         break;
     }
-    return samp;
 }
 
-float VS_Lfo::ProcessColoredNoiseSample()
+/**
+ * sample & hold: a new random value on every clock tick
+ */
+void VS_Lfo::ProcessSteppedBlock(float *out, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        rnd_phase_ += rnd_inc_;
+        if (rnd_phase_ >= 1.f)
+        {
+            rnd_phase_ -= 1.f;
+            rnd_held_ = rnd_.NextBipolar();
+        }
+        out[i] = rnd_held_;
+    }
+}
+
+/**
+ * smooth random: smoothstep between consecutive random targets
+ */
+void VS_Lfo::ProcessSmoothBlock(float *out, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        rnd_phase_ += rnd_inc_;
+        if (rnd_phase_ >= 1.f)
+        {
+            rnd_phase_ -= 1.f;
+            rnd_from_ += rnd_interval_;
+            rnd_interval_ = rnd_.NextBipolar() - rnd_from_;
+        }
+        float t = rnd_phase_ * rnd_phase_ * (3.f - 2.f * rnd_phase_);
+        out[i] = rnd_from_ + rnd_interval_ * t;
+    }
+}
+
+/**
+ * white noise split into a doubly low-passed part and a high-passed part,
+ * the knob tilts between the two
+ */
+void VS_Lfo::ProcessColoredNoiseBlock(float *out, size_t size)
 {
     gain_low_ = max(0.f, 1 - lfo_rate_);
     gain_high_ = max(0.f, 1 + lfo_rate_ * 0.5f);
-    float x = white_noise_.Process();
-    float lp = noise_color_.Process(x);
-    float lp2 = low_noise_2_.Process(lp);
-    float hp = x - lp;
-    return 0.5f * (gain_low_ * lp2 + gain_high_ * hp);
+    const float gl = 0.5f * gain_low_;
+    const float gh = 0.5f * gain_high_;
+    const float c1 = color_c1_, c2 = color_c2_;
+    float lp = color_lp_, lp2 = color_lp2_;
+
+    rnd_.FillBipolar(out, size);
+    for (size_t i = 0; i < size; i++)
+    {
+        float x = out[i];
+        lp = c1 * x + c2 * lp;
+        lp2 = c1 * lp + c2 * lp2;
+        out[i] = gl * lp2 + gh * (x - lp);
+    }
+    color_lp_ = lp;
+    color_lp2_ = lp2;
 }
 
-void VS_Lfo::UpdateParamsFromHardware(const SynthHardware &hw)
+void VS_Lfo::SetParams(const SynthParams &p)
 {
-    float lfo_knob = hw.GetPot(POT_LFO_RATE);
-    type_ = hw.GetLfoType();
+    SetRate(p.lfo_type, RateFor(p.lfo_type, p.lfo_rate));
+}
+
+float VS_Lfo::RateFor(LfoType type, float knob) const
+{
+    switch (type)
+    {
+    case LFO_TYPE_FM:
+        return FM_RATIO_MIN * powf(FM_RATIO_MAX / FM_RATIO_MIN, knob);
+    case LFO_TYPE_STEPPED:
+    case LFO_TYPE_SMOOTH:
+        return RND_F_MIN * powf(RND_F_MAX / RND_F_MIN, knob * knob);
+    case LFO_TYPE_NOISE:
+    {
+        float tilt = 2.f * knob - 1.f;
+        return tilt * tilt * tilt;
+    }
+    default:
+        return LFO_F_MIN * powf(LFO_F_MAX / LFO_F_MIN, knob);
+    }
+}
+
+void VS_Lfo::SetRate(LfoType type, float rate)
+{
+    type_ = type;
+    lfo_rate_ = rate;
     switch (type_)
     {
     case LFO_TYPE_SIN:
         osc_.SetWaveform(Oscillator::WAVE_SIN);
-        lfo_rate_ = LFO_F_MIN * powf(LFO_F_MAX / LFO_F_MIN, lfo_knob);
         osc_.SetFreq(lfo_rate_);
         break;
     case LFO_TYPE_TRI:
         osc_.SetWaveform(Oscillator::WAVE_TRI);
-        lfo_rate_ = LFO_F_MIN * powf(LFO_F_MAX / LFO_F_MIN, lfo_knob);
         osc_.SetFreq(lfo_rate_);
         break;
     case LFO_TYPE_FM:
         osc_.SetWaveform(Oscillator::WAVE_SIN);
-        lfo_rate_ = (FM_RATIO_MIN * powf(FM_RATIO_MAX / FM_RATIO_MIN, lfo_knob));
         break;
     case LFO_TYPE_STEPPED:
-        lfo_rate_ = RND_F_MIN * powf(RND_F_MAX / RND_F_MIN, lfo_knob * lfo_knob);
-        stepped_rnd_.SetFreq(lfo_rate_);
-        break;
     case LFO_TYPE_SMOOTH:
-        lfo_rate_ = RND_F_MIN * powf(RND_F_MAX / RND_F_MIN, lfo_knob * lfo_knob);
-        smooth_rnd_.SetFreq(lfo_rate_);
+        rnd_inc_ = lfo_rate_ * sr_recip_;
         break;
     case LFO_TYPE_NOISE:
-        lfo_rate_ = 2.f * lfo_knob - 1.f;
-        lfo_rate_ = lfo_rate_ * lfo_rate_ * lfo_rate_;
         break;
     }
 }
@@ -1,19 +1,33 @@
 // Lfo.h
 #pragma once
 #include "DaisyDuino.h"
-#include "SynthHardware.h"
+#include "SynthParams.h"
+#include "vs_random.h"
+#include "vs_rate.h"
 
 class VS_Lfo
 {
 public:
   void Init(float sample_rate);
-  float Process(float note_freq);
-  void UpdateParamsFromHardware(const SynthHardware &hw);
+  // fills `size` samples; note_freq only matters in FM mode
+  void ProcessBlock(float *out, size_t size, float note_freq);
+  void SetParams(const SynthParams &p);
+  // the knob curve alone: rate in the unit `type` runs on (Hz, FM ratio
+  // or noise tilt)
+  float RateFor(LfoType type, float knob) const;
+  // type and an already mapped rate, no powf
+  void SetRate(LfoType type, float rate);
+  // reseeds the random modes, for reproducible renders
+  void SetSeed(uint32_t seed);
+
+  LfoType GetType() const { return type_; }
 
 private:
   /* GLOBAL LFO CONTROLS */
   LfoType type_;
   float lfo_rate_;
+  float sr_recip_;
+  float fm_max_ = 20000.f;
 
   /* SIGNAL LFO */
   Oscillator osc_;
@@ -25,13 +39,18 @@ private:
   /* RANDOM LFO */
   float const RND_F_MAX = 50;
   float const RND_F_MIN = 1.f;
-  SmoothRandomGenerator smooth_rnd_;
-  ClockedNoise stepped_rnd_;
+  uint32_t const RND_SEED_DEFAULT = 0x5EED1F0u;
+  VS_Random rnd_;
+  float rnd_phase_ = 0.f, rnd_inc_ = 0.f;
+  float rnd_held_ = 0.f;
+  float rnd_from_ = 0.f, rnd_interval_ = 0.f;
+  void ProcessSteppedBlock(float *out, size_t size);
+  void ProcessSmoothBlock(float *out, size_t size);
 
   /* NOISE */
-  Tone noise_color_, low_noise_2_;
-  WhiteNoise white_noise_;
   float color_freq_ = 200.f;
+  float color_c1_, color_c2_;
+  float color_lp_ = 0.f, color_lp2_ = 0.f;
   float gain_high_, gain_low_;
-  float ProcessColoredNoiseSample();
+  void ProcessColoredNoiseBlock(float *out, size_t size);
 };
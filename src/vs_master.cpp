@@ -0,0 +1,165 @@
+#include "vs_master.h"
+
+/**
+ * pass kernels: fixed trip counts and restrict-qualified buffers, so each
+ * loop vectorises on its own
+ */
+// acc[j] = centre[j] + sum of c[i] * (a[j - i] + b[j + i])
+static inline void Halfband(float *__restrict acc, const float *__restrict centre,
+                            const float *__restrict a, const float *__restrict b,
+                            const float *__restrict c)
+{
+    for (size_t j = 0; j < MASTER_CHUNK; j++)
+    {
+        float sum = centre[j];
+        for (size_t i = 0; i < (MASTER_TAPS + 1) / 4; i++)
+            sum += c[i] * (a[j - i] + b[j + i]);
+        acc[j] = sum;
+    }
+}
+
+// x (27 + x^2) / (27 + 9 x^2) on x clamped to [-3, 3], branch-free
+static inline void SoftClip(float *__restrict x)
+{
+    for (size_t j = 0; j < MASTER_CHUNK; j++)
+    {
+        float v = 0.5f * (fabsf(x[j] + 3.f) - fabsf(x[j] - 3.f));
+        float v2 = v * v;
+        x[j] = v * (27.f + v2) / (27.f + 9.f * v2);
+    }
+}
+
+void VS_Master::Init(float sample_rate)
+{
+    // halfband taps, as in VS_Decimator::Init
+    float sum = 0.f;
+    for (size_t i = 0; i < COEFS; i++)
+    {
+        const float k = (float)(2 * i + 1);
+        float sinc = sinf(PI_F * k * 0.5f) / (PI_F * k);
+        float x = (HALF + k) / (MASTER_TAPS - 1);
+        float w = 0.42f - 0.5f * cosf(TWOPI_F * x) + 0.08f * cosf(2.f * TWOPI_F * x);
+        coef_[i] = sinc * w;
+        sum += coef_[i];
+    }
+    for (size_t i = 0; i < COEFS; i++)
+    {
+        coef_[i] *= 0.25f / sum;
+        // zero-stuffing halves the level, the interpolator makes it up
+        up_coef_[i] = 2.f * coef_[i];
+    }
+    memset(zero_, 0, sizeof(zero_));
+
+    dc_coeff_ = 1.f - TWOPI_F * MASTER_DC_HZ / sample_rate;
+    ResetChannel(ch_[0]);
+    ResetChannel(ch_[1]);
+    stereo_ = false;
+}
+
+void VS_Master::ResetChannel(Channel &ch)
+{
+    ch.x1 = ch.y1 = 0.f;
+    memset(ch.in, 0, sizeof(ch.in));
+    memset(ch.even, 0, sizeof(ch.even));
+    memset(ch.odd, 0, sizeof(ch.odd));
+}
+
+void VS_Master::ProcessMono(const float *in, float *out_l, float *out_r, size_t size)
+{
+    stereo_ = false;
+    for (size_t start = 0; start < size; start += MASTER_CHUNK)
+    {
+        size_t n = size - start;
+        if (n > MASTER_CHUNK)
+            n = MASTER_CHUNK;
+        Pass(ch_[0], in + start, out_l + start, out_r + start, n);
+    }
+}
+
+void VS_Master::ProcessStereo(float *l, float *r, size_t size)
+{
+    // the right channel picks up where the mono path left the left one
+    if (!stereo_)
+        ch_[1] = ch_[0];
+    stereo_ = true;
+    for (size_t start = 0; start < size; start += MASTER_CHUNK)
+    {
+        size_t n = size - start;
+        if (n > MASTER_CHUNK)
+            n = MASTER_CHUNK;
+        Pass(ch_[0], l + start, l + start, nullptr, n);
+        Pass(ch_[1], r + start, r + start, nullptr, n);
+    }
+}
+
+void VS_Master::Pass(Channel &ch, const float *in, float *out_a, float *out_b, size_t n)
+{
+    // the filter and clip loops always run a whole pass; past `n` they
+    // work on stale history, which is never output
+    const size_t in_keep = 2 * COEFS;
+    const size_t os_keep = 2 * COEFS - 1;
+    float *x = ch.in + in_keep;
+    float *even = ch.even + os_keep;
+    float *odd = ch.odd + os_keep;
+
+    // DC blocker, the only recursion
+    float x1 = ch.x1, y1 = ch.y1;
+    for (size_t j = 0; j < n; j++)
+    {
+        float y = in[j] - x1 + dc_coeff_ * y1;
+        x1 = in[j];
+        y1 = y;
+        x[j] = y * drive_;
+    }
+    ch.x1 = x1;
+    ch.y1 = y1;
+
+    if (!oversampled_)
+    {
+        // same curve at the codec rate, as late as the 2x path; the
+        // halfband history is left as it was
+        memcpy(tmp_, x - HALF, MASTER_CHUNK * sizeof(float));
+        memmove(ch.in, ch.in + n, in_keep * sizeof(float));
+        SoftClip(tmp_);
+        Gain(tmp_, out_a, out_b, n);
+        return;
+    }
+
+    // 2x up: the even phase is the halfway point, from the odd taps on
+    // both sides, the odd phase the input delayed by COEFS - 1
+    Halfband(even, zero_, x - COEFS, x - COEFS + 1, up_coef_);
+    memcpy(odd, x - (COEFS - 1), MASTER_CHUNK * sizeof(float));
+    memmove(ch.in, ch.in + n, in_keep * sizeof(float));
+
+    SoftClip(even);
+    SoftClip(odd);
+
+    // 2x down: the centre tap falls on the odd phase, the others on the even
+    for (size_t j = 0; j < MASTER_CHUNK; j++)
+        tmp2_[j] = 0.5f * ch.odd[j + COEFS - 1];
+    Halfband(tmp_, tmp2_, ch.even + COEFS - 1, ch.even + COEFS, coef_);
+    memmove(ch.even, ch.even + n, os_keep * sizeof(float));
+    memmove(ch.odd, ch.odd + n, os_keep * sizeof(float));
+
+    Gain(tmp_, out_a, out_b, n);
+}
+
+// output gain, mono goes to both channels in the same pass
+void VS_Master::Gain(const float *in, float *out_a, float *out_b, size_t n)
+{
+    const float g = out_gain_;
+    if (out_b)
+    {
+        for (size_t j = 0; j < n; j++)
+        {
+            float v = in[j] * g;
+            out_a[j] = v;
+            out_b[j] = v;
+        }
+    }
+    else
+    {
+        for (size_t j = 0; j < n; j++)
+            out_a[j] = in[j] * g;
+    }
+}
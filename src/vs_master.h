@@ -0,0 +1,84 @@
+#pragma once
+#include "DaisyDuino.h"
+
+// samples per internal pass, the loops run over whole passes
+#define MASTER_CHUNK 32
+// halfband for the 2x clipper, odd with (TAPS - 1) / 2 odd
+#define MASTER_TAPS 31
+// DC blocker corner, Hz
+#define MASTER_DC_HZ 10.f
+
+/**
+ * Master stage, last thing before the codec, one block at a time:
+ *   DC blocker -> drive -> 2x oversampled soft clip -> output gain
+ *
+ * The one-pole high-pass takes out the offset the asymmetric shapers and
+ * the folded waveforms leave, so the clipper bends both halves of the
+ * wave alike. The clipper is the voice's old rational curve,
+ * x (27 + x^2) / (27 + 9 x^2) on [-3, 3], run at twice the rate between
+ * a halfband interpolator and decimator (same design as VS_Decimator,
+ * shorter), so the harmonics it adds above Nyquist are filtered instead
+ * of folding back. Every pass is a set of straight, branch-free loops
+ * over MASTER_CHUNK samples, which the compiler vectorises; only the DC
+ * blocker's recursion stays scalar.
+ *
+ * The 2x clip costs several times the rest of the stage, so the lower
+ * quality tiers run the same curve at the codec rate instead, read
+ * Latency() samples back so the output does not jump in time when the
+ * path changes.
+ *
+ * Mono in (the voice, FX off) is processed once and stored to both
+ * outputs in the same loop; stereo (after the FX) runs per channel.
+ */
+class VS_Master
+{
+public:
+  void Init(float sample_rate);
+
+  // into the clipper; 1 = the voice's own level
+  void SetDrive(float gain) { drive_ = gain; }
+  // after the clipper
+  void SetOutputGain(float gain) { out_gain_ = gain; }
+  // true (default) = 2x clip, false = clip at the codec rate
+  void SetOversampled(bool on) { oversampled_ = on; }
+
+  // `in` may be out_l
+  void ProcessMono(const float *in, float *out_l, float *out_r, size_t size);
+  // in place
+  void ProcessStereo(float *l, float *r, size_t size);
+
+  // delay through the halfband pair, in samples
+  static size_t Latency() { return (MASTER_TAPS - 1) / 2; }
+
+private:
+  static const size_t HALF = (MASTER_TAPS - 1) / 2;
+  static const size_t COEFS = (HALF + 1) / 2;
+
+  // the 2x signal is kept as its two phases, each in its own buffer, so
+  // every filter loop reads with stride 1; history first, then one pass
+  struct Channel
+  {
+    // DC blocker
+    float x1, y1;
+    // input, after the DC blocker and the drive
+    float in[2 * COEFS + MASTER_CHUNK];
+    // clipped halfway points (even phase) and input samples (odd phase)
+    float even[2 * COEFS - 1 + MASTER_CHUNK];
+    float odd[2 * COEFS - 1 + MASTER_CHUNK];
+  };
+
+  void ResetChannel(Channel &ch);
+  // one pass of n <= MASTER_CHUNK samples, to out_b as well if not null
+  void Pass(Channel &ch, const float *in, float *out_a, float *out_b, size_t n);
+  void Gain(const float *in, float *out_a, float *out_b, size_t n);
+
+  float coef_[COEFS]; // odd taps 1, 3, ... HALF, centre is 0.5
+  float up_coef_[COEFS];
+  float dc_coeff_ = 0.999f;
+  float drive_ = 1.f, out_gain_ = 1.f;
+  Channel ch_[2];
+  bool stereo_ = false;
+  bool oversampled_ = true;
+  float tmp_[MASTER_CHUNK], tmp2_[MASTER_CHUNK];
+  float zero_[MASTER_CHUNK];
+};
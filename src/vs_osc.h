@@ -1,24 +1,122 @@
 #pragma once
 #include "DaisyDuino.h"
-#include "SynthHardware.h"
+#include "SynthParams.h"
+#include "vs_common.h"
+#include "vs_sample.h"
+#include "vs_rate.h"
+
+#ifndef OSC_BANK
+#define OSC_BANK 2
+#endif
 
 /**
  * waveshaping helpers
  */
-static inline float SoftClipCubic(float x);
-static inline float SatOneOver(float x);
-static inline float AsymBend(float x);
-static inline float WaveShaper4(float x, float shape);
-static inline float WaveFold(float smp, float amount);
+static VS_INLINE float SoftClipCubic(float x)
+{
+    // good sounding, cheap
+    // clamp to avoid blowups if upstream drives too hard
+    if (x > 1.5f)
+        x = 1.5f;
+    if (x < -1.5f)
+        x = -1.5f;
+    return x - (x * x * x) * 0.3333333f;
+}
+
+static VS_INLINE float SatOneOver(float x)
+{
+    // x/(1+|x|): cheap saturator
+    float ax = fabsf(x);
+    return x / (1.0f + ax);
+}
+
+static VS_INLINE float AsymBend(float x)
+{
+    // simple asymmetric bend:
+    // push positives a bit harder than negatives
+    float pos = SoftClipCubic(x * 1.2f);
+    float neg = SoftClipCubic(x * 0.9f);
+    return (x >= 0.0f) ? pos : neg;
+}
+
+static VS_INLINE float Mix(float a, float b, float t)
+{
+    return a + (b - a) * t;
+}
+
+// shape in [0;1]
+static VS_INLINE float WaveShaper4(float x, float shape)
+{
+    // 0..3
+    float s = shape * 3.0f;
+    int i = (int)s;
+    float f = s - (float)i;
+
+    float y0, y1;
+    switch (i)
+    {
+    default:
+    case 0:
+        y0 = x;
+        y1 = SoftClipCubic(x);
+        break;
+    case 1:
+        y0 = SoftClipCubic(x);
+        y1 = SatOneOver(x);
+        break;
+    case 2:
+        y0 = SatOneOver(x);
+        y1 = AsymBend(x);
+        break;
+    }
+    return Mix(y0, y1, f);
+}
+
+// amount in [0;1]
+static VS_INLINE float WaveFold(float smp, float amount)
+{
+    const float drive = 1.0f + amount * 12.0f;
+    smp *= drive;
+    // Fold into [-1, 1] using a triangle-wave folding map
+    float y = fmodf(smp + 1.0f, 4.0f);
+    if (y < 0.0f)
+        y += 4.0f;
+    y = (y < 2.0f) ? (y - 1.0f) : (3.0f - y);
+    return y;
+}
 
 class VS_Osc
 {
 public:
     void Init(float sample_rate);
     float Process(float frequency, float env, float lfo);
+    // one mode, resolved at compile time (used by the voice chain);
+    // Sampled plays the bank 1 stream in place of the synthetic shapes,
+    // for the caller to pick once per block (see Sampled())
+    template <OscType Type, int Bank = OSC_BANK, bool Sampled = false>
+    inline float ProcessAs(float frequency, float env, float lfo);
 
-    // called at control-rate from outside
-    void UpdateParamsFromHardware(const SynthHardware &hw);
+    // once per block, from the voice's parameter snapshot: shape and mod
+    // depths, plus the setup of the mode the block renders, resolved at
+    // compile time like ProcessAs
+    template <OscType Type, int Bank = OSC_BANK>
+    inline void Prepare(float param, float env_depth, float lfo_depth);
+
+    // called at control-rate from outside, for use on its own (Process);
+    // the voice only sets the type and Prepares every block
+    void SetParams(const SynthParams &p);
+    void SetType(OscType type) { osc_type_ = type; }
+
+    OscType GetType() const { return osc_type_; }
+
+    /* bank 1 sample playback */
+    // nullptr (default) keeps the synthetic placeholders
+    void SetStream(VS_SampleStream *stream) { stream_ = stream; }
+    // SAW and TRI play the stream, SQ stays synthetic
+    bool Sampled() const { return stream_ != nullptr; }
+    // note-on (audio side): picks the zone and starts it from its
+    // resident attack at once
+    void Trigger(float frequency);
 
 private:
     /* VCO */
@@ -28,6 +126,7 @@ private:
     float osc_param_;
     float env_osc_depth_, lfo_osc_depth_;
     float pw_amt_;
+    float max_freq_ = 18000.f;
     float ProcessPair2Anlg(float freq, float env, float lfo);
     float ProcessPair2Dgtl(float freq, float env, float lfo);
     void UpdatePair2Anlg();
@@ -36,5 +135,154 @@ private:
     float ProcessPair3Dgtl(float freq, float env, float lfo);
     void UpdatePair3Anlg();
     void UpdatePair3Dgtl();
+    void UpdateSquare();
     float ProcessSquare(float freq, float env, float lfo);
+    VS_SampleStream *stream_ = nullptr;
+    float ProcessSample(float freq, float env, float lfo);
 };
+
+/**
+ * per-sample kernels, inline so that each ProcessAs compiles into the
+ * voice's sample loop
+ */
+VS_INLINE float VS_Osc::ProcessSquare(float freq, float env, float lfo)
+{
+    osc_.SetSyncFreq(freq);
+    float pwm_amt = pw_amt_ + env * env_osc_depth_ + lfo * lfo_osc_depth_;
+    pwm_amt = fclamp(pwm_amt, 0.f, 1.f);
+    osc_.SetPW(pwm_amt);
+    return osc_.Process();
+}
+
+/**
+ * tri-saw-notch wave with analog-style FM
+ * the shape is determined by the shape knob (control loop)
+ * in the update loop, we compute the FM based on the LFO and ENV
+ */
+VS_INLINE float VS_Osc::ProcessPair2Dgtl(float freq, float env, float lfo)
+{
+    const float maxModOct = 5.f;
+    const float maxSemi = 38.0f;
+    float env_oct = (env * env_osc_depth_ * maxSemi) / 12.f;
+    float lfo_oct = lfo_osc_depth_ * maxModOct * lfo;
+    float frequency = freq * exp2f(env_oct + lfo_oct);
+    saw_osc_.SetFreq(frequency);
+    return saw_osc_.Process();
+}
+
+/**
+ * Triangle Oscillator
+ * Adds hard sync when CW turn of shape knob (or equivalent LFO or ENV mod)
+ * Adds waveshaping + wavefolding in the reciprocal CCW
+ */
+VS_INLINE float VS_Osc::ProcessPair2Anlg(float freq, float env, float lfo)
+{
+    osc_.SetFreq(freq);
+    float mod_step = osc_param_ + env * env_osc_depth_ + lfo * lfo_osc_depth_;
+    mod_step = fclamp(mod_step, -1.f, 1.f);
+
+    const float maxModOct = 3.3f;
+    float total_oct = mod_step * maxModOct;
+    total_oct = fclamp(total_oct, 0.f, maxModOct);
+    const float ratio = exp2f(total_oct);
+    osc_.SetSyncFreq(freq * ratio);
+
+    float smp = osc_.Process();
+
+    float total_fold_amt = -mod_step;
+    total_fold_amt = fclamp(total_fold_amt, 0.f, 1.f);
+    return WaveFold(smp, total_fold_amt);
+}
+
+/**
+ * Sawtoth oscillator with two types of waveshaping when turning the shape CW or CCW
+ * Inspired by plaits green moode 2
+ */
+VS_INLINE float VS_Osc::ProcessPair3Anlg(float freq, float env, float lfo)
+{
+    float x = osc_param_;
+    x += env * env_osc_depth_;
+    x += lfo * lfo_osc_depth_;
+
+    float half = (x > 0.0f) ? x : 0.0f;
+    float full = fabsf(x);
+    if (half > 1.0f)
+        half = 1.0f;
+    if (full > 1.0f)
+        full = 1.0f;
+
+    float harmonics = 0.5f + 0.5f * half;
+    float timbre = full;
+    float morph = 1.0f - 0.5f * full;
+
+    saw_osc_.SetFreq(freq);
+    saw_osc_.SetPW(morph);
+    float s = saw_osc_.Process();
+
+    float shaped = WaveShaper4(s, harmonics);
+    float folded = WaveFold(shaped, timbre);
+
+    return folded;
+}
+
+/**
+ * TRI wave with crude analog-style FM
+ * The shape know does the fine tune
+ */
+VS_INLINE float VS_Osc::ProcessPair3Dgtl(float freq, float env, float lfo)
+{
+    const float maxModOct = 5.f;
+    const float maxSemi = 38.0f;
+    float env_oct = (env * env_osc_depth_ * maxSemi) / 12.f;
+    float lfo_oct = lfo_osc_depth_ * maxModOct * lfo;
+    float frequency = freq * exp2f(env_oct + lfo_oct + osc_param_);
+    frequency = fclamp(frequency, 20, max_freq_);
+    osc_.SetFreq(frequency);
+    osc_.SetSyncFreq(frequency);
+    return osc_.Process();
+}
+
+/**
+ * Sample playback (bank 1), looped in the middle position, one-shot on top
+ * Same pitch modulation as the TRI above, the shape knob does the fine tune
+ */
+VS_INLINE float VS_Osc::ProcessSample(float freq, float env, float lfo)
+{
+    const float maxModOct = 5.f;
+    const float maxSemi = 38.0f;
+    float env_oct = (env * env_osc_depth_ * maxSemi) / 12.f;
+    float lfo_oct = lfo_osc_depth_ * maxModOct * lfo;
+    return stream_->Process(freq * exp2f(env_oct + lfo_oct + osc_param_));
+}
+
+template <OscType Type, int Bank, bool Sampled>
+VS_INLINE float VS_Osc::ProcessAs(float frequency, float env, float lfo)
+{
+    if (Type == OSC_TYPE_SQ)
+        return ProcessSquare(frequency, env, lfo);
+    if (Bank == 1 && Sampled)
+        return ProcessSample(frequency, env, lfo);
+    if (Type == OSC_TYPE_TRI)
+        return (Bank == 2) ? ProcessPair2Dgtl(frequency, env, lfo)
+                           : ProcessPair3Dgtl(frequency, env, lfo);
+    return (Bank == 2) ? ProcessPair2Anlg(frequency, env, lfo)
+                       : ProcessPair3Anlg(frequency, env, lfo);
+}
+
+template <OscType Type, int Bank>
+inline void VS_Osc::Prepare(float param, float env_depth, float lfo_depth)
+{
+    osc_param_ = param;
+    env_osc_depth_ = env_depth;
+    lfo_osc_depth_ = lfo_depth;
+    if (Type == OSC_TYPE_SQ)
+        UpdateSquare();
+    else if (Type == OSC_TYPE_TRI && Bank == 2)
+        UpdatePair2Dgtl();
+    else if (Type == OSC_TYPE_TRI)
+        UpdatePair3Dgtl();
+    else if (Bank == 2)
+        UpdatePair2Anlg();
+    else
+        UpdatePair3Anlg();
+}
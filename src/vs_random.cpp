@@ -0,0 +1,79 @@
+#include "vs_random.h"
+#include <string.h>
+
+static inline uint32_t Rotl(uint32_t x, int k)
+{
+    return (x << k) | (x >> (32 - k));
+}
+
+static inline uint32_t SplitMix32(uint32_t &state)
+{
+    uint32_t z = (state += 0x9E3779B9u);
+    z = (z ^ (z >> 16)) * 0x85EBCA6Bu;
+    z = (z ^ (z >> 13)) * 0xC2B2AE35u;
+    return z ^ (z >> 16);
+}
+
+// top 23 bits as mantissa: [1, 2) -> [-1, 1), no int-to-float conversion
+static inline float ToBipolar(uint32_t r)
+{
+    uint32_t bits = 0x3F800000u | (r >> 9);
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f * 2.f - 3.f;
+}
+
+void VS_Random::Init(uint32_t seed)
+{
+    uint32_t sm = seed;
+    for (int l = 0; l < VS_RANDOM_LANES; l++)
+    {
+        s0_[l] = SplitMix32(sm);
+        s1_[l] = SplitMix32(sm);
+        s2_[l] = SplitMix32(sm);
+        s3_[l] = SplitMix32(sm);
+        // xoshiro must never run from an all-zero state
+        if ((s0_[l] | s1_[l] | s2_[l] | s3_[l]) == 0)
+            s0_[l] = 1;
+    }
+    cache_pos_ = VS_RANDOM_LANES;
+}
+
+/**
+ * advance every lane once (xoshiro128+), one output per lane
+ */
+void VS_Random::Step(float *out)
+{
+    for (int l = 0; l < VS_RANDOM_LANES; l++)
+    {
+        const uint32_t result = s0_[l] + s3_[l];
+        const uint32_t t = s1_[l] << 9;
+        s2_[l] ^= s0_[l];
+        s3_[l] ^= s1_[l];
+        s1_[l] ^= s2_[l];
+        s0_[l] ^= s3_[l];
+        s2_[l] ^= t;
+        s3_[l] = Rotl(s3_[l], 11);
+        out[l] = ToBipolar(result);
+    }
+}
+
+void VS_Random::FillBipolar(float *out, size_t size)
+{
+    size_t i = 0;
+    for (; i + VS_RANDOM_LANES <= size; i += VS_RANDOM_LANES)
+        Step(out + i);
+    // tail goes through the cache so no draw is thrown away
+    for (; i < size; i++)
+        out[i] = NextBipolar();
+}
+
+float VS_Random::NextBipolar()
+{
+    if (cache_pos_ >= VS_RANDOM_LANES)
+    {
+        Step(cache_);
+        cache_pos_ = 0;
+    }
+    return cache_[cache_pos_++];
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#define VS_RANDOM_LANES 4
+
+/**
+ * Seedable xoshiro128+ generator for the LFO random modes.
+ * VS_RANDOM_LANES independent streams advance side by side (state stored as
+ * one array per state word) so block fills are straight-line code the compiler
+ * can unroll / vectorise. The same seed and the same sequence of calls always
+ * give the same output, bit for bit, on the board and on a host.
+ */
+class VS_Random
+{
+public:
+  void Init(uint32_t seed);
+
+  // uniform white noise in [-1, 1)
+  void FillBipolar(float *out, size_t size);
+  float NextBipolar();
+
+private:
+  uint32_t s0_[VS_RANDOM_LANES], s1_[VS_RANDOM_LANES];
+  uint32_t s2_[VS_RANDOM_LANES], s3_[VS_RANDOM_LANES];
+  // leftover lane outputs for scalar draws
+  float cache_[VS_RANDOM_LANES];
+  size_t cache_pos_;
+
+  void Step(float *out);
+};
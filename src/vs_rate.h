@@ -0,0 +1,23 @@
+#pragma once
+#include "DaisyDuino.h"
+
+/**
+ * Limits that follow the sample rate, derived once at Init. At 48 kHz they
+ * are the values the engine was tuned with; lower rates pull them under
+ * Nyquist, higher rates keep the audible caps.
+ */
+struct VS_RateLimits
+{
+  float max_cutoff;   // ladder cutoff, Hz
+  float max_osc_freq; // oscillator pitch after modulation, Hz
+  float max_fm_freq;  // audio-rate LFO (FM mode), Hz
+
+  static VS_RateLimits For(float sample_rate)
+  {
+    VS_RateLimits r;
+    r.max_cutoff = fminf(0.375f * sample_rate, 18000.f);
+    r.max_osc_freq = fminf(0.375f * sample_rate, 18000.f);
+    r.max_fm_freq = fminf(sample_rate * (5.f / 12.f), 20000.f);
+    return r;
+  }
+};
@@ -0,0 +1,395 @@
+#include "vs_sample.h"
+#include "vs_sample_file.h"
+#include <new>
+#include <string.h>
+
+static inline uint16_t Le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t Le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+/**
+ * storage
+ */
+#if defined(__arm__)
+bool VS_SampleFile::Open(const char *path)
+{
+    Close();
+    file_ = SD.open(path);
+    open_ = (bool)file_;
+    size_ = open_ ? file_.size() : 0;
+    return open_;
+}
+
+void VS_SampleFile::Close()
+{
+    if (open_)
+        file_.close();
+    open_ = false;
+    size_ = 0;
+}
+
+bool VS_SampleFile::IsOpen() const
+{
+    return open_;
+}
+
+bool VS_SampleFile::ReadAt(uint32_t offset, void *dst, size_t bytes)
+{
+    if (!open_ || !file_.seek(offset))
+        return false;
+    return file_.read(dst, bytes) == (int)bytes;
+}
+#else
+bool VS_SampleFile::Open(const char *path)
+{
+    Close();
+    file_ = fopen(path, "rb");
+    if (!file_)
+        return false;
+    fseek(file_, 0, SEEK_END);
+    size_ = (uint32_t)ftell(file_);
+    return true;
+}
+
+void VS_SampleFile::Close()
+{
+    if (file_)
+        fclose(file_);
+    file_ = nullptr;
+    size_ = 0;
+}
+
+bool VS_SampleFile::IsOpen() const
+{
+    return file_ != nullptr;
+}
+
+bool VS_SampleFile::ReadAt(uint32_t offset, void *dst, size_t bytes)
+{
+    if (!file_ || fseek(file_, offset, SEEK_SET) != 0)
+        return false;
+    return fread(dst, 1, bytes, file_) == bytes;
+}
+#endif
+
+/**
+ * multisample set (boot time)
+ */
+size_t VS_SampleSet::Load(const char *dir, float *arena, size_t arena_size)
+{
+    arena_.Init(arena, arena_size);
+    count_ = 0;
+    for (size_t i = 0; i < SAMPLE_ZONES; i++)
+    {
+        VS_SampleZone &zone = zones_[count_];
+        snprintf(zone.path, sizeof(zone.path), "%s/%u.wav", dir, (unsigned)i);
+        if (!LoadZone(zone.path, zone))
+            break;
+        count_++;
+    }
+    return count_;
+}
+
+size_t VS_SampleSet::ZoneFor(float freq) const
+{
+    size_t best = 0;
+    float best_dist = 1e9f;
+    for (size_t i = 0; i < count_; i++)
+    {
+        // distance in octaves
+        float dist = fabsf(log2f(freq / zones_[i].root_freq));
+        if (dist < best_dist)
+        {
+            best_dist = dist;
+            best = i;
+        }
+    }
+    return best;
+}
+
+// 16-bit PCM WAV, mono or stereo; loop and root note from the smpl chunk
+bool VS_SampleSet::LoadZone(const char *path, VS_SampleZone &zone)
+{
+    VS_SampleFile file;
+    uint8_t head[12];
+    if (!file.Open(path))
+        return false;
+    if (!file.ReadAt(0, head, sizeof(head)) || memcmp(head, "RIFF", 4) != 0 ||
+        memcmp(head + 8, "WAVE", 4) != 0)
+    {
+        file.Close();
+        return false;
+    }
+
+    uint16_t format = 0, bits = 0;
+    uint32_t data_bytes = 0;
+    bool have_data = false;
+    zone.channels = 0;
+    zone.root_freq = mtof(60.f);
+    zone.has_loop = false;
+    uint32_t off = sizeof(head);
+    while (off + 8 <= file.Size())
+    {
+        uint8_t chunk[8];
+        if (!file.ReadAt(off, chunk, sizeof(chunk)))
+            break;
+        const uint32_t size = Le32(chunk + 4);
+        const uint32_t body = off + 8;
+        if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16)
+        {
+            uint8_t fmt[16];
+            if (!file.ReadAt(body, fmt, sizeof(fmt)))
+                break;
+            format = Le16(fmt);
+            zone.channels = Le16(fmt + 2);
+            zone.sample_rate = (float)Le32(fmt + 4);
+            bits = Le16(fmt + 14);
+        }
+        else if (memcmp(chunk, "data", 4) == 0)
+        {
+            zone.data_offset = body;
+            data_bytes = size;
+            have_data = true;
+        }
+        else if (memcmp(chunk, "smpl", 4) == 0 && size >= 36)
+        {
+            uint8_t smpl[60];
+            size_t len = size < sizeof(smpl) ? size : sizeof(smpl);
+            if (!file.ReadAt(body, smpl, len))
+                break;
+            float note = Le32(smpl + 12) + Le32(smpl + 16) / 4294967296.f;
+            zone.root_freq = mtof(note);
+            if (Le32(smpl + 28) > 0 && len >= 60)
+            {
+                // first loop only, its end is inclusive
+                zone.loop_start = Le32(smpl + 44);
+                zone.loop_end = Le32(smpl + 48) + 1;
+                zone.has_loop = true;
+            }
+        }
+        off = body + size + (size & 1);
+    }
+
+    bool ok = have_data && format == 1 && bits == 16 && (zone.channels == 1 || zone.channels == 2);
+    if (ok)
+    {
+        zone.frames = data_bytes / (2 * zone.channels);
+        if (zone.data_offset + (uint64_t)data_bytes > file.Size())
+            zone.frames = (file.Size() - zone.data_offset) / (2 * zone.channels);
+        if (zone.has_loop && !(zone.loop_start < zone.loop_end && zone.loop_end <= zone.frames))
+            zone.has_loop = false;
+        ok = zone.frames > 1;
+    }
+
+    zone.attack_len = zone.frames < SAMPLE_RESIDENT_FRAMES ? zone.frames : SAMPLE_RESIDENT_FRAMES;
+    zone.loop_head_len = 0;
+    zone.attack = nullptr;
+    zone.loop_head = nullptr;
+    if (ok)
+    {
+        float *attack = arena_.Allocate(zone.attack_len);
+        ok = attack && LoadResident(file, zone, 0, zone.attack_len, attack);
+        zone.attack = attack;
+    }
+    if (ok && zone.has_loop)
+    {
+        uint32_t len = zone.loop_end - zone.loop_start;
+        zone.loop_head_len = len < SAMPLE_RESIDENT_FRAMES ? len : SAMPLE_RESIDENT_FRAMES;
+        float *head = arena_.Allocate(zone.loop_head_len);
+        ok = head && LoadResident(file, zone, zone.loop_start, zone.loop_head_len, head);
+        zone.loop_head = head;
+    }
+    file.Close();
+    return ok;
+}
+
+bool VS_SampleSet::LoadResident(VS_SampleFile &file, const VS_SampleZone &zone, uint32_t first,
+                                uint32_t frames, float *dst)
+{
+    int16_t buf[1024];
+    const uint32_t per_read = sizeof(buf) / (2 * zone.channels);
+    uint32_t done = 0;
+    while (done < frames)
+    {
+        uint32_t n = frames - done < per_read ? frames - done : per_read;
+        if (!file.ReadAt(zone.data_offset + (first + done) * 2 * zone.channels, buf,
+                         n * 2 * zone.channels))
+            return false;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            if (zone.channels == 2)
+                dst[done + i] = (buf[2 * i] + buf[2 * i + 1]) * (0.5f / 32768.f);
+            else
+                dst[done + i] = buf[i] * (1.f / 32768.f);
+        }
+        done += n;
+    }
+    return true;
+}
+
+/**
+ * stream
+ */
+static_assert(sizeof(VS_SampleFile) <= SAMPLE_FILE_STORAGE && alignof(VS_SampleFile) <= 8,
+              "VS_SampleFile outgrew SAMPLE_FILE_STORAGE");
+
+VS_SampleStream::VS_SampleStream() : file_(new (file_storage_) VS_SampleFile()) {}
+
+VS_SampleStream::~VS_SampleStream()
+{
+    file_->Close();
+    file_->~VS_SampleFile();
+}
+
+void VS_SampleStream::Init(float sample_rate)
+{
+    sr_recip_ = 1.f / sample_rate;
+}
+
+void VS_SampleStream::Attach(const VS_SampleSet *set)
+{
+    set_ = (set && set->Zones() > 0) ? set : nullptr;
+}
+
+// the streamed part of the playback path, one chunk at a time
+bool VS_SampleStream::NextChunk(const VS_SampleZone &z, uint32_t &first, uint32_t &frames)
+{
+    const bool loop = read_request_ & 1;
+    const uint32_t end = loop ? z.loop_end : z.frames;
+    for (;;)
+    {
+        // resident frames are never streamed
+        if (read_next_ < z.attack_len)
+            read_next_ = z.attack_len;
+        if (read_next_ >= z.loop_start && read_next_ - z.loop_start < z.loop_head_len)
+            read_next_ = z.loop_start + z.loop_head_len;
+        if (read_next_ < end)
+            break;
+        if (!loop)
+            return false;
+        // around the loop: playback resumes from the loop head
+        uint32_t resume = z.loop_start + z.loop_head_len;
+        if (resume < z.attack_len)
+            resume = z.attack_len;
+        if (resume >= z.loop_end)
+            return false; // the whole loop is resident
+        read_next_ = resume;
+    }
+    uint32_t stop = read_next_ + SAMPLE_CHUNK_FRAMES;
+    if (stop > end)
+        stop = end;
+    if (z.loop_head_len > 0 && read_next_ < z.loop_start && stop > z.loop_start)
+        stop = z.loop_start;
+    first = read_next_;
+    frames = stop - first;
+    read_next_ = stop;
+    return true;
+}
+
+void VS_SampleStream::Service()
+{
+    if (!set_)
+        return;
+    // the player has moved on from any other generation for good: what
+    // is still tagged for one is free again
+    const uint32_t req = request_.load(std::memory_order_acquire);
+    for (Slot &s : slots_)
+    {
+        uint32_t tag = s.tag.load(std::memory_order_acquire);
+        if (tag != 0 && (tag >> 16) != ((req >> 8) & 0xffff))
+            s.tag.store(0, std::memory_order_release);
+    }
+    if (req != read_request_)
+    {
+        read_request_ = req;
+        read_chunk_ = 0;
+        read_next_ = 0;
+        read_done_ = false;
+    }
+    if (read_done_)
+        return;
+
+    const uint32_t zone_idx = (req >> 1) & 0x7f;
+    const VS_SampleZone &z = set_->Zone(zone_idx);
+    if (file_zone_ != (int)zone_idx)
+    {
+        file_zone_ = -1;
+        if (!file_->Open(z.path))
+        {
+            read_done_ = true;
+            return;
+        }
+        file_zone_ = (int)zone_idx;
+    }
+
+    const uint32_t stride = 2 * z.channels;
+    for (int n = 0; n < 2; n++)
+    {
+        Slot &s = slots_[read_chunk_ & 1];
+        if (s.tag.load(std::memory_order_acquire) != 0)
+            break; // still being played
+        uint32_t first, frames;
+        if (!NextChunk(z, first, frames))
+        {
+            read_done_ = true;
+            break;
+        }
+        // whole sectors only
+        const uint32_t start = z.data_offset + first * stride;
+        const uint32_t stop = start + frames * stride;
+        const uint32_t aligned = start & ~(uint32_t)(SAMPLE_SECTOR - 1);
+        uint32_t len = (stop - aligned + SAMPLE_SECTOR - 1) & ~(uint32_t)(SAMPLE_SECTOR - 1);
+        if (aligned + len > file_->Size())
+            len = file_->Size() - aligned;
+        if (!file_->ReadAt(aligned, s.raw, len))
+        {
+            read_done_ = true;
+            break;
+        }
+        // a new note came in during the read: drop it, the next pass
+        // starts on the new one
+        if (request_.load(std::memory_order_acquire) != req)
+            break;
+        s.first = first;
+        s.frames = frames;
+        s.skip = start - aligned;
+        s.tag.store(Tag(req >> 8, read_chunk_), std::memory_order_release);
+        read_chunk_++;
+    }
+}
+
+/**
+ * audio side
+ */
+void VS_SampleStream::Trigger(float freq, bool loop)
+{
+    if (!set_)
+        return;
+    // the set is read-only once loaded
+    const size_t zone = set_->ZoneFor(freq);
+    loop = loop && set_->Zone(zone).has_loop;
+    play_gen_ = (play_gen_ + 1) & 0xffffff;
+    if (play_gen_ == 0)
+        play_gen_ = 1;
+    // hand back whatever was read ahead for the previous note
+    for (Slot &s : slots_)
+    {
+        uint32_t tag = s.tag.load(std::memory_order_acquire);
+        if (tag != 0 && (tag >> 16) != (play_gen_ & 0xffff))
+            s.tag.store(0, std::memory_order_release);
+    }
+    zone_ = &set_->Zone(zone);
+    loop_ = loop;
+    pos_ = 0.;
+    chunk_ = 0;
+    playing_ = true;
+    // Service() reads ahead for this generation from its next pass
+    request_.store(Request(play_gen_, (uint32_t)zone, loop), std::memory_order_release);
+}
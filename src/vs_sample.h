@@ -0,0 +1,229 @@
+#pragma once
+#include "DaisyDuino.h"
+#include "vs_common.h"
+#include "vs_delay.h"
+#include <atomic>
+#include <string.h>
+
+// multisample zones, one WAV file each
+#define SAMPLE_ZONES 8
+// frames kept in SDRAM at the start of a zone and at its loop start
+#define SAMPLE_RESIDENT_FRAMES 32768
+// frames per stream slot (two slots per stream)
+#define SAMPLE_CHUNK_FRAMES 4096
+// card reads start and end on sector boundaries
+#define SAMPLE_SECTOR 512
+// resident segments, in floats (2 MB of SDRAM)
+#define SAMPLE_ARENA_SIZE (SAMPLE_ZONES * 2 * SAMPLE_RESIDENT_FRAMES)
+// fastest playback (2 octaves up), bounds the read bandwidth
+#define SAMPLE_MAX_STEP 4.f
+
+// reads from the SD card / a host file, see vs_sample_file.h; only
+// vs_sample.cpp sees the storage library behind it
+class VS_SampleFile;
+// room VS_SampleStream keeps for its reader's VS_SampleFile, bytes
+#define SAMPLE_FILE_STORAGE 128
+
+// one 16-bit PCM WAV file of a multisample
+struct VS_SampleZone
+{
+  char path[64];
+  uint32_t data_offset; // bytes, first PCM frame in the file
+  uint32_t frames;
+  uint16_t channels;    // 1 or 2, stereo is summed to mono
+  float sample_rate;
+  float root_freq;      // plays unshifted at this pitch (smpl chunk, or C4)
+  bool has_loop;
+  uint32_t loop_start, loop_end; // frames, end exclusive
+  // resident copies: [0, attack_len) and [loop_start, loop_start + loop_head_len)
+  const float *attack;
+  uint32_t attack_len;
+  const float *loop_head;
+  uint32_t loop_head_len;
+};
+
+/**
+ * A multisample: up to SAMPLE_ZONES WAV files, <dir>/0.wav, <dir>/1.wav...
+ * Loaded once at boot; only the attack and the head of the loop are read
+ * into the arena, the rest is streamed. Read-only afterwards, so any
+ * number of streams (and engines) can share one set.
+ */
+class VS_SampleSet
+{
+public:
+  // number of zones found, 0 if none
+  size_t Load(const char *dir, float *arena, size_t arena_size);
+
+  size_t Zones() const { return count_; }
+  const VS_SampleZone &Zone(size_t i) const { return zones_[i]; }
+  // zone whose root is closest to `freq`
+  size_t ZoneFor(float freq) const;
+
+  // resident memory, in bytes
+  size_t MemoryUsed() const { return arena_.Used() * sizeof(float); }
+
+private:
+  bool LoadZone(const char *path, VS_SampleZone &zone);
+  bool LoadResident(VS_SampleFile &file, const VS_SampleZone &zone, uint32_t first,
+                    uint32_t frames, float *dst);
+
+  VS_Arena arena_;
+  VS_SampleZone zones_[SAMPLE_ZONES];
+  size_t count_ = 0;
+};
+
+/**
+ * Plays one zone of a VS_SampleSet at any pitch, one-shot or looped.
+ *
+ * A note starts from the resident attack, so note-on never waits on the
+ * card: Trigger() starts playback on the audio side, at the sample it is
+ * called, and publishes the note's generation. Service() (from loop())
+ * then reads ahead along that note's playback path into two slots, chunk
+ * after chunk, skipping what is resident; a
+ * looped note jumps back into the resident loop head, which gives the
+ * reader the same head start on every pass. The audio side only checks a
+ * slot's tag and never waits: a chunk that is not there in time plays as
+ * silence and is counted.
+ */
+class VS_SampleStream
+{
+public:
+  VS_SampleStream();
+  ~VS_SampleStream();
+  void Init(float sample_rate);
+  void Attach(const VS_SampleSet *set);
+  bool Attached() const { return set_ != nullptr; }
+
+  /* loop() side */
+  void Service();
+
+  /* audio side */
+  // note-on: plays from the resident attack right away
+  void Trigger(float freq, bool loop);
+  // one sample at `freq`
+  float Process(float freq);
+
+  uint32_t Underruns() const { return underruns_.load(std::memory_order_relaxed); }
+
+private:
+  struct Slot
+  {
+    std::atomic<uint32_t> tag{0}; // 0 = free, else Tag(gen, chunk)
+    uint32_t first, frames;       // frames of the zone it holds
+    uint32_t skip;                // bytes before `first` in raw
+    uint8_t raw[SAMPLE_CHUNK_FRAMES * 4 + 2 * SAMPLE_SECTOR];
+  };
+  static uint32_t Tag(uint32_t gen, uint32_t chunk)
+  {
+    return ((gen & 0xffff) << 16) | 0x8000 | (chunk & 0x7fff);
+  }
+  static uint32_t Request(uint32_t gen, uint32_t zone, bool loop)
+  {
+    return (gen << 8) | (zone << 1) | (loop ? 1 : 0);
+  }
+  bool NextChunk(const VS_SampleZone &z, uint32_t &first, uint32_t &frames);
+  float FrameAt(uint32_t idx, bool advance, float missing);
+  float Decode(const Slot &s, uint32_t offset) const;
+
+  const VS_SampleSet *set_ = nullptr;
+  float sr_recip_ = 1.f / 48000.f;
+  Slot slots_[2];
+  std::atomic<uint32_t> request_{0}; // written by Trigger
+  std::atomic<uint32_t> underruns_{0};
+
+  /* reader, loop() side */
+  // the file is built in place, so its type stays out of this header
+  alignas(8) unsigned char file_storage_[SAMPLE_FILE_STORAGE];
+  VS_SampleFile *file_;
+  int file_zone_ = -1;
+  uint32_t read_request_ = 0;
+  uint32_t read_chunk_ = 0, read_next_ = 0;
+  bool read_done_ = true;
+
+  /* player, audio side */
+  const VS_SampleZone *zone_ = nullptr;
+  bool loop_ = false, playing_ = false;
+  double pos_ = 0.;
+  uint32_t chunk_ = 0, play_gen_ = 0;
+};
+
+/**
+ * audio side, inline so the player compiles into the voice's sample loop
+ */
+VS_INLINE float VS_SampleStream::Decode(const Slot &s, uint32_t offset) const
+{
+  const uint8_t *p = s.raw + s.skip + offset * 2 * zone_->channels;
+  int16_t l;
+  memcpy(&l, p, sizeof(l));
+  if (zone_->channels == 2)
+  {
+    int16_t r;
+    memcpy(&r, p + 2, sizeof(r));
+    return (l + r) * (0.5f / 32768.f);
+  }
+  return l * (1.f / 32768.f);
+}
+
+// `advance` moves on to the next chunk once idx has left the current one;
+// false only peeks (interpolation neighbour) and gives `missing` back when
+// the frame is not there
+VS_INLINE float VS_SampleStream::FrameAt(uint32_t idx, bool advance, float missing)
+{
+  const VS_SampleZone &z = *zone_;
+  if (idx < z.attack_len)
+    return z.attack[idx];
+  if (idx >= z.loop_start && idx - z.loop_start < z.loop_head_len)
+    return z.loop_head[idx - z.loop_start];
+
+  for (uint32_t c = chunk_; c < chunk_ + 2; c++)
+  {
+    Slot &s = slots_[c & 1];
+    if (s.tag.load(std::memory_order_acquire) != Tag(play_gen_, c))
+      break;
+    if (idx >= s.first && idx - s.first < s.frames)
+    {
+      if (advance && c != chunk_)
+      {
+        slots_[chunk_ & 1].tag.store(0, std::memory_order_release);
+        chunk_ = c;
+      }
+      return Decode(s, idx - s.first);
+    }
+    if (!advance)
+      continue;
+    // left this chunk: give it back to the reader
+    s.tag.store(0, std::memory_order_release);
+    chunk_ = c + 1;
+  }
+  if (advance)
+    underruns_.fetch_add(1, std::memory_order_relaxed);
+  return missing;
+}
+
+VS_INLINE float VS_SampleStream::Process(float freq)
+{
+  if (!playing_)
+    return 0.f;
+  const VS_SampleZone &z = *zone_;
+  const uint32_t idx = (uint32_t)pos_;
+  const float frac = (float)(pos_ - idx);
+
+  float a = FrameAt(idx, true, 0.f);
+  uint32_t next = idx + 1;
+  if (loop_ && next >= z.loop_end)
+    next = z.loop_start;
+  float b = next < z.frames ? FrameAt(next, false, a) : 0.f;
+
+  float step = freq / z.root_freq * z.sample_rate * sr_recip_;
+  if (step > SAMPLE_MAX_STEP)
+    step = SAMPLE_MAX_STEP;
+  pos_ += step;
+  if (loop_)
+  {
+    while (pos_ >= z.loop_end)
+      pos_ -= z.loop_end - z.loop_start;
+  }
+  else if (pos_ >= z.frames)
+    playing_ = false;
+  return a + frac * (b - a);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "DaisyDuino.h"
+#if defined(__arm__)
+#include <STM32SD.h>
+#else
+#include <stdio.h>
+#endif
+
+/**
+ * Random-access reads from storage: the SD card on the Daisy, a plain
+ * file on the host. Only ever used outside the audio callback, and only
+ * included by vs_sample.cpp.
+ */
+class VS_SampleFile
+{
+public:
+  bool Open(const char *path);
+  void Close();
+  bool IsOpen() const;
+  uint32_t Size() const { return size_; }
+  // false on a short read
+  bool ReadAt(uint32_t offset, void *dst, size_t bytes);
+
+private:
+#if defined(__arm__)
+  File file_;
+  bool open_ = false;
+#else
+  FILE *file_ = nullptr;
+#endif
+  uint32_t size_ = 0;
+};